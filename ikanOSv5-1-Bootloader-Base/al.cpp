@@ -1250,7 +1250,7 @@ void main()
     // COMMAND_BUFFER.
 
     printString(COLOR_WHITE, currentPrintRow++, 5, (uint8_t *)"Creating temp file.");
-    systemOpenEmptyFile(strConcat(removeExtension((uint8_t*)(COMMAND_BUFFER + 3)), (uint8_t*)".al.tmp\n"), 3);
+    systemOpenEmptyFile(strConcat((uint8_t*)TMPFS_MOUNT_POINT, strConcat(removeExtension((uint8_t*)(COMMAND_BUFFER + 3)), (uint8_t*)".al.tmp\n")), 3);
     currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
     tempFd = readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR);
     tempFileContent = (uint8_t*)readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR_PTR);
@@ -1261,7 +1261,7 @@ void main()
     tempFileContent = (uint8_t*)readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR_PTR);
 
     printString(COLOR_WHITE, currentPrintRow++, 5, (uint8_t *)"Opening temp.");
-    systemOpenFile(strConcat(removeExtension((uint8_t*)(COMMAND_BUFFER + 3)), (uint8_t*)".al.tmp\n"), RDWRITE);
+    systemOpenFile(strConcat((uint8_t*)TMPFS_MOUNT_POINT, strConcat(removeExtension((uint8_t*)(COMMAND_BUFFER + 3)), (uint8_t*)".al.tmp\n")), RDWRITE);
     currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
     tempFd = readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR);
     tempFileContent = (uint8_t*)readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR_PTR);
@@ -1291,7 +1291,7 @@ void main()
     libcFileContent = (uint8_t*)readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR_PTR);
 
     printString(COLOR_WHITE, currentPrintRow++, 5, (uint8_t *)"Deleting temp file.");
-    systemDeleteFile(strConcat(removeExtension((uint8_t*)(COMMAND_BUFFER + 3)), (uint8_t*)".al.tmp"));
+    systemDeleteFile(strConcat((uint8_t*)TMPFS_MOUNT_POINT, strConcat(removeExtension((uint8_t*)(COMMAND_BUFFER + 3)), (uint8_t*)".al.tmp")));
     currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
     tempFd = readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR);
     tempFileContent = (uint8_t*)readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR_PTR);
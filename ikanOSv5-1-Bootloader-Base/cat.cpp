@@ -8,6 +8,75 @@
 #include "x86.h"
 #include "file.h"
 
+#define CAT_CHUNK_SIZE 0x200
+#define CAT_LAST_ROW 46
+
+
+uint8_t *commandArgument(uint32_t argumentNumber)
+{
+    // sh leaves "cat\0file" in COMMAND_BUFFER, or "cat\0file\0|\0grep\0word" when cat feeds a pipe.
+    // Everything after the last token is zeroed, so a missing argument comes back as an empty string.
+    uint8_t *argument = COMMAND_BUFFER;
+
+    for (uint32_t x = 0; x < argumentNumber && *argument != 0; x++)
+    {
+        argument = argument + strlen(argument) + 1;
+    }
+
+    return argument;
+}
+
+void streamFileToScreen(uint32_t currentPid, uint8_t *fileName)
+{
+    // The file is read a chunk at a time through one small buffer, so its size doesn't matter
+
+    uint8_t *chunk = malloc(currentPid, CAT_CHUNK_SIZE);
+    uint32_t row = 0;
+    uint32_t column = 0;
+    uint32_t bytesRead = 0;
+    bool quit = false;
+
+    clearScreen();
+
+    if (systemOpenFileStream(fileName, RDONLY) == SYSCALL_FAIL)
+    {
+        printString(COLOR_RED, 0, 0, (uint8_t *)"No such file!");
+        free(chunk);
+        return;
+    }
+
+    uint32_t fileDescriptor = readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR);
+
+    while (!quit && (bytesRead = systemReadFile(fileDescriptor, chunk, CAT_CHUNK_SIZE)) != 0 && bytesRead != SYSCALL_FAIL)
+    {
+        for (uint32_t x = 0; x < bytesRead && !quit; x++)
+        {
+            if (chunk[x] == (uint8_t)0x0a) { row++; column = 0; }
+            else if (chunk[x] == (uint8_t)0x09) { column = column + 4; }
+            else if (chunk[x] != (uint8_t)0x0d) { printCharacter(COLOR_WHITE, row, column++, &chunk[x]); }
+
+            if (column > 79) { column = 0; row++; }
+
+            if (row > CAT_LAST_ROW)
+            {
+                printString(COLOR_LIGHT_BLUE, CAT_LAST_ROW + 2, 0, (uint8_t *)"Enter = next page, Q = quit");
+                quit = (waitForEnterOrQuit() == 0);
+                clearScreen();
+                row = 0;
+                column = 0;
+            }
+        }
+    }
+
+    systemCloseFile(fileDescriptor);
+    free(chunk);
+
+    if (!quit)
+    {
+        printString(COLOR_LIGHT_BLUE, CAT_LAST_ROW + 2, 0, (uint8_t *)"Press Enter to quit.");
+        waitForEnterOrQuit();
+    }
+}
 
 void printBufferToScreen(uint8_t *userSpaceBuffer)
 {
@@ -45,6 +114,14 @@ void main()
 {    
     uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
     struct openBufferTable *openBufferTable = (struct openBufferTable*)OPEN_BUFFER_TABLE;
+
+    // Run on its own as "cat file", page through the file instead of copying stdin to stdout
+    if (*commandArgument(1) != 0 && strcmp(commandArgument(2), (uint8_t *)"|") != 0)
+    {
+        streamFileToScreen(currentPid, commandArgument(1));
+        systemExit(PROCESS_EXIT_CODE_SUCCESS);
+    }
+
     uint8_t* pipeInFdString = malloc(currentPid, 20);
     uint8_t* pipeOutFdString = malloc(currentPid, 20);
     itoa(0, pipeInFdString);
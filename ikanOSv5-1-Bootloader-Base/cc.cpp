@@ -1470,7 +1470,7 @@ void main()
     // COMMAND_BUFFER.
 
     printString(COLOR_WHITE, currentPrintRow++, 5, (uint8_t *)"Creating temp file.");
-    systemOpenEmptyFile(strConcat(removeExtension((uint8_t*)(COMMAND_BUFFER + 3)), (uint8_t*)".cc.tmp\n"), 1);
+    systemOpenEmptyFile(strConcat((uint8_t*)TMPFS_MOUNT_POINT, strConcat(removeExtension((uint8_t*)(COMMAND_BUFFER + 3)), (uint8_t*)".cc.tmp\n")), 1);
     myProcessId = readValueFromMemLoc(RUNNING_PID_LOC);
     tempFileDescriptor = readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR);
     tempFilePointer = (uint32_t)readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR_PTR);
@@ -1481,7 +1481,7 @@ void main()
     tempFilePointer = (uint32_t)readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR_PTR);
 
     printString(COLOR_WHITE, currentPrintRow++, 5, (uint8_t *)"Opening temp file");
-    systemOpenFile(strConcat(removeExtension((uint8_t*)(COMMAND_BUFFER + 3)), (uint8_t*)".cc.tmp\n"), RDWRITE);
+    systemOpenFile(strConcat((uint8_t*)TMPFS_MOUNT_POINT, strConcat(removeExtension((uint8_t*)(COMMAND_BUFFER + 3)), (uint8_t*)".cc.tmp\n")), RDWRITE);
     myProcessId = readValueFromMemLoc(RUNNING_PID_LOC);
     tempFileDescriptor = readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR);
     tempFilePointer = (uint32_t)readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR_PTR);
@@ -1504,7 +1504,7 @@ void main()
     tempFilePointer = (uint32_t)readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR_PTR);
 
     printString(COLOR_WHITE, currentPrintRow++, 5, (uint8_t *)"Deleting temp file");
-    systemDeleteFile(strConcat(removeExtension((uint8_t*)(COMMAND_BUFFER + 3)), (uint8_t*)".cc.tmp"));
+    systemDeleteFile(strConcat((uint8_t*)TMPFS_MOUNT_POINT, strConcat(removeExtension((uint8_t*)(COMMAND_BUFFER + 3)), (uint8_t*)".cc.tmp")));
     myProcessId = readValueFromMemLoc(RUNNING_PID_LOC);
     
     currentPrintRow++;
@@ -6,6 +6,15 @@ typedef unsigned int uint32_t;
 typedef unsigned short uint16_t;
 typedef unsigned char uint8_t;
 
+// File System Geometry. The Makefile passes these in from its FS_BLOCK_SIZE (make FS_BLOCK_SIZE=1024, 2048 or 4096),
+// so everything built in one make run agrees with the image it builds. The defaults are the standard 2KB build.
+#ifndef FS_BLOCK_SIZE
+#define FS_BLOCK_SIZE 0x800
+#endif
+#ifndef EXT2_BLOCK_COUNT
+#define EXT2_BLOCK_COUNT 16000 // The code only handles one block group, so at most FS_BLOCK_SIZE * 8
+#endif
+
 // Memory Locations
 #define USER_SPACE_BASE 0x0
 #define KEYBOARD_BUFFER 0x1000
@@ -59,6 +68,8 @@ typedef unsigned char uint8_t;
 #define KERNEL_CACHE_HITS 0x9FC044
 #define NETWORK_PACKETS_TRANSMITTED 0x9FC048
 #define NETWORK_PACKETS_RECEIVED 0x9FC04C
+#define KERNEL_JOURNAL_COMMITS 0x9FC050
+#define KERNEL_JOURNAL_BLOCKS_ABSORBED 0x9FC054
 #define SECOND_PROC_STARTUP_FUNC_LOC 0x9FC100
 #define CURRENT_PROC_RUNNING_LOC 0x9FC104
 #define SECOND_PROC_TICK_COUNT_LOC 0x9FC110
@@ -67,20 +78,57 @@ typedef unsigned char uint8_t;
 #define PAGE_DIR_BASE 0xA00000
 #define PAGE_TABLE_BASE 0xA01000
 #define PAGEFRAME_MAP_BASE 0xAD0000
+#define PAGEFRAME_FREE_BITMAP ((uint32_t *)0xAD2000)
+#define PAGEFRAME_OWNER_COUNTS ((uint32_t *)0xAD3000)
+#define PAGEFRAME_SEARCH_CURSOR 0xAD3400
+#define PAGEFRAME_FRAMES_USED 0xAD3404
+#define PAGEFRAME_CPU_CACHES ((uint8_t *)0xADC000)
+#define PAGEFRAME_SHARE_COUNTS ((uint8_t *)0xADD000)
 #define DISK_READ_CACHE_LOC ((uint8_t *)0xB00000)
 #define DISK_READ_CACHE_DATA ((uint8_t *)0xB01000)
+#define FILE_MAPPING_TABLE ((uint8_t *)0xB60000)
+#define PAGE_CACHE_TABLE ((uint8_t *)0xB61000)
+#define FILE_MAPPING_FAULT_BLOCK_LOC ((uint8_t *)0xB63000)
+#define INITRAMFS_LOC ((uint8_t *)0xB64000)
 #define NETWORK_INCOMING_RCV_BUFFER 0xC00000
 #define NETWORK_INCOMING_RCV_BUFFER_SIZE 0x5000
 #define NETWORK_INCOMING_PAYLOAD_BUFFER 0xC05000
 #define NETWORK_INCOMING_PAYLOAD_BUFFER_SIZE 0x5000
 #define KERNEL_WORKING_DIR_TEMP_INODE_LOC ((uint8_t *)0xC10000)
 #define KERNEL_WORKING_DIR ((uint8_t *)0xC18000)
+#define TMPFS_TABLE ((uint8_t *)0xC20000)
+#define TMPFS_PAGE_MAP ((uint8_t *)0xC22000)
+#define INODE_LOCK_TABLE ((uint32_t *)0xC23000)
+#define DIRECTORY_LOCK_TABLE ((uint32_t *)0xC23100)
+#define FILE_IO_SCRATCH_IN_USE ((uint32_t *)0xC23200)
+#define FILE_IO_SCRATCH ((uint8_t *)0xC24000)
+#define BOOT_TRACE_LOC ((uint8_t *)0xC2A000)
+#define FSCK_BLOCK_MAP ((uint8_t *)0xC2B000)
+#define FSCK_DIRECTORY_MAP ((uint8_t *)0xC2C000)
+#define FSCK_LINK_COUNTS ((uint16_t *)0xC2D000)
+#define FSCK_DIRECTORY_QUEUE ((uint32_t *)0xC31000)
+#define FSCK_SCRATCH ((uint8_t *)0xC39000)
+#define DEFRAG_BLOCK_LIST ((uint32_t *)0xC3E000)
+#define DEFRAG_SCRATCH ((uint8_t *)0xC40000)
+#define COPY_ON_WRITE_BUFFER ((uint8_t *)0xC42000)
+#define SHARED_LIBRARY_FRAMES ((uint32_t *)0xC44000)
+#define EXEC_IMAGE_CACHE_CURSOR 0xC44100
+#define EXEC_IMAGE_CACHE ((uint8_t *)0xC45000)
+#define ZERO_POOL_PAGE_TABLE ((uint32_t *)0xC48000)
+#define ZERO_POOL_COUNT 0xC49000
+#define ZERO_POOL_FRAMES ((uint32_t *)0xC49010)
+#define ZERO_POOL_WINDOW 0xFF800000 // One page per CPU, for zeroing frames that aren't mapped anywhere
 #define VGA_CUSTOM_FONT 0xD00000
 #define SUPERBLOCK_LOC ((uint8_t *)0xD05000)
 #define BLOCK_GROUP_DESCRIPTOR_TABLE ((uint8_t *)0xD10000)
+#define FILE_IO_BLOCK_LOC ((uint8_t *)0xD26000)
+#define FILE_IO_INDIRECT_BLOCK_LOC ((uint8_t *)0xD27000)
+#define TMPFS_DATA ((uint8_t *)0xD28000)
+#define JOURNAL_TRANSACTION_LOC ((uint8_t *)0xE28000)
 #define KERNEL_HEAP 0xF00000
 #define KERNEL_LOG_LOC 0xFF0000
 #define KERNEL_LIMIT 0x1000000
+#define LARGE_PAGE_SIZE 0x400000
 #define LAPIC_PAGE 0xFEC00000
 #define LAPIC_ADDR 0xFEE00000
 
@@ -116,7 +164,8 @@ typedef unsigned char uint8_t;
 #define INTERRUPT_MASK_SYSTEM_TIMER_AND_KEYBOARD_ONLY 0xFC
 #define INTERRUPT_MASK_ALL_DISABLED 0xFF
 #define INTERRUPT_END_OF_INTERRUPT 0x20
-#define BLOCK_SIZE 0x800
+#define BLOCK_SIZE FS_BLOCK_SIZE
+#define MAX_BLOCK_SIZE 0x1000 // Fixed buffers that hold whole blocks are sized for this
 #define SECTOR_SIZE 0x200
 #define CACHE_SIZE 168  // Number of 512 byte sectors. 168 = 21 Pages (0x15000 hex bytes)
 #define PAGE_SIZE 0x1000
@@ -141,31 +190,90 @@ typedef unsigned char uint8_t;
 #define MAX_PROCESSES 0x20
 #define MAX_PROCESS_SIZE 0x1000000
 #define PAGEFRAME_MAP_SIZE 0x1800
+#define PAGEFRAME_BITMAP_WORDS (PAGEFRAME_MAP_SIZE / 32) // One bit per frame, set when the frame is free
+#define PAGEFRAME_OWNERS 0x100 // One count per owner byte value
+#define PAGEFRAME_CPUS 0x2
+#define PAGEFRAME_CPU_CACHE_SIZE 0x20 // Free frames each CPU can hold on to
+#define PAGEFRAME_CPU_CACHE_BATCH 0x10 // Frames moved to or from the global map at a time
+#define PAGEFRAME_CPU_CACHED 0xFE // Owner of a frame sitting in a CPU cache
+#define PAGEFRAME_SHARED 0xFD // Owner of a frame mapped copy-on-write by more than one process
+#define PAGEFRAME_ZERO_POOL 0xFC // Owner of a zero filled frame waiting in the zero pool
+#define ZERO_POOL_SIZE 0x40
 #define MAX_FILE_DESCRIPTORS 0xF
 #define MAX_SYSTEM_OPEN_FILES 0x40
 #define MAGIC_ELF 0x464C457F
 #define ELF_LOAD_DYNAMIC_LIBRARIES 0xFF
 #define DYNAMIC_LIBRARIES_SIZE 0x40000
+#define SHARED_LIBRARY_PAGES (DYNAMIC_LIBRARIES_SIZE / PAGE_SIZE)
 #define ELF_PROGRAM_HEADER_SIZE 0x20
+#define PT_NULL 0
 #define PT_LOAD 1
+#define PF_W 0x2 // Program header flag for a writable segment
+#define MAX_EXEC_IMAGES 0x8
+#define EXEC_IMAGE_MAX_PAGES 0x40
 #define INODE_SIZE 0x80
 #define EXT2_SECTOR_START 0x200
-#define EXT2_SUPERBLOCK_SECTOR_START (EXT2_SECTOR_START + (BLOCK_SIZE / SECTOR_SIZE))
+#define EXT2_SUPERBLOCK_BYTE_OFFSET 0x400 // 1KB into the file system whatever the block size
+#define EXT2_SUPERBLOCK_SECTOR_START (EXT2_SECTOR_START + (EXT2_SUPERBLOCK_BYTE_OFFSET / SECTOR_SIZE))
+#define EXT2_SUPERBLOCK_OFFSET (EXT2_SUPERBLOCK_BYTE_OFFSET % BLOCK_SIZE) // Where the superblock starts inside block SUPERBLOCK
 #define EXT2_NUMBER_OF_DIRECT_BLOCKS 0xC
 #define EXT2_FIRST_INDIRECT_BLOCK 0xC
 #define EXT2_BLOCKS_PER_INDIRECT_BLOCK (BLOCK_SIZE / sizeof(uint32_t))
 #define EXT2_DIRECTORY_ENTRY_FILE 0x8
 #define EXT2_DIRECTORY_ENTRY_DIR 0x4
+#define EXT2_DIRECTORY_ENTRY_HEADER_SIZE 0x8 // Inode, record length, name length and type, then the name
+#define EXT2_INODE_TYPE_MASK 0xF000
+#define EXT2_INODE_TYPE_DIRECTORY 0x4000
+#define EXT2_INODE_TYPE_FILE 0x8000
 #define KERNEL_TEMP_INODE_LOC_SIZE (PAGE_SIZE * 2)
 #define KERNEL_WORKING_DIR_TEMP_INODE_LOC_SIZE (PAGE_SIZE * 2)
 #define KERNEL_WORKING_DIR_SIZE (PAGE_SIZE * 2)
 #define MEGABYTE 1048576
 #define MAX_FILES_PER_DIRECTORY 0x40
 #define INODES_PER_BLOCK (BLOCK_SIZE / INODE_SIZE) 
-#define SUPERBLOCK 0x0
-#define GROUP_DESCRIPTOR_BLOCK 0x1
+#define SUPERBLOCK (EXT2_SUPERBLOCK_BYTE_OFFSET / BLOCK_SIZE)
+#define GROUP_DESCRIPTOR_BLOCK (SUPERBLOCK + 1)
+#define EXT2_FIRST_DATA_BLOCK SUPERBLOCK // Block that bit 0 of the block bitmap stands for, 1 with 1KB blocks and 0 otherwise
+#define EXT2_BLOCK_BITMAP_BITS (EXT2_BLOCK_COUNT - EXT2_FIRST_DATA_BLOCK)
+#define EXT2_INODE_COUNT 8000 // mkfs.ext2 -N in the Makefile
 #define ROOTDIR_BLOCK 0x207
 #define ROOTDIR_INODE 0x2
+#define EXT2_FIRST_INODE 0xB // Inodes below this are reserved by EXT2 and never appear in a directory, except the root
+#define JOURNAL_FILE_NAME "fs.journal" // Preallocated in the root directory by the Makefile
+#define JOURNAL_BLOCKS 40 // Size of JOURNAL_FILE_NAME in blocks, JOURNAL_BLOCKS in the Makefile
+#define JOURNAL_MAX_TRANSACTION_BLOCKS (JOURNAL_BLOCKS - 2) // Minus the descriptor and commit blocks
+#define JOURNAL_HANDLE_CREDITS 8 // Largest handle is a create: an inode table block, both bitmaps, a directory block and an indirect block. fsMetadataLock keeps handles from overlapping.
+#define JOURNAL_GROUP_COMMIT_THRESHOLD (JOURNAL_MAX_TRANSACTION_BLOCKS / 2)
+#define JOURNAL_COMMIT_INTERVAL (SYSTEM_INTERRUPTS_PER_SECOND / 2) // In timer interrupts
+#define DISK_FLUSH_INTERVAL (SYSTEM_INTERRUPTS_PER_SECOND / 5) // Flusher wakes up 5 times a second
+#define DISK_WRITEBACK_AGE (SYSTEM_INTERRUPTS_PER_SECOND * 5)
+#define MAX_FILE_MAPPINGS 0x40
+#define MAX_PAGE_CACHE_ENTRIES 0x100 // One page of pageCacheEntry structs
+#define TMPFS_MOUNT_POINT "/tmp/"
+#define TMPFS_MOUNT_POINT_LENGTH 5
+#define MAX_TMPFS_FILES 0x20
+#define TMPFS_MAX_NAME_LENGTH 0x20
+#define TMPFS_MAX_FILE_PAGES 0x40
+#define TMPFS_MAX_PAGES 0x100 // 1MB pool at TMPFS_DATA
+#define FS_LOCK_BUCKETS 0x40
+#define FS_LOCK_WRITER 0x80000000
+#define FS_LOCK_WRITER_WAITING 0x40000000
+#define FILE_IO_SCRATCH_SLOTS 0x2 // One per CPU
+#define FILE_IO_SCRATCH_SLOT_SIZE (MAX_BLOCK_SIZE * 3) // Data block, indirect block and inode table block
+#define INITRAMFS_SECTOR_START (EXT2_SECTOR_START + (EXT2_BLOCK_COUNT * (BLOCK_SIZE / SECTOR_SIZE))) // Appended to fs.img right after the EXT2 image
+#define INITRAMFS_MAX_SIZE 0x9C000 // INITRAMFS_LOC up to NETWORK_INCOMING_RCV_BUFFER
+#define INITRAMFS_MAGIC 0x53465249 // "IRFS"
+#define INITRAMFS_MAX_NAME_LENGTH 0x20
+#define BOOT_TRACE_FILE_NAME "boot.trace" // Preallocated in the root directory by the Makefile
+#define BOOT_TRACE_MAGIC 0x43415254 // "TRAC"
+#define BOOT_TRACE_MAX_BLOCKS (CACHE_SIZE / (BLOCK_SIZE / SECTOR_SIZE)) // More than the sector cache holds would evict itself
+#define FSCK_INDIRECT_LEVELS 0x3 // Single, double and triple indirect blocks
+#define FSCK_SCRATCH_SIZE (MAX_BLOCK_SIZE * (2 + FSCK_INDIRECT_LEVELS)) // Directory block, inode table block, one block per indirect level
+#define DEFRAG_SCRATCH_SIZE (MAX_BLOCK_SIZE * 2) // Indirect block and data block
+#define DIRECTORY_LISTING_NAME_SIZE 0x20 // Longer names are cut short, nameLength still has the real length
+#define DIRECTORY_LISTING_BATCH 0x10 // Entries sysDirectory() reads at a time, fits one kMalloc() object
+#define JOURNAL_DESCRIPTOR_MAGIC 0x4A524E4C
+#define JOURNAL_COMMIT_MAGIC 0x434D4954
 #define SECOND_PROC_START_SECTOR 0x1F0
 #define SOUND_MODE_3_SQUARE_WAVE 0xB6
 #define SECONDS_IN_MIN 60
@@ -214,6 +322,7 @@ typedef uint8_t *va_list;
 #define NE_IMR 0x0F
 #define NE_BNRY 0x03
 #define NE_CURR 0x07
+#define MAX_UDP_PAYLOAD_LEN 1472 // 1514 byte frame minus the Ethernet, IP and UDP headers
 
 // User Interface
 #define ASCII_HORIZONTAL_LINE 0xC4
@@ -235,6 +344,20 @@ typedef uint8_t *va_list;
 #define KERNEL_OWNED 0xFF
 #define RDONLY 0x1
 #define RDWRITE 0x2
+#define PG_PRESENT 0x1
+#define PG_WRITABLE 0x2
+#define PG_LARGE_PAGE 0x80 // Page directory entry that maps 4 MB directly, needs CR4.PSE
+#define PG_GLOBAL 0x100 // Kept in the TLB when CR3 is loaded, needs CR4.PGE
+#define PG_FLAGS_MASK 0x1F // Present, writable, user, write-through and cache disable
+#define PG_FILE_MAPPED 0x200 // Not present, reserved for a file mapping. Bit 9 is free for OS use.
+#define PG_DEMAND_ZERO 0x400 // Not present, a zero filled page is allocated on first touch. Bit 10 is free for OS use.
+#define PG_COPY_ON_WRITE 0x800 // Present and read-only, copied on the first write. Bit 11 is free for OS use.
+#define CR0_WRITE_PROTECT 0x10000 // Ring 0 writes honor read-only pages too
+#define CR0_PAGING_AND_WRITE_PROTECT 0x80010000
+#define CR4_KERNEL_PAGE_FEATURES 0x90 // Page size extensions and page global enable
+#define SEEK_SET 0x0
+#define SEEK_CUR 0x1
+#define SEEK_END 0x2
 
 // System Calls
 #define SYS_SOUND 0x1
@@ -276,3 +399,16 @@ typedef uint8_t *va_list;
 #define SYS_MOVE_FILE 0x25
 #define SYS_GET_INODE_STRUCT 0x26
 #define SYS_CHANGE_FILE_MODE 0x27
+#define SYS_SYNC 0x28
+#define SYS_FSYNC 0x29
+#define SYS_OPEN_STREAM 0x2A
+#define SYS_READ_FILE 0x2B
+#define SYS_WRITE_FILE 0x2C
+#define SYS_LSEEK 0x2D
+#define SYS_MMAP_FILE 0x2E
+#define SYS_MUNMAP 0x2F
+#define SYS_SENDFILE 0x30
+#define SYS_FS_CHECK 0x31
+#define SYS_FS_DEFRAG 0x32
+#define SYS_GET_DIRECTORY_ENTRIES 0x33
+#define SYS_FORK 0x34
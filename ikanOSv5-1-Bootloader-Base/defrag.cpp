@@ -0,0 +1,89 @@
+// Copyright (c) 2025-2026 Dan O’Malley
+// This file is licensed under the MIT License. See LICENSE for details.
+
+
+#include "screen.h"
+#include "keyboard.h"
+#include "libc-main.h"
+#include "constants.h"
+#include "x86.h"
+#include "file.h"
+#include "fs.h"
+
+#define DEFRAG_LAST_FILE_ROW 18
+
+void main()
+{
+    uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+
+    // sh leaves "defrag\0file" in COMMAND_BUFFER
+    uint8_t *fileName = (uint8_t*)(COMMAND_BUFFER + 7);
+
+    struct fsDefragReport *Report = (struct fsDefragReport *)malloc(currentPid, sizeof(fsDefragReport));
+
+    clearScreen();
+
+    uint32_t row = 3;
+    uint32_t column = 3;
+    uint32_t inodeNumber = 0;
+
+    if (*fileName != 0)
+    {
+        printf(COLOR_GREEN, row++, column, (uint8_t*)"Defragmenting %s.", fileName);
+        row++;
+
+        if (systemFsDefrag(fileName, &inodeNumber, Report) == SYSCALL_FAIL)
+        {
+            printf(COLOR_RED, row++, column, (uint8_t*)"Not a file that can be moved.");
+        }
+        else
+        {
+            printf(COLOR_LIGHT_BLUE, row++, column, (uint8_t*)"Blocks: %d", Report->blocks);
+            printf(COLOR_LIGHT_BLUE, row++, column, (uint8_t*)"Fragments before: %d   after: %d", Report->fragmentsBefore, Report->fragmentsAfter);
+        }
+    }
+    else
+    {
+        uint32_t files = 0;
+        uint32_t filesMoved = 0;
+        uint32_t blocksMoved = 0;
+        uint32_t fragmentsBefore = 0;
+        uint32_t fragmentsAfter = 0;
+
+        printf(COLOR_GREEN, row++, column, (uint8_t*)"Defragmenting every file (defrag <file> for one).");
+        row++;
+
+        while (systemFsDefrag(0, &inodeNumber, Report) != SYSCALL_FAIL)
+        {
+            files++;
+            fragmentsBefore = fragmentsBefore + Report->fragmentsBefore;
+            fragmentsAfter = fragmentsAfter + Report->fragmentsAfter;
+
+            // Only the files that were in pieces are worth a line
+            if (Report->fragmentsBefore > 1)
+            {
+                filesMoved = filesMoved + (Report->blocksMoved != 0);
+                blocksMoved = blocksMoved + Report->blocksMoved;
+
+                if (row < DEFRAG_LAST_FILE_ROW)
+                {
+                    printf(COLOR_WHITE, row++, column, (uint8_t*)"Inode %d: %d blocks, %d fragments -> %d", inodeNumber, Report->blocks, Report->fragmentsBefore, Report->fragmentsAfter);
+                }
+            }
+
+            inodeNumber++;
+        }
+
+        row++;
+        printf(COLOR_LIGHT_BLUE, row++, column, (uint8_t*)"Files: %d   Moved: %d   Blocks moved: %d", files, filesMoved, blocksMoved);
+        printf(COLOR_LIGHT_BLUE, row++, column, (uint8_t*)"Fragments before: %d   after: %d", fragmentsBefore, fragmentsAfter);
+    }
+
+    free((uint8_t *)Report);
+
+    row+= 2;
+    printf(COLOR_WHITE, row++, column, (uint8_t*)"Press Enter to quit.");
+
+    waitForEnterOrQuit();
+    systemExit(PROCESS_EXIT_CODE_SUCCESS);
+}
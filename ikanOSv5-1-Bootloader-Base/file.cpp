@@ -36,7 +36,7 @@ void createOpenFileTable(uint8_t *openFileTable)
     GlobalObjectTableEntry->userspaceBuffer = (uint8_t*)STDERR_BUFFER;
 
     uint8_t *message = (uint8_t*)"This is the default initialization message when STDERR is first initialized";
-    memoryCopy(message, (uint8_t*)STDERR_BUFFER, ceiling(strlen(message), 2));  
+    bytecpyToProtectedMem((uint8_t*)STDERR_BUFFER, message, strlen(message) + 1);
 
     while (!releaseLock(KERNEL_OWNED, (uint8_t *)GLOBAL_OBJECT_TABLE)) {}
 
@@ -36,6 +36,76 @@ struct fileParameter
     uint8_t *fileName;
 };
 
+/**
+ * The I/O parameter structure. This is used to pass a buffer and length, or a seek, to the offset based file sysCalls.
+ */
+struct ioParameter
+{
+    /** The file descriptor to read, write or seek. */
+    uint32_t fileDescriptor;
+    /** The user space buffer to read into or write from. */
+    uint8_t *buffer;
+    /** The number of bytes to read or write. */
+    uint32_t length;
+    /** The seek distance in bytes. Can be negative for SEEK_CUR and SEEK_END. */
+    int offset;
+    /** Where the seek is measured from. Can be SEEK_SET, SEEK_CUR or SEEK_END. */
+    uint32_t whence;
+};
+
+/**
+ * The sendfile parameter structure. This is used to pass a file, a socket and a byte range to sysSendfile().
+ */
+struct sendfileParameter
+{
+    /** The open file to send from. */
+    uint32_t fileDescriptor;
+    /** The network pipe (socket) to send to. */
+    uint32_t socketDescriptor;
+    /** Where in the file to start. */
+    uint32_t offset;
+    /** The number of bytes to send. */
+    uint32_t length;
+};
+
+/**
+ * The file system check parameter structure. This is used to pass the repair choice and a report to fill in to sysFsCheck().
+ */
+struct fsCheckParameter
+{
+    /** Non-zero to repair what can be repaired, 0 to only look. */
+    uint32_t repair;
+    /** Where to put the results. */
+    struct fsCheckReport *report;
+};
+
+/**
+ * The defragment parameter structure. This is used to pass the file to move and the report to fill in to sysFsDefrag().
+ */
+struct fsDefragParameter
+{
+    /** The file to move, in the working directory. 0 to move the next file from inodeNumber on instead. */
+    uint8_t *fileName;
+    /** Where to start looking when there is no fileName. Set to the inode that was moved. */
+    uint32_t inodeNumber;
+    /** Where to put the results. */
+    struct fsDefragReport *report;
+};
+
+/**
+ * The directory listing parameter structure. This is used to pass a batch of entries to fill in to sysGetDirectoryEntries().
+ */
+struct directoryListingParameter
+{
+    /** The directory to read, in the working directory. 0 for the working directory itself. */
+    uint8_t *directoryName;
+    /** Where to pick up, 0 for the first entry. Moved past the entries read. */
+    uint32_t position;
+    struct directoryListingEntry *entries;
+    /** The number of entries there is room for. */
+    uint32_t maxEntries;
+};
+
 /**
  * The global object table entry. This is used to track open objects in the kernel.
  */
@@ -65,9 +135,9 @@ struct globalObjectTableEntry
     uint8_t *kernelSpaceBuffer; 
     /** The name. */
     uint8_t *name; 
-    /** The current byte offset into the buffer, used for modification and the editor. */
+    /** The current byte offset into the buffer, used for modification and the editor. For streamed files, the next byte SYS_READ_FILE returns. */
     uint32_t readOffset;
-    /** The current byte offset into the buffer, used for modification and the editor. */
+    /** The current byte offset into the buffer, used for modification and the editor. For streamed files, where SYS_WRITE_FILE writes next. */
     uint32_t writeOffset;
     /** Is this file locked for writing (i.e., opened with RDWRITE permissions). The value is the PID that has it locked */
     uint32_t lockedForWriting; 
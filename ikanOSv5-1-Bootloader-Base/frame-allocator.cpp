@@ -5,6 +5,8 @@
 #include "vm.h"
 #include "constants.h"
 #include "libc-main.h"
+#include "x86.h"
+#include "frame-allocator.h"
 
 void createPageFrameMap(uint8_t *pageFrameMap, uint32_t numberOfFrames)
 {
@@ -20,57 +22,387 @@ uint32_t allocateFrame(uint32_t pid, uint8_t *pageFrameMap)
 
 }
 
-void freeFrame(uint32_t frameNumber)
+void pageFrameIndexBuild(uint8_t *pageFrameMap, uint32_t numberOfFrames)
 {
-    while (!acquireLock(KERNEL_OWNED, (uint8_t *)PAGEFRAME_MAP_BASE)) {}
-    
-    *(uint8_t *)(PAGEFRAME_MAP_BASE + frameNumber) = (uint8_t)0x0;
+    uint32_t framesUsed = 0;
 
-    while (!releaseLock(KERNEL_OWNED, (uint8_t *)PAGEFRAME_MAP_BASE)) {}
+    for (uint32_t word = 0; word < PAGEFRAME_BITMAP_WORDS; word++)
+    {
+        PAGEFRAME_FREE_BITMAP[word] = 0;
+    }
+
+    for (uint32_t owner = 0; owner < PAGEFRAME_OWNERS; owner++)
+    {
+        PAGEFRAME_OWNER_COUNTS[owner] = 0;
+    }
+
+    fillMemory(PAGEFRAME_CPU_CACHES, 0x0, sizeof(struct frameCache) * PAGEFRAME_CPUS);
+    fillMemory(PAGEFRAME_SHARE_COUNTS, 0x0, PAGEFRAME_MAP_SIZE);
+    fillMemory((uint8_t *)ZERO_POOL_PAGE_TABLE, 0x0, PAGE_SIZE);
+    storeValueAtMemLoc((uint8_t *)ZERO_POOL_COUNT, 0);
+
+    for (uint32_t frameNumber = 0; frameNumber < numberOfFrames && frameNumber < PAGEFRAME_MAP_SIZE; frameNumber++)
+    {
+        uint8_t owner = *(uint8_t *)(pageFrameMap + frameNumber);
+
+        if (owner == PAGEFRAME_AVAILABLE)
+        {
+            PAGEFRAME_FREE_BITMAP[frameNumber / 32] |= (1u << (frameNumber % 32));
+        }
+        else
+        {
+            PAGEFRAME_OWNER_COUNTS[owner]++;
+            framesUsed++;
+        }
+    }
+
+    *(uint32_t *)PAGEFRAME_SEARCH_CURSOR = 0;
+    *(uint32_t *)PAGEFRAME_FRAMES_USED = framesUsed;
 }
 
 
-void freeAllFrames(uint32_t pid, uint8_t *pageFrameMap)
+uint32_t pageFrameClaim(uint32_t pid, uint8_t *pageFrameMap)
 {
+    uint32_t cursor = *(uint32_t *)PAGEFRAME_SEARCH_CURSOR;
 
-    // ASSIGNMENT 3 TO DO
+    // Start where the last frame came from and wrap, 32 frames per look
+    for (uint32_t wordsChecked = 0; wordsChecked < PAGEFRAME_BITMAP_WORDS; wordsChecked++)
+    {
+        uint32_t word = (cursor + wordsChecked) % PAGEFRAME_BITMAP_WORDS;
+        uint32_t freeBits = PAGEFRAME_FREE_BITMAP[word];
+
+        if (freeBits == 0)
+        {
+            continue;
+        }
+
+        uint32_t bit = __builtin_ctz(freeBits);
+        uint32_t frameNumber = (word * 32) + bit;
+
+        PAGEFRAME_FREE_BITMAP[word] = freeBits & ~(1u << bit);
+        *(uint8_t *)(pageFrameMap + frameNumber) = (uint8_t)pid;
+        atomicAdd(&PAGEFRAME_OWNER_COUNTS[(uint8_t)pid], 1);
+        atomicAdd((uint32_t *)PAGEFRAME_FRAMES_USED, 1);
+
+        // Leave the cursor on this word, it may still have free frames
+        *(uint32_t *)PAGEFRAME_SEARCH_CURSOR = word;
+
+        return frameNumber;
+    }
+
+    return 0;
 }
 
-uint32_t processFramesUsed(uint32_t pid, uint8_t *pageFrameMap)
+
+void pageFrameRelease(uint32_t frameNumber, uint8_t *pageFrameMap)
 {
-    uint8_t lastUsedFrame = PAGEFRAME_AVAILABLE;
-    uint32_t framesUsed = 0;
+    if (frameNumber >= PAGEFRAME_MAP_SIZE)
+    {
+        return;
+    }
+
+    uint8_t owner = *(uint8_t *)(pageFrameMap + frameNumber);
+
+    if (owner == PAGEFRAME_AVAILABLE)
+    {
+        return;
+    }
+
+    *(uint8_t *)(pageFrameMap + frameNumber) = (uint8_t)PAGEFRAME_AVAILABLE;
+    PAGEFRAME_FREE_BITMAP[frameNumber / 32] |= (1u << (frameNumber % 32));
+    atomicAdd(&PAGEFRAME_OWNER_COUNTS[owner], (uint32_t)-1);
+    atomicAdd((uint32_t *)PAGEFRAME_FRAMES_USED, (uint32_t)-1);
+}
+
+
+struct frameCache *currentFrameCache()
+{
+    return (struct frameCache *)PAGEFRAME_CPU_CACHES + (currentCpu() % PAGEFRAME_CPUS);
+}
+
 
-    for (uint32_t frameNumber = 0; frameNumber < (KERNEL_BASE / PAGE_SIZE); frameNumber++)
+uint32_t allocateCachedFrame(uint32_t pid)
+{
+    // Syscalls and faults run with interrupts off, so nothing else on this CPU touches its cache
+    struct frameCache *FrameCache = currentFrameCache();
+
+    if (FrameCache->count == 0)
     {
-        lastUsedFrame = *(uint8_t *)(pageFrameMap + frameNumber);
+        FrameCache->misses++;
+
+        while (!acquireLock(KERNEL_OWNED, (uint8_t *)PAGEFRAME_MAP_BASE)) {}
 
-        if (lastUsedFrame == pid)
+        while (FrameCache->count < PAGEFRAME_CPU_CACHE_BATCH)
         {
-            framesUsed++;      
+            uint32_t frameNumber = pageFrameClaim(PAGEFRAME_CPU_CACHED, (uint8_t *)PAGEFRAME_MAP_BASE);
+
+            if (frameNumber == 0)
+            {
+                break;
+            }
+
+            FrameCache->frames[FrameCache->count++] = frameNumber;
         }
 
+        while (!releaseLock(KERNEL_OWNED, (uint8_t *)PAGEFRAME_MAP_BASE)) {}
+
+        // Out of memory except for what the zero pool is holding
+        if (FrameCache->count == 0)
+        {
+            return allocateZeroedFrame(pid);
+        }
+    }
+    else
+    {
+        FrameCache->hits++;
     }
-    return (unsigned int)framesUsed;
 
+    uint32_t frameNumber = FrameCache->frames[--FrameCache->count];
+
+    *(uint8_t *)(PAGEFRAME_MAP_BASE + frameNumber) = (uint8_t)pid;
+    atomicAdd(&PAGEFRAME_OWNER_COUNTS[PAGEFRAME_CPU_CACHED], (uint32_t)-1);
+    atomicAdd(&PAGEFRAME_OWNER_COUNTS[(uint8_t)pid], 1);
+
+    return frameNumber;
 }
 
-uint32_t totalFramesUsed(uint8_t *pageFrameMap)
+
+void drainFrameCache(uint32_t framesToKeep)
 {
-    uint8_t lastUsedFrame = PAGEFRAME_AVAILABLE;
-    uint32_t framesUsed = 0;
+    struct frameCache *FrameCache = currentFrameCache();
+
+    while (!acquireLock(KERNEL_OWNED, (uint8_t *)PAGEFRAME_MAP_BASE)) {}
+
+    while (FrameCache->count > framesToKeep)
+    {
+        pageFrameRelease(FrameCache->frames[--FrameCache->count], (uint8_t *)PAGEFRAME_MAP_BASE);
+    }
+
+    while (!releaseLock(KERNEL_OWNED, (uint8_t *)PAGEFRAME_MAP_BASE)) {}
+}
+
 
-    for (uint32_t frameNumber = 0; frameNumber < PAGEFRAME_MAP_SIZE; frameNumber++)
+void freeFrame(uint32_t frameNumber)
+{
+    // Frame 0 is what an empty page table entry points to, never a real allocation
+    if (frameNumber == 0 || frameNumber >= PAGEFRAME_MAP_SIZE)
+    {
+        return;
+    }
+
+    uint8_t owner = *(uint8_t *)(PAGEFRAME_MAP_BASE + frameNumber);
+
+    if (owner == PAGEFRAME_AVAILABLE || owner == PAGEFRAME_CPU_CACHED)
+    {
+        return;
+    }
+
+    // Another process still maps a copy-on-write frame, so this only drops one reference
+    if (owner == PAGEFRAME_SHARED)
+    {
+        pageFrameDropSharer(frameNumber);
+        return;
+    }
+
+    struct frameCache *FrameCache = currentFrameCache();
+
+    // A full cache gives half back so the next few frees and allocations both stay local
+    if (FrameCache->count == PAGEFRAME_CPU_CACHE_SIZE)
     {
-        lastUsedFrame = *(uint8_t *)(pageFrameMap + frameNumber);
+        FrameCache->spills++;
+        drainFrameCache(PAGEFRAME_CPU_CACHE_SIZE - PAGEFRAME_CPU_CACHE_BATCH);
+    }
+
+    *(uint8_t *)(PAGEFRAME_MAP_BASE + frameNumber) = (uint8_t)PAGEFRAME_CPU_CACHED;
+    atomicAdd(&PAGEFRAME_OWNER_COUNTS[owner], (uint32_t)-1);
+    atomicAdd(&PAGEFRAME_OWNER_COUNTS[PAGEFRAME_CPU_CACHED], 1);
+
+    FrameCache->frames[FrameCache->count++] = frameNumber;
+}
+
 
-        if (lastUsedFrame != PAGEFRAME_AVAILABLE)
+void pageFrameAddSharer(uint32_t frameNumber)
+{
+    while (!acquireLock(KERNEL_OWNED, (uint8_t *)PAGEFRAME_MAP_BASE)) {}
+
+    uint8_t owner = *(uint8_t *)(PAGEFRAME_MAP_BASE + frameNumber);
+
+    // The first time a frame is shared its owner becomes the first of the sharers
+    if (owner != PAGEFRAME_SHARED)
+    {
+        *(uint8_t *)(PAGEFRAME_MAP_BASE + frameNumber) = (uint8_t)PAGEFRAME_SHARED;
+        atomicAdd(&PAGEFRAME_OWNER_COUNTS[owner], (uint32_t)-1);
+        atomicAdd(&PAGEFRAME_OWNER_COUNTS[PAGEFRAME_SHARED], 1);
+        PAGEFRAME_SHARE_COUNTS[frameNumber] = 1;
+    }
+
+    PAGEFRAME_SHARE_COUNTS[frameNumber]++;
+
+    while (!releaseLock(KERNEL_OWNED, (uint8_t *)PAGEFRAME_MAP_BASE)) {}
+}
+
+
+void pageFrameDropSharer(uint32_t frameNumber)
+{
+    while (!acquireLock(KERNEL_OWNED, (uint8_t *)PAGEFRAME_MAP_BASE)) {}
+
+    if (PAGEFRAME_SHARE_COUNTS[frameNumber] != 0)
+    {
+        PAGEFRAME_SHARE_COUNTS[frameNumber]--;
+
+        if (PAGEFRAME_SHARE_COUNTS[frameNumber] == 0)
         {
-            framesUsed++;
-            
+            pageFrameRelease(frameNumber, (uint8_t *)PAGEFRAME_MAP_BASE);
         }
+    }
+
+    while (!releaseLock(KERNEL_OWNED, (uint8_t *)PAGEFRAME_MAP_BASE)) {}
+}
+
+
+bool pageFrameClaimShared(uint32_t frameNumber, uint32_t pid)
+{
+    bool claimed = false;
+
+    while (!acquireLock(KERNEL_OWNED, (uint8_t *)PAGEFRAME_MAP_BASE)) {}
+
+    if (*(uint8_t *)(PAGEFRAME_MAP_BASE + frameNumber) == PAGEFRAME_SHARED && PAGEFRAME_SHARE_COUNTS[frameNumber] == 1)
+    {
+        *(uint8_t *)(PAGEFRAME_MAP_BASE + frameNumber) = (uint8_t)pid;
+        atomicAdd(&PAGEFRAME_OWNER_COUNTS[PAGEFRAME_SHARED], (uint32_t)-1);
+        atomicAdd(&PAGEFRAME_OWNER_COUNTS[(uint8_t)pid], 1);
+        PAGEFRAME_SHARE_COUNTS[frameNumber] = 0;
+        claimed = true;
+    }
 
+    while (!releaseLock(KERNEL_OWNED, (uint8_t *)PAGEFRAME_MAP_BASE)) {}
+
+    return claimed;
+}
+
+
+uint32_t pageFrameOwner(uint32_t frameNumber)
+{
+    if (frameNumber >= PAGEFRAME_MAP_SIZE)
+    {
+        return KERNEL_OWNED;
+    }
+
+    return *(uint8_t *)(PAGEFRAME_MAP_BASE + frameNumber);
+}
+
+
+bool zeroPoolRefill()
+{
+    if (readValueFromMemLoc((uint8_t *)ZERO_POOL_COUNT) >= ZERO_POOL_SIZE)
+    {
+        return false;
+    }
+
+    while (!acquireLock(KERNEL_OWNED, (uint8_t *)PAGEFRAME_MAP_BASE)) {}
+    uint32_t frameNumber = pageFrameClaim(PAGEFRAME_ZERO_POOL, (uint8_t *)PAGEFRAME_MAP_BASE);
+    while (!releaseLock(KERNEL_OWNED, (uint8_t *)PAGEFRAME_MAP_BASE)) {}
+
+    if (frameNumber == 0)
+    {
+        return false;
     }
-    return (uint32_t)framesUsed;
 
+    // The frame isn't mapped anywhere, so each CPU clears it through its own page of the window
+    uint32_t slot = currentCpu() % PAGEFRAME_CPUS;
+    uint8_t *window = (uint8_t *)(ZERO_POOL_WINDOW + (slot * PAGE_SIZE));
+
+    ZERO_POOL_PAGE_TABLE[slot] = (frameNumber * PAGE_SIZE) | PG_KERNEL_PRESENT_RW;
+    invalidatePage(window);
+
+    zeroPage(window);
+
+    ZERO_POOL_PAGE_TABLE[slot] = 0;
+    invalidatePage(window);
+
+    while (!acquireLock(KERNEL_OWNED, (uint8_t *)ZERO_POOL_COUNT)) {}
+
+    uint32_t count = readValueFromMemLoc((uint8_t *)ZERO_POOL_COUNT);
+    bool added = (count < ZERO_POOL_SIZE);
+
+    if (added)
+    {
+        ZERO_POOL_FRAMES[count] = frameNumber;
+        storeValueAtMemLoc((uint8_t *)ZERO_POOL_COUNT, count + 1);
+    }
+
+    while (!releaseLock(KERNEL_OWNED, (uint8_t *)ZERO_POOL_COUNT)) {}
+
+    // The other CPU filled the last slot first
+    if (!added)
+    {
+        while (!acquireLock(KERNEL_OWNED, (uint8_t *)PAGEFRAME_MAP_BASE)) {}
+        pageFrameRelease(frameNumber, (uint8_t *)PAGEFRAME_MAP_BASE);
+        while (!releaseLock(KERNEL_OWNED, (uint8_t *)PAGEFRAME_MAP_BASE)) {}
+    }
+
+    return added;
+}
+
+
+uint32_t allocateZeroedFrame(uint32_t pid)
+{
+    while (!acquireLock(KERNEL_OWNED, (uint8_t *)ZERO_POOL_COUNT)) {}
+
+    uint32_t count = readValueFromMemLoc((uint8_t *)ZERO_POOL_COUNT);
+    uint32_t frameNumber = 0;
+
+    if (count != 0)
+    {
+        frameNumber = ZERO_POOL_FRAMES[count - 1];
+        storeValueAtMemLoc((uint8_t *)ZERO_POOL_COUNT, count - 1);
+    }
+
+    while (!releaseLock(KERNEL_OWNED, (uint8_t *)ZERO_POOL_COUNT)) {}
+
+    if (frameNumber == 0)
+    {
+        return 0;
+    }
+
+    *(uint8_t *)(PAGEFRAME_MAP_BASE + frameNumber) = (uint8_t)pid;
+    atomicAdd(&PAGEFRAME_OWNER_COUNTS[PAGEFRAME_ZERO_POOL], (uint32_t)-1);
+    atomicAdd(&PAGEFRAME_OWNER_COUNTS[(uint8_t)pid], 1);
+
+    return frameNumber;
+}
+
+
+void freeAllFrames(uint32_t pid, uint8_t *pageFrameMap)
+{
+
+    // ASSIGNMENT 3 TO DO
+}
+
+uint32_t processFramesUsed(uint32_t pid, uint8_t *pageFrameMap)
+{
+    // Kept up to date by pageFrameClaim() and pageFrameRelease()
+    return PAGEFRAME_OWNER_COUNTS[(uint8_t)pid];
+
+}
+
+uint32_t totalFramesUsed(uint8_t *pageFrameMap)
+{
+    // Frames waiting in the CPU caches or the zero pool are free as far as anyone asking is concerned
+    return *(uint32_t *)PAGEFRAME_FRAMES_USED - PAGEFRAME_OWNER_COUNTS[PAGEFRAME_CPU_CACHED] - PAGEFRAME_OWNER_COUNTS[PAGEFRAME_ZERO_POOL];
+
+}
+
+void frameCacheStats(uint32_t *hits, uint32_t *misses)
+{
+    struct frameCache *FrameCache = (struct frameCache *)PAGEFRAME_CPU_CACHES;
+
+    *hits = 0;
+    *misses = 0;
+
+    for (uint32_t cpu = 0; cpu < PAGEFRAME_CPUS; cpu++)
+    {
+        *hits = *hits + FrameCache[cpu].hits;
+        *misses = *misses + FrameCache[cpu].misses;
+    }
 }
\ No newline at end of file
@@ -4,36 +4,124 @@
 // 12/2025 with Grok v4.
 
 
+#include "constants.h"
+
+/**
+ * A CPU's own stack of free frames. Allocations and frees on that CPU go here first and only
+ * take the page frame map lock to move PAGEFRAME_CPU_CACHE_BATCH frames at a time.
+ */
+struct frameCache {
+    uint32_t count;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t spills;
+    uint32_t frames[PAGEFRAME_CPU_CACHE_SIZE];
+};
+
 /** Creates the initial structure of the page frame map.
  * \param pageFrameMap The pointer to the beginning of the map.
  * \param numberOfFrame How many frames to create. 
  */
 void createPageFrameMap(uint8_t *pageFrameMap, uint32_t numberOfFrames);
 
+/** Builds the free bitmap and the per-owner frame counts from the page frame map. Run it once the map is created.
+ * \param pageFrameMap The pointer to the beginning of the map.
+ * \param numberOfFrames How many frames are in the map.
+ */
+void pageFrameIndexBuild(uint8_t *pageFrameMap, uint32_t numberOfFrames);
+
+/** Takes the next free frame after the search cursor for a pid and returns the frame number, or 0 if memory is full.
+ * The caller holds the PAGEFRAME_MAP_BASE lock. allocateFrame() should get its frames here so the bitmap and counts stay in step with the map.
+ * \param pid The pid who is requesting the frame.
+ * \param pageFrameMap The pointer to the beginning of the map.
+ */
+uint32_t pageFrameClaim(uint32_t pid, uint8_t *pageFrameMap);
+
+/** Returns a frame to the free bitmap and takes it off its owner's count. The caller holds the PAGEFRAME_MAP_BASE lock.
+ * freeAllFrames() should give frames back here.
+ * \param frameNumber The frame to free.
+ * \param pageFrameMap The pointer to the beginning of the map.
+ */
+void pageFrameRelease(uint32_t frameNumber, uint8_t *pageFrameMap);
+
 /** Allocates a frame in the page frame map and returns the frame number.
  * \param pid The pid who is requesting the frame.
  * \param pageFrameMap The pointer to the beginning of the map.
  */
 uint32_t allocateFrame(uint32_t pid, uint8_t *pageFrameMap);
 
-/** Frees a frame in the page frame map.
+/** Returns the frame cache of the CPU running this code.
+ */
+struct frameCache *currentFrameCache();
+
+/** Allocates a frame from this CPU's frame cache, refilling the cache from the page frame map when it is empty.
+ * Returns the frame number, or 0 if memory is full.
+ * \param pid The pid who is requesting the frame.
+ */
+uint32_t allocateCachedFrame(uint32_t pid);
+
+/** Gives frames in this CPU's frame cache back to the page frame map.
+ * \param framesToKeep How many frames the cache keeps.
+ */
+void drainFrameCache(uint32_t framesToKeep);
+
+/** Frees a frame into this CPU's frame cache. A full cache gives a batch back to the page frame map first.
+ * A copy-on-write frame only loses one sharer.
  * \param frameNumber The frame to free.
  */
 void freeFrame(uint32_t frameNumber);
 
+/** Adds a process to the sharers of a copy-on-write frame. The first call moves the frame to the PAGEFRAME_SHARED owner
+ * with its old owner as the first sharer.
+ * \param frameNumber The frame being shared.
+ */
+void pageFrameAddSharer(uint32_t frameNumber);
+
+/** Drops one sharer of a copy-on-write frame, freeing the frame when nobody maps it any more.
+ * \param frameNumber The shared frame.
+ */
+void pageFrameDropSharer(uint32_t frameNumber);
+
+/** Hands a copy-on-write frame back to a pid as its own if that pid is the last one sharing it. Returns true if it did.
+ * \param frameNumber The shared frame.
+ * \param pid The pid that is writing to it.
+ */
+bool pageFrameClaimShared(uint32_t frameNumber, uint32_t pid);
+
+/** Returns the owner byte of a frame. Frames past the end of the map count as KERNEL_OWNED.
+ * \param frameNumber The frame you are interested in.
+ */
+uint32_t pageFrameOwner(uint32_t frameNumber);
+
+/** Zero fills one free frame and adds it to the zero pool. Called from the application processor idle loop with interrupts off.
+ * Returns false if the pool is already full or there are no free frames.
+ */
+bool zeroPoolRefill();
+
+/** Takes an already zero filled frame from the zero pool. Returns 0 if the pool is empty.
+ * \param pid The pid that will own the frame.
+ */
+uint32_t allocateZeroedFrame(uint32_t pid);
+
 /** Frees all frames for a particular pid.
  * \param pid The pid associated with the frames we are want freed.
  * \param pageFrameMap The pointer to the beginning of the map.
  */
 void freeAllFrames(uint32_t pid, uint8_t *pageFrameMap);
 
-/** Counts the number of frames used by a particular process. Returns the number of frames used by that pid.
+/** Returns the number of frames owned by a particular process from the running count.
  * \param pid The pid you are interested in.
  * \param pageFrameMap The pointer to the beginning of the map.
  */
 uint32_t processFramesUsed(uint32_t pid, uint8_t *pageFrameMap);
 
-/** Counts the total frames used in the system. Returns that value.
+/** Returns the total frames used in the system from the running count.
  * \param pageFrameMap The pointer to the beginning of the map.
  */
-uint32_t totalFramesUsed(uint8_t *pageFrameMap);
\ No newline at end of file
+uint32_t totalFramesUsed(uint8_t *pageFrameMap);
+
+/** Adds up the frame cache hits and misses of every CPU.
+ * \param hits Where to store the allocations served from a cache.
+ * \param misses Where to store the allocations that had to refill a cache.
+ */
+void frameCacheStats(uint32_t *hits, uint32_t *misses);
\ No newline at end of file
@@ -0,0 +1,507 @@
+// Copyright (c) 2023-2026 Dan O’Malley
+// This file is licensed under the MIT License. See LICENSE for details.
+
+
+#include "constants.h"
+#include "libc-main.h"
+#include "fs.h"
+#include "file.h"
+#include "vm.h"
+#include "journal.h"
+#include "exceptions.h"
+
+// fs-bench runs the kernel's EXT2 code as an ordinary 32-bit Linux program. fs.o, journal.o, libc-main.o
+// and x86.o are the exact objects linked into the kernel. This file supplies a block device backed by an
+// image file, the few kernel services the file system calls, and Linux system calls made with int 0x80
+// so no host libc is needed. The kernel's fixed memory locations are mapped with mmap at the same
+// addresses, so nothing in fs.cpp has to know it is not running on ikanOS.
+//
+// Usage: make fs-bench-run
+// The target copies the EXT2 half of fs.img to fsbench.img, runs the benchmarks on it and then checks it
+// with e2fsck -n. Directory reads go through loadFileFromInodeStruct(), which is assignment 2, so the bench
+// brings its own and the Makefile weakens the one in its copy of fs.o. Every round runs on every tree.
+
+#define FS_BENCH_IMAGE "fsbench.img"
+#define FS_BENCH_FILES 32
+#define FS_BENCH_ROUNDS 4
+#define FS_BENCH_FILE_PAGES 1
+#define FS_BENCH_PID 1
+#define FS_BENCH_DEFRAG_FILES 2
+#define FS_BENCH_DEFRAG_BLOCKS 20 // Past the direct blocks, so the indirect block moves too
+#define FS_BENCH_MAP_START 0x10000 // Lowest address Linux lets us map on most systems
+
+#define LINUX_SYS_EXIT_GROUP 252
+#define LINUX_SYS_WRITE 4
+#define LINUX_SYS_OPEN 5
+#define LINUX_SYS_CLOSE 6
+#define LINUX_SYS_MMAP 90
+#define LINUX_SYS_PREAD64 180
+#define LINUX_SYS_PWRITE64 181
+#define LINUX_SYS_CLOCK_GETTIME 265
+#define LINUX_O_RDWR 2
+#define LINUX_PROT_READ_WRITE 3
+#define LINUX_MAP_PRIVATE_ANONYMOUS_FIXED 0x32
+#define LINUX_CLOCK_MONOTONIC 1
+#define LINUX_STDOUT 1
+
+struct linuxMmapArguments
+{
+    uint32_t address;
+    uint32_t length;
+    uint32_t protection;
+    uint32_t flags;
+    uint32_t fileDescriptor;
+    uint32_t offset;
+};
+
+struct linuxTimespec
+{
+    uint32_t seconds;
+    uint32_t nanoseconds;
+};
+
+uint32_t imageFileDescriptor = 0;
+uint32_t sectorsRead = 0;
+uint32_t sectorsWritten = 0;
+uint8_t benchPage[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+uint8_t benchWriteBuffer[FS_BENCH_FILE_PAGES * PAGE_SIZE];
+uint8_t benchReadBuffer[FS_BENCH_FILE_PAGES * PAGE_SIZE];
+uint8_t benchFileNames[FS_BENCH_FILES][16];
+struct globalObjectTableEntry benchOpenFile;
+
+
+uint32_t linuxSysCall(uint32_t number, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5)
+{
+    uint32_t result;
+
+    asm volatile ("int $0x80" : "=a" (result) : "a" (number), "b" (arg1), "c" (arg2), "d" (arg3), "S" (arg4), "D" (arg5) : "memory");
+
+    return result;
+}
+
+void benchPrint(uint8_t *message)
+{
+    linuxSysCall(LINUX_SYS_WRITE, LINUX_STDOUT, (uint32_t)message, strlen(message), 0, 0);
+}
+
+void benchPrintNumber(uint32_t number)
+{
+    uint8_t numberString[12];
+    itoa(number, numberString);
+    benchPrint(numberString);
+}
+
+void benchExit(uint32_t exitCode)
+{
+    linuxSysCall(LINUX_SYS_EXIT_GROUP, exitCode, 0, 0, 0, 0);
+}
+
+uint32_t benchMicroseconds()
+{
+    struct linuxTimespec now;
+    linuxSysCall(LINUX_SYS_CLOCK_GETTIME, LINUX_CLOCK_MONOTONIC, (uint32_t)&now, 0, 0, 0);
+
+    return (now.seconds * 1000000) + (now.nanoseconds / 1000);
+}
+
+// The EXT2 file system starts EXT2_SECTOR_START sectors into fs.img. The bench image is only the
+// file system so e2fsck can check it directly.
+void imageReadSector(uint32_t sectorNumber, uint8_t *destinationMemory)
+{
+    sectorsRead++;
+    linuxSysCall(LINUX_SYS_PREAD64, imageFileDescriptor, (uint32_t)destinationMemory, SECTOR_SIZE, (sectorNumber - EXT2_SECTOR_START) * SECTOR_SIZE, 0);
+}
+
+void imageWriteSector(uint32_t sectorNumber, uint8_t *sourceMemory)
+{
+    sectorsWritten++;
+    linuxSysCall(LINUX_SYS_PWRITE64, imageFileDescriptor, (uint32_t)sourceMemory, SECTOR_SIZE, (sectorNumber - EXT2_SECTOR_START) * SECTOR_SIZE, 0);
+}
+
+struct blockDevice imageBlockDevice = {imageReadSector, imageWriteSector};
+
+// The kernel services fs.cpp calls. The bench is single threaded so locks always succeed,
+// and the only page fs.cpp asks for is a scratch inode buffer in deleteFile().
+bool acquireLock(uint32_t currentPid, uint8_t *memoryLocation)
+{
+    return true;
+}
+
+bool releaseLock(uint32_t currentPid, uint8_t *memoryLocation)
+{
+    return true;
+}
+
+uint8_t *requestAvailablePage(uint32_t pid, uint8_t perms)
+{
+    return benchPage;
+}
+
+void freePage(uint32_t pid, uint8_t *pageToFree)
+{
+}
+
+void fillMemory(uint8_t *memLocation, uint8_t byteToFill, uint32_t numberOfBytes)
+{
+    for (uint32_t x = 0; x < numberOfBytes; x++)
+    {
+        memLocation[x] = byteToFill;
+    }
+}
+
+void readKeyboard(uint8_t *ioMemory)
+{
+}
+
+// Reads a whole file the way assignment 2 does, block by block through the inode's block map.
+// Holes read back as zeros.
+void loadFileFromInodeStruct(uint8_t *inodeStructMemory, uint8_t *fileBuffer, bool cacheActive)
+{
+    struct inode *Inode = (struct inode *)inodeStructMemory;
+    uint8_t indirectBlock[MAX_BLOCK_SIZE];
+
+    for (uint32_t fileBlock = 0; fileBlock < ceiling(Inode->i_size, BLOCK_SIZE); fileBlock++)
+    {
+        uint32_t diskBlock = fileBlockToDiskBlock(Inode, fileBlock, indirectBlock, cacheActive);
+
+        if (diskBlock == 0)
+        {
+            fillMemory(fileBuffer + (fileBlock * BLOCK_SIZE), 0x0, BLOCK_SIZE);
+            continue;
+        }
+
+        readBlock(diskBlock, fileBuffer + (fileBlock * BLOCK_SIZE), cacheActive);
+    }
+}
+
+void panic(uint8_t *message)
+{
+    benchPrint((uint8_t *)"panic: ");
+    benchPrint(message);
+    benchPrint((uint8_t *)"\n");
+    benchExit(1);
+}
+
+void benchReport(uint8_t *name, uint32_t operations, uint32_t failures, uint32_t elapsedMicroseconds)
+{
+    uint32_t productLow, productHigh, opsPerSecond, remainder;
+
+    if (elapsedMicroseconds == 0) { elapsedMicroseconds = 1; }
+
+    // operations * 1000000 / elapsedMicroseconds with a 64 bit product, since there is no libgcc for 64 bit division
+    asm volatile ("mull %3\n\t" : "=a" (productLow), "=d" (productHigh) : "a" (operations), "r" ((uint32_t)1000000) : "cc");
+    asm volatile ("divl %4\n\t" : "=a" (opsPerSecond), "=d" (remainder) : "a" (productLow), "d" (productHigh), "r" (elapsedMicroseconds) : "cc");
+
+    benchPrint(name);
+    benchPrint((uint8_t *)": ");
+    benchPrintNumber(operations);
+    benchPrint((uint8_t *)" ops in ");
+    benchPrintNumber(elapsedMicroseconds);
+    benchPrint((uint8_t *)" us, ");
+    benchPrintNumber(opsPerSecond);
+    benchPrint((uint8_t *)" ops/sec");
+
+    if (failures != 0)
+    {
+        benchPrint((uint8_t *)", ");
+        benchPrintNumber(failures);
+        benchPrint((uint8_t *)" FAILED");
+    }
+
+    benchPrint((uint8_t *)"\n");
+}
+
+void benchFillFile(uint32_t fileNumber)
+{
+    for (uint32_t x = 0; x < FS_BENCH_FILE_PAGES * PAGE_SIZE; x++)
+    {
+        benchOpenFile.userspaceBuffer[x] = (uint8_t)(fileNumber + x);
+    }
+}
+
+int main()
+{
+    struct linuxMmapArguments kernelMemory = {FS_BENCH_MAP_START, KERNEL_LIMIT - FS_BENCH_MAP_START, LINUX_PROT_READ_WRITE, LINUX_MAP_PRIVATE_ANONYMOUS_FIXED, 0xFFFFFFFF, 0};
+    struct blockGroupDescriptor *BlockGroupDescriptor = (struct blockGroupDescriptor *)BLOCK_GROUP_DESCRIPTOR_TABLE;
+    uint32_t totalFailures = 0;
+
+    if (linuxSysCall(LINUX_SYS_MMAP, (uint32_t)&kernelMemory, 0, 0, 0, 0) != FS_BENCH_MAP_START)
+    {
+        benchPrint((uint8_t *)"fs-bench: could not map the kernel memory locations\n");
+        benchExit(2);
+    }
+
+    imageFileDescriptor = linuxSysCall(LINUX_SYS_OPEN, (uint32_t)FS_BENCH_IMAGE, LINUX_O_RDWR, 0, 0, 0);
+    if ((int)imageFileDescriptor < 0)
+    {
+        benchPrint((uint8_t *)"fs-bench: could not open " FS_BENCH_IMAGE "\n");
+        benchExit(2);
+    }
+
+    fsSetBlockDevice(&imageBlockDevice);
+
+    // What the boot loader and kInit() set up before the file system is used
+    readBlock(SUPERBLOCK, SUPERBLOCK_LOC, false);
+    readBlock(GROUP_DESCRIPTOR_BLOCK, BLOCK_GROUP_DESCRIPTOR_TABLE, false);
+    journalInit(true);
+    readBlock(BlockGroupDescriptor->bgd_block_address_of_block_usage, (uint8_t *)EXT2_BLOCK_USAGE_MAP, true);
+    readBlock(BlockGroupDescriptor->bgd_block_address_of_inode_usage, (uint8_t *)EXT2_INODE_USAGE_MAP, true);
+
+    // createFile() writes the buffer behind a file descriptor, so give the bench process one open file
+    struct task *Task = (struct task *)(PROCESS_TABLE_LOC + (TASK_STRUCT_SIZE * (FS_BENCH_PID - 1)));
+    Task->pid = FS_BENCH_PID;
+    Task->fileDescriptor[0] = &benchOpenFile;
+    benchOpenFile.openedByPid = FS_BENCH_PID;
+    benchOpenFile.type = GOTE_TYPE_FILE;
+    benchOpenFile.size = FS_BENCH_FILE_PAGES * PAGE_SIZE;
+    benchOpenFile.numberOfPagesForBuffer = FS_BENCH_FILE_PAGES;
+    benchOpenFile.userspaceBuffer = benchWriteBuffer;
+
+    for (uint32_t file = 0; file < FS_BENCH_FILES; file++)
+    {
+        strcpy(benchFileNames[file], (uint8_t *)"bench");
+        itoa(file, benchFileNames[file] + 5);
+    }
+
+    benchPrint((uint8_t *)"fs-bench: ");
+    benchPrintNumber(FS_BENCH_ROUNDS);
+    benchPrint((uint8_t *)" rounds of ");
+    benchPrintNumber(FS_BENCH_FILES);
+    benchPrint((uint8_t *)" files of ");
+    benchPrintNumber(FS_BENCH_FILE_PAGES * PAGE_SIZE);
+    benchPrint((uint8_t *)" bytes on " FS_BENCH_IMAGE "\n");
+
+    uint32_t createTime = 0, readTime = 0, scanTime = 0, deleteTime = 0;
+    uint32_t createFailures = 0, readFailures = 0, scanFailures = 0, deleteFailures = 0;
+
+    for (uint32_t round = 0; round < FS_BENCH_ROUNDS; round++)
+    {
+        uint32_t start = benchMicroseconds();
+        for (uint32_t file = 0; file < FS_BENCH_FILES; file++)
+        {
+            benchFillFile(file);
+            journalStart(true);
+            createFile(benchFileNames[file], FS_BENCH_PID, 0, true, ROOTDIR_INODE);
+            journalStop(true);
+        }
+        createTime = createTime + (benchMicroseconds() - start);
+
+        start = benchMicroseconds();
+        for (uint32_t file = 0; file < FS_BENCH_FILES; file++)
+        {
+            uint32_t inode = returnInodeofFileName(benchFileNames[file], true, ROOTDIR_INODE);
+            benchFillFile(file);
+
+            if (inode == 0 || readFileAtOffset(inode, 0, benchReadBuffer, sizeof(benchReadBuffer), true) != sizeof(benchReadBuffer))
+            {
+                readFailures++;
+                continue;
+            }
+
+            for (uint32_t x = 0; x < sizeof(benchReadBuffer); x++)
+            {
+                if (benchReadBuffer[x] != benchOpenFile.userspaceBuffer[x])
+                {
+                    readFailures++;
+                    break;
+                }
+            }
+        }
+        readTime = readTime + (benchMicroseconds() - start);
+
+        // Every file looks up every other file, the pattern of a shell walking a directory
+        start = benchMicroseconds();
+        for (uint32_t file = 0; file < FS_BENCH_FILES; file++)
+        {
+            for (uint32_t other = 0; other < FS_BENCH_FILES; other++)
+            {
+                if (!fsFindFile(benchFileNames[other], benchPage, true, ROOTDIR_INODE))
+                {
+                    scanFailures++;
+                }
+            }
+        }
+        scanTime = scanTime + (benchMicroseconds() - start);
+
+        // A file that did not make it into the directory can't be found by anything after this
+        for (uint32_t file = 0; file < FS_BENCH_FILES; file++)
+        {
+            if (returnInodeofFileName(benchFileNames[file], true, ROOTDIR_INODE) == 0)
+            {
+                createFailures++;
+            }
+        }
+
+        start = benchMicroseconds();
+        for (uint32_t file = 0; file < FS_BENCH_FILES; file++)
+        {
+            journalStart(true);
+            deleteFile(benchFileNames[file], FS_BENCH_PID, true, ROOTDIR_INODE);
+            journalStop(true);
+        }
+        deleteTime = deleteTime + (benchMicroseconds() - start);
+
+        for (uint32_t file = 0; file < FS_BENCH_FILES; file++)
+        {
+            if (returnInodeofFileName(benchFileNames[file], true, ROOTDIR_INODE) != 0)
+            {
+                deleteFailures++;
+            }
+        }
+    }
+
+    // The root directory the way a listing reads it, a batch of entries at a time with their inodes
+    struct directoryListingEntry benchListing[DIRECTORY_LISTING_BATCH];
+    uint32_t listEntries = 0, listFailures = 0, listPosition = 0, listBatch = 0;
+    uint32_t start = benchMicroseconds();
+
+    fsLockRead(directoryLock(ROOTDIR_INODE));
+    while ((listBatch = readDirectoryEntries(ROOTDIR_INODE, &listPosition, benchListing, DIRECTORY_LISTING_BATCH, true)) != 0)
+    {
+        for (uint32_t entry = 0; entry < listBatch; entry++)
+        {
+            if (!bitmapTest((uint8_t *)EXT2_INODE_USAGE_MAP, benchListing[entry].inode - 1) || benchListing[entry].linksCount == 0)
+            {
+                listFailures++;
+            }
+        }
+
+        listEntries = listEntries + listBatch;
+    }
+    fsUnlockRead(directoryLock(ROOTDIR_INODE));
+    uint32_t listTime = benchMicroseconds() - start;
+
+    // "." and ".." at least
+    if (listEntries < 2)
+    {
+        listFailures++;
+    }
+
+    // Files grown a block at a time in turn, the way two programs appending at once lay them out. They are
+    // in no directory and are zeroed once checked, so the fsck repair below reclaims them like deleted files.
+    uint32_t defragInodes[FS_BENCH_DEFRAG_FILES];
+    uint8_t defragInodeBuf[INODE_SIZE];
+    struct inode *DefragInode = (struct inode *)defragInodeBuf;
+    struct fsDefragReport DefragReport;
+    uint32_t defragFailures = 0, defragFragmentsBefore = 0, defragFragmentsAfter = 0, defragBlocksMoved = 0;
+
+    for (uint32_t file = 0; file < FS_BENCH_DEFRAG_FILES; file++)
+    {
+        journalStart(true);
+        defragInodes[file] = allocateInode(true);
+        fillMemory(defragInodeBuf, 0x0, INODE_SIZE);
+        DefragInode->i_mode = 0x81b6; // What createFile() gives a file
+        DefragInode->i_links_count = 1;
+        writeInode(defragInodes[file], defragInodeBuf, true);
+        journalStop(true);
+    }
+
+    for (uint32_t block = 0; block < FS_BENCH_DEFRAG_BLOCKS; block++)
+    {
+        for (uint32_t file = 0; file < FS_BENCH_DEFRAG_FILES; file++)
+        {
+            fillMemory(benchWriteBuffer, (uint8_t)((file * FS_BENCH_DEFRAG_BLOCKS) + block + 1), BLOCK_SIZE);
+            journalStart(true);
+            writeFileAtOffset(defragInodes[file], block * BLOCK_SIZE, benchWriteBuffer, BLOCK_SIZE, true);
+            journalStop(true);
+        }
+    }
+
+    start = benchMicroseconds();
+    for (uint32_t file = 0; file < FS_BENCH_DEFRAG_FILES; file++)
+    {
+        if (!fsDefragFile(defragInodes[file], &DefragReport, true) || DefragReport.fragmentsAfter != 1)
+        {
+            defragFailures++;
+        }
+
+        defragFragmentsBefore = defragFragmentsBefore + DefragReport.fragmentsBefore;
+        defragFragmentsAfter = defragFragmentsAfter + DefragReport.fragmentsAfter;
+        defragBlocksMoved = defragBlocksMoved + DefragReport.blocksMoved;
+    }
+    uint32_t defragTime = benchMicroseconds() - start;
+
+    for (uint32_t file = 0; file < FS_BENCH_DEFRAG_FILES; file++)
+    {
+        for (uint32_t block = 0; block < FS_BENCH_DEFRAG_BLOCKS; block++)
+        {
+            readFileAtOffset(defragInodes[file], block * BLOCK_SIZE, benchReadBuffer, BLOCK_SIZE, true);
+
+            if (benchReadBuffer[0] != (uint8_t)((file * FS_BENCH_DEFRAG_BLOCKS) + block + 1) || benchReadBuffer[BLOCK_SIZE - 1] != benchReadBuffer[0])
+            {
+                defragFailures++;
+            }
+        }
+
+        journalStart(true);
+        fillMemory(defragInodeBuf, 0x0, INODE_SIZE);
+        writeInode(defragInodes[file], defragInodeBuf, true);
+        journalStop(true);
+    }
+
+    // Clean up what the rounds left behind, then a second check must find nothing. deleteFile() leaves the
+    // inode bit and the blocks of every file marked, so the repair always has leaked inodes and blocks to reclaim.
+    struct fsCheckReport FsCheckReport;
+    start = benchMicroseconds();
+    fsCheck(&FsCheckReport, true, true);
+    uint32_t fsckTime = benchMicroseconds() - start;
+    uint32_t fsckFound = FsCheckReport.problemsFound;
+    uint32_t fsckRepaired = FsCheckReport.problemsRepaired;
+    uint32_t fsckLeakedBlocks = FsCheckReport.leakedBlocks;
+    uint32_t fsckFailures = fsCheck(&FsCheckReport, false, true);
+
+    // Leave the image the way a clean shutdown would for e2fsck
+    journalCommit(true);
+    diskFlushCache(0, true);
+    linuxSysCall(LINUX_SYS_CLOSE, imageFileDescriptor, 0, 0, 0, 0);
+
+    benchReport((uint8_t *)"create", FS_BENCH_ROUNDS * FS_BENCH_FILES, createFailures, createTime);
+    benchReport((uint8_t *)"read  ", FS_BENCH_ROUNDS * FS_BENCH_FILES, readFailures, readTime);
+    benchReport((uint8_t *)"scan  ", FS_BENCH_ROUNDS * FS_BENCH_FILES * FS_BENCH_FILES, scanFailures, scanTime);
+    benchReport((uint8_t *)"delete", FS_BENCH_ROUNDS * FS_BENCH_FILES, deleteFailures, deleteTime);
+
+    benchReport((uint8_t *)"list  ", listEntries, listFailures, listTime);
+    benchReport((uint8_t *)"defrag", FS_BENCH_DEFRAG_FILES, defragFailures, defragTime);
+    benchReport((uint8_t *)"fsck  ", FsCheckReport.inodesInUse, fsckFailures, fsckTime);
+
+    benchPrint((uint8_t *)"fsck found ");
+    benchPrintNumber(fsckFound);
+    benchPrint((uint8_t *)" problems, repaired ");
+    benchPrintNumber(fsckRepaired);
+    benchPrint((uint8_t *)", reclaimed ");
+    benchPrintNumber(fsckLeakedBlocks);
+    benchPrint((uint8_t *)" leaked blocks\n");
+
+    benchPrint((uint8_t *)"defrag moved ");
+    benchPrintNumber(defragBlocksMoved);
+    benchPrint((uint8_t *)" blocks, fragments ");
+    benchPrintNumber(defragFragmentsBefore);
+    benchPrint((uint8_t *)" -> ");
+    benchPrintNumber(defragFragmentsAfter);
+    benchPrint((uint8_t *)"\n");
+
+    // Every create, delete, defrag and repair above went through a handle. With no journal, or no commit, none of them was logged.
+    uint32_t journalFailures = (journalFileInode() == 0 || *(uint32_t *)KERNEL_JOURNAL_COMMITS == 0) ? 1 : 0;
+
+    benchPrint((uint8_t *)"journal ");
+    benchPrintNumber(*(uint32_t *)KERNEL_JOURNAL_COMMITS);
+    benchPrint((uint8_t *)" commits, ");
+    benchPrintNumber(*(uint32_t *)KERNEL_JOURNAL_BLOCKS_ABSORBED);
+    benchPrint((uint8_t *)" blocks absorbed");
+    if (journalFailures != 0)
+    {
+        benchPrint((uint8_t *)", FAILED, " JOURNAL_FILE_NAME " is missing or never committed");
+    }
+    benchPrint((uint8_t *)"\n");
+
+    benchPrint((uint8_t *)"sectors read ");
+    benchPrintNumber(sectorsRead);
+    benchPrint((uint8_t *)", sectors written ");
+    benchPrintNumber(sectorsWritten);
+    benchPrint((uint8_t *)"\n");
+
+    totalFailures = createFailures + readFailures + scanFailures + deleteFailures + listFailures + defragFailures + fsckFailures + journalFailures;
+    benchExit(totalFailures == 0 ? 0 : 1);
+
+    return 0;
+}
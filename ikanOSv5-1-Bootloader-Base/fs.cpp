@@ -11,16 +11,55 @@
 #include "x86.h"
 #include "vm.h"
 #include "file.h"
+#include "journal.h"
+#include "kernel.h"
 
 uint32_t cacheLRUtime = 0;
+uint32_t cacheCurrentTick = 0;
+uint32_t diskFlusherRunning = 0;
+bool bootTraceRecording = false;
+uint32_t bootTraceInode = 0;
+struct blockDevice ataBlockDevice = {ataReadSector, ataWriteSector};
+struct blockDevice *fsBlockDevice = &ataBlockDevice;
+void (*fsInodeChangedHandler)(uint32_t inodeNumber) = 0;
 
 
+void fsSetBlockDevice(struct blockDevice *BlockDevice)
+{
+    fsBlockDevice = BlockDevice;
+}
+
+void fsSetInodeChangedHandler(void (*InodeChangedHandler)(uint32_t inodeNumber))
+{
+    fsInodeChangedHandler = InodeChangedHandler;
+}
+
+void fsInodeChanged(uint32_t inodeNumber)
+{
+    if (fsInodeChangedHandler != 0 && inodeNumber != 0)
+    {
+        fsInodeChangedHandler(inodeNumber);
+    }
+}
+
+void ataReadSector(uint32_t sectorNumber, uint8_t *destinationMemory)
+{
+
+    // ASSIGNMENT 2 TO DO
+}
+
+void ataWriteSector(uint32_t sectorNumber, uint8_t *sourceMemory)
+{
+
+    // ASSIGNMENT 2 TO DO
+}
+
 void diskReadSector(uint32_t sectorNumber, uint8_t *destinationMemory, bool cacheActive)
 {
     
     if (!cacheActive)
     {
-        // ASSIGNMENT 2 TO DO
+        fsBlockDevice->readSector(sectorNumber, destinationMemory);
     }
     else
     {        
@@ -34,6 +73,8 @@ void diskReadSector(uint32_t sectorNumber, uint8_t *destinationMemory, bool cach
         uint8_t *tempBuffer = 0;
         uint32_t cacheLine;
 
+        while (!acquireLock(KERNEL_OWNED, DISK_READ_CACHE_LOC)) {}
+
         // Check for cache hit
         for (cacheLine = 0; cacheLine < CACHE_SIZE; cacheLine++) 
         {
@@ -44,6 +85,7 @@ void diskReadSector(uint32_t sectorNumber, uint8_t *destinationMemory, bool cach
                 tempBuffer = cacheData + (cacheLine * SECTOR_SIZE);
                 memoryCopy(tempBuffer, destinationMemory, ceiling(SECTOR_SIZE, 2));
                 CacheLineDetail[cacheLine].accessTime = ++cacheLRUtime;
+                while (!releaseLock(KERNEL_OWNED, DISK_READ_CACHE_LOC)) {}
                 return;
             }
         }
@@ -51,49 +93,290 @@ void diskReadSector(uint32_t sectorNumber, uint8_t *destinationMemory, bool cach
         // Record the cache miss
         *(uint32_t*)KERNEL_CACHE_MISSES = ++cacheMisses;
         
-        // Find an invalid slot
-        cacheLine = CACHE_SIZE;
+        cacheLine = cacheAllocateLine();
+
+        // Compute the cache pointer to use to load data not in cache
+        tempBuffer = (uint8_t *)(cacheData + (cacheLine * SECTOR_SIZE));
+
+        // Load with false since we want this to bypass this code or else it is circular
+        diskReadSector(sectorNumber, tempBuffer, false);
+
+        // Update cache info since I just loaded a new cache line with data
+        CacheLineDetail[cacheLine].sector = sectorNumber;
+        CacheLineDetail[cacheLine].valid = 1;
+        CacheLineDetail[cacheLine].dirty = 0;
+        CacheLineDetail[cacheLine].accessTime = ++cacheLRUtime;
+
+        // Copy to destination now that the cache is loaded
+        memoryCopy(tempBuffer, destinationMemory, ceiling(SECTOR_SIZE, 2));
+
+        while (!releaseLock(KERNEL_OWNED, DISK_READ_CACHE_LOC)) {}
+    }
+}
+
+uint32_t cacheAllocateLine()
+{
+    // LRU eviction by Grok, moved out of diskReadSector() so writes can share it.
+    // 12/2025 with Grok v4.
+
+    struct cacheLineDetail *CacheLineDetail = (struct cacheLineDetail *)DISK_READ_CACHE_LOC;
+    uint32_t cacheLine = CACHE_SIZE;
+
+    // Find an invalid slot
+    for (uint32_t i = 0; i < CACHE_SIZE; i++) 
+    {
+        if (CacheLineDetail[i].valid == 0) 
+        {
+            cacheLine = i;
+            break;
+        }
+    }
+
+    // If no invalid slot, evict LRU (lowest accessTime among valid entries)
+    if (cacheLine == CACHE_SIZE) 
+    {
+        uint32_t minimumTime = 0xFFFFFFFF; 
+        cacheLine = 0;
         for (uint32_t i = 0; i < CACHE_SIZE; i++) 
         {
-            if (CacheLineDetail[i].valid == 0) 
+            if (CacheLineDetail[i].valid == 1 && CacheLineDetail[i].accessTime < minimumTime) 
             {
+                minimumTime = CacheLineDetail[i].accessTime;
                 cacheLine = i;
-                break;
             }
         }
 
-        // If no invalid slot, evict LRU (lowest accessTime among valid entries)
-        if (cacheLine == CACHE_SIZE) 
+        // The only time a process pays for write-back inline is when the cache is full of dirty lines
+        if (CacheLineDetail[cacheLine].dirty == 1)
+        {
+            cacheWriteBackLine(cacheLine);
+        }
+    }
+
+    return cacheLine;
+}
+
+void cacheWriteBackLine(uint32_t cacheLine)
+{
+    struct cacheLineDetail *CacheLineDetail = (struct cacheLineDetail *)DISK_READ_CACHE_LOC;
+
+    diskWriteSector(CacheLineDetail[cacheLine].sector, DISK_READ_CACHE_DATA + (cacheLine * SECTOR_SIZE), false);
+    CacheLineDetail[cacheLine].dirty = 0;
+}
+
+void cacheWriteBackDirty(uint32_t minimumAge)
+{
+    struct cacheLineDetail *CacheLineDetail = (struct cacheLineDetail *)DISK_READ_CACHE_LOC;
+    uint32_t lastSector = 0;
+    bool firstPass = true;
+
+    // Write back in LBA order so the disk head sweeps once across the dirty set.
+    // Each pass picks the lowest dirty sector above the one just written.
+    while (true)
+    {
+        uint32_t nextLine = CACHE_SIZE;
+
+        for (uint32_t cacheLine = 0; cacheLine < CACHE_SIZE; cacheLine++)
+        {
+            if (CacheLineDetail[cacheLine].valid == 1 && CacheLineDetail[cacheLine].dirty == 1
+                && (cacheCurrentTick - CacheLineDetail[cacheLine].dirtyTime) >= minimumAge
+                && (firstPass || CacheLineDetail[cacheLine].sector > lastSector)
+                && (nextLine == CACHE_SIZE || CacheLineDetail[cacheLine].sector < CacheLineDetail[nextLine].sector))
+            {
+                nextLine = cacheLine;
+            }
+        }
+
+        if (nextLine == CACHE_SIZE) { return; }
+
+        lastSector = CacheLineDetail[nextLine].sector;
+        firstPass = false;
+        cacheWriteBackLine(nextLine);
+    }
+}
+
+void diskFlushCache(uint32_t minimumAge, bool cacheActive)
+{
+    if (!cacheActive) { return; }
+
+    while (!acquireLock(KERNEL_OWNED, DISK_READ_CACHE_LOC)) {}
+    cacheWriteBackDirty(minimumAge);
+    while (!releaseLock(KERNEL_OWNED, DISK_READ_CACHE_LOC)) {}
+}
+
+void diskFlushBlock(uint32_t blockNumber, bool cacheActive)
+{
+    if (!cacheActive) { return; }
+
+    struct cacheLineDetail *CacheLineDetail = (struct cacheLineDetail *)DISK_READ_CACHE_LOC;
+    uint32_t sectorStart = (blockNumber * (BLOCK_SIZE / SECTOR_SIZE)) + EXT2_SECTOR_START;
+
+    while (!acquireLock(KERNEL_OWNED, DISK_READ_CACHE_LOC)) {}
+
+    for (uint32_t cacheLine = 0; cacheLine < CACHE_SIZE; cacheLine++)
+    {
+        if (CacheLineDetail[cacheLine].valid == 1 && CacheLineDetail[cacheLine].dirty == 1
+            && CacheLineDetail[cacheLine].sector >= sectorStart && CacheLineDetail[cacheLine].sector < sectorStart + (BLOCK_SIZE / SECTOR_SIZE))
+        {
+            cacheWriteBackLine(cacheLine);
+        }
+    }
+
+    while (!releaseLock(KERNEL_OWNED, DISK_READ_CACHE_LOC)) {}
+}
+
+void diskFlushTimerTick(uint32_t timerTicks, bool cacheActive)
+{
+    struct kernelConfiguration *KernelConfiguration = (struct kernelConfiguration*)KERNEL_CONFIGURATION;
+
+    cacheCurrentTick = timerTicks;
+
+    // The timer handler runs with interrupts back on, so a second tick can land while we are
+    // still writing, and the other CPU takes timer interrupts too. Only one flusher runs at a time.
+    if (!cacheActive || !compareAndSwap(&diskFlusherRunning, 0, 1)) { return; }
+
+    journalTimerTick(timerTicks, cacheActive);
+
+    if ((timerTicks % DISK_FLUSH_INTERVAL) == 0 && acquireLock(KERNEL_OWNED, DISK_READ_CACHE_LOC))
+    {
+        cacheWriteBackDirty(KernelConfiguration->writebackAge);
+        while (!releaseLock(KERNEL_OWNED, DISK_READ_CACHE_LOC)) {}
+    }
+
+    compareAndSwap(&diskFlusherRunning, 1, 0);
+}
+
+void diskPrefetchBlocks(uint32_t *blockList, uint32_t numberOfBlocks, bool cacheActive)
+{
+    if (!cacheActive) { return; }
+
+    struct cacheLineDetail *CacheLineDetail = (struct cacheLineDetail *)DISK_READ_CACHE_LOC;
+
+    // Insertion sort, the list is never longer than the cache
+    for (uint32_t i = 1; i < numberOfBlocks; i++)
+    {
+        uint32_t blockNumber = blockList[i];
+        uint32_t j = i;
+
+        while (j > 0 && blockList[j - 1] > blockNumber)
+        {
+            blockList[j] = blockList[j - 1];
+            j--;
+        }
+
+        blockList[j] = blockNumber;
+    }
+
+    // One pass in LBA order with the cache lock held, instead of a seek for every readBlock() as the boot wanders around the disk
+    while (!acquireLock(KERNEL_OWNED, DISK_READ_CACHE_LOC)) {}
+
+    for (uint32_t i = 0; i < numberOfBlocks; i++)
+    {
+        if (blockList[i] == 0 || (i > 0 && blockList[i] == blockList[i - 1]))
+        {
+            continue;
+        }
+
+        uint32_t sectorStart = (blockList[i] * (BLOCK_SIZE / SECTOR_SIZE)) + EXT2_SECTOR_START;
+
+        for (uint32_t sectorNumber = sectorStart; sectorNumber < sectorStart + (BLOCK_SIZE / SECTOR_SIZE); sectorNumber++)
         {
-            uint32_t minimumTime = 0xFFFFFFFF; 
-            cacheLine = 0;
-            for (uint32_t i = 0; i < CACHE_SIZE; i++) 
+            uint32_t cacheLine;
+
+            for (cacheLine = 0; cacheLine < CACHE_SIZE; cacheLine++)
             {
-                if (CacheLineDetail[i].valid == 1 && CacheLineDetail[i].accessTime < minimumTime) 
+                if (CacheLineDetail[cacheLine].valid == 1 && CacheLineDetail[cacheLine].sector == sectorNumber)
                 {
-                    minimumTime = CacheLineDetail[i].accessTime;
-                    cacheLine = i;
+                    break;
                 }
             }
+
+            // Already cached, and maybe dirty, so leave it alone
+            if (cacheLine != CACHE_SIZE)
+            {
+                continue;
+            }
+
+            cacheLine = cacheAllocateLine();
+
+            fsBlockDevice->readSector(sectorNumber, DISK_READ_CACHE_DATA + (cacheLine * SECTOR_SIZE));
+
+            CacheLineDetail[cacheLine].sector = sectorNumber;
+            CacheLineDetail[cacheLine].valid = 1;
+            CacheLineDetail[cacheLine].dirty = 0;
+            CacheLineDetail[cacheLine].accessTime = ++cacheLRUtime;
         }
+    }
 
-        // Compute the cache pointer to use to load data not in cache
-        tempBuffer = (uint8_t *)(cacheData + (cacheLine * SECTOR_SIZE));
+    while (!releaseLock(KERNEL_OWNED, DISK_READ_CACHE_LOC)) {}
+}
 
-        // Load with false since we want this to bypass this code or else it is circular
-        diskReadSector(sectorNumber, tempBuffer, false);
+void bootTraceReplay(bool cacheActive)
+{
+    struct bootTrace *BootTrace = (struct bootTrace *)BOOT_TRACE_LOC;
 
-        // Update cache info since I just loaded a new cache line with data
-        CacheLineDetail[cacheLine].sector = sectorNumber;
-        CacheLineDetail[cacheLine].valid = 1;
-        CacheLineDetail[cacheLine].accessTime = ++cacheLRUtime;
+    if (!cacheActive) { return; }
 
-        // Copy to destination now that the cache is loaded
-        memoryCopy(tempBuffer, destinationMemory, ceiling(SECTOR_SIZE, 2));
+    bootTraceInode = returnInodeofFileName((uint8_t *)BOOT_TRACE_FILE_NAME, cacheActive, ROOTDIR_INODE);
+
+    if (bootTraceInode == 0)
+    {
+        return;
+    }
+
+    fillMemory(BOOT_TRACE_LOC, 0x0, sizeof(bootTrace));
+    readFileAtOffset(bootTraceInode, 0, BOOT_TRACE_LOC, sizeof(bootTrace), cacheActive);
+
+    // A fresh image has an all zero file, which is just an empty trace
+    if (BootTrace->magic == BOOT_TRACE_MAGIC && BootTrace->numberOfBlocks <= BOOT_TRACE_MAX_BLOCKS)
+    {
+        diskPrefetchBlocks(BootTrace->blocks, BootTrace->numberOfBlocks, cacheActive);
+    }
+
+    // Every boot records a new list, so it follows whatever the boot reads now
+    BootTrace->magic = BOOT_TRACE_MAGIC;
+    BootTrace->numberOfBlocks = 0;
+    bootTraceRecording = true;
+}
+
+void bootTraceRecord(uint32_t blockNumber)
+{
+    struct bootTrace *BootTrace = (struct bootTrace *)BOOT_TRACE_LOC;
+
+    if (!bootTraceRecording) { return; }
+
+    // No lock. Two CPUs racing here can only lose or repeat an entry, which costs one prefetch next boot.
+    for (uint32_t i = 0; i < BootTrace->numberOfBlocks; i++)
+    {
+        if (BootTrace->blocks[i] == blockNumber)
+        {
+            return;
+        }
+    }
 
+    if (BootTrace->numberOfBlocks < BOOT_TRACE_MAX_BLOCKS)
+    {
+        BootTrace->blocks[BootTrace->numberOfBlocks] = blockNumber;
+        BootTrace->numberOfBlocks++;
     }
 }
 
+void bootTraceSave(bool cacheActive)
+{
+    if (!bootTraceRecording) { return; }
+
+    // Stop first so the writes below don't land in the trace
+    bootTraceRecording = false;
+
+    fsLockWrite(inodeLock(bootTraceInode));
+    fsMetadataLock();
+    journalStart(cacheActive);
+    writeFileAtOffset(bootTraceInode, 0, BOOT_TRACE_LOC, sizeof(bootTrace), cacheActive);
+    journalStop(cacheActive);
+    fsMetadataUnlock();
+    fsUnlockWrite(inodeLock(bootTraceInode));
+}
+
 
 void diskStatusCheck()
 {
@@ -109,21 +392,61 @@ void diskWriteSector(uint32_t sectorNumber, uint8_t *sourceMemory, bool cacheAct
     // Do not remove this section when completing assignment 2
     if (cacheActive)
     {
-        // flush entire cache on write.
-        fillMemory(DISK_READ_CACHE_LOC, 0x0, PAGE_SIZE);
-        fillMemory(DISK_READ_CACHE_DATA, 0x0, CACHE_SIZE * BLOCK_SIZE);
-        
+        // Write-back. The sector only goes to the disk when the flusher finds it old enough,
+        // on sync/fsync, or when its line is evicted.
+        struct cacheLineDetail *CacheLineDetail = (struct cacheLineDetail *)DISK_READ_CACHE_LOC;
+        uint32_t cacheLine;
+
+        while (!acquireLock(KERNEL_OWNED, DISK_READ_CACHE_LOC)) {}
+
+        for (cacheLine = 0; cacheLine < CACHE_SIZE; cacheLine++)
+        {
+            if (CacheLineDetail[cacheLine].valid == 1 && CacheLineDetail[cacheLine].sector == sectorNumber)
+            {
+                break;
+            }
+        }
+
+        if (cacheLine == CACHE_SIZE)
+        {
+            cacheLine = cacheAllocateLine();
+            CacheLineDetail[cacheLine].sector = sectorNumber;
+            CacheLineDetail[cacheLine].valid = 1;
+            CacheLineDetail[cacheLine].dirty = 0;
+        }
+
+        memoryCopy(sourceMemory, DISK_READ_CACHE_DATA + (cacheLine * SECTOR_SIZE), ceiling(SECTOR_SIZE, 2));
+        CacheLineDetail[cacheLine].accessTime = ++cacheLRUtime;
+
+        // Age counts from the first write so a hot sector cannot stay dirty forever
+        if (CacheLineDetail[cacheLine].dirty == 0)
+        {
+            CacheLineDetail[cacheLine].dirty = 1;
+            CacheLineDetail[cacheLine].dirtyTime = cacheCurrentTick;
+        }
+
+        while (!releaseLock(KERNEL_OWNED, DISK_READ_CACHE_LOC)) {}
+        return;
     }
-     
-    
-    // ASSIGNMENT 2 TO DO
 
+    fsBlockDevice->writeSector(sectorNumber, sourceMemory);
 }
 
 void readBlock(uint32_t blockNumber, uint8_t *destinationMemory, bool cacheActive)
 {
     // Dan O'Malley
     
+    if (bootTraceRecording)
+    {
+        bootTraceRecord(blockNumber);
+    }
+
+    // Metadata logged but not yet checkpointed is newer than what is on disk
+    if (journalReadBlock(blockNumber, destinationMemory))
+    {
+        return;
+    }
+
     uint32_t sectorStart = (blockNumber * (BLOCK_SIZE / SECTOR_SIZE)) + EXT2_SECTOR_START;
 
     for (uint32_t x = 0; x < BLOCK_SIZE / SECTOR_SIZE; x++)
@@ -146,6 +469,31 @@ void writeBlock(uint32_t blockNumber, uint8_t *sourceMemory, bool cacheActive)
 
 }
 
+uint32_t blockBitmapIndex(uint32_t blockNumber)
+{
+    return blockNumber - EXT2_FIRST_DATA_BLOCK;
+}
+
+uint32_t blockFromBitmapIndex(uint32_t bitIndex)
+{
+    return bitIndex + EXT2_FIRST_DATA_BLOCK;
+}
+
+bool bitmapTest(uint8_t *bitmap, uint32_t bitIndex)
+{
+    return (bitmap[bitIndex / 8] & (1 << (bitIndex % 8))) != 0;
+}
+
+void bitmapSet(uint8_t *bitmap, uint32_t bitIndex)
+{
+    bitmap[bitIndex / 8] = bitmap[bitIndex / 8] | (1 << (bitIndex % 8));
+}
+
+void bitmapClear(uint8_t *bitmap, uint32_t bitIndex)
+{
+    bitmap[bitIndex / 8] = bitmap[bitIndex / 8] & ~(1 << (bitIndex % 8));
+}
+
 uint32_t allocateFreeBlock(bool cacheActive)
 {
     // Initial version by Dan O'Malley. Extended with Grok.
@@ -156,18 +504,18 @@ uint32_t allocateFreeBlock(bool cacheActive)
 
     uint8_t *bitmap = (uint8_t *)EXT2_BLOCK_USAGE_MAP;
 
-    for (uint32_t byte_idx = 0; byte_idx < 0x7D0; byte_idx++)
+    for (uint32_t byte_idx = 0; byte_idx < ceiling(EXT2_BLOCK_BITMAP_BITS, 8); byte_idx++)
     {
         uint8_t byte = bitmap[byte_idx];
         if (byte != 0xff)
         {
-            for (uint32_t bit = 0; bit < 8; bit++)
+            for (uint32_t bit = 0; bit < 8 && (byte_idx * 8 + bit) < EXT2_BLOCK_BITMAP_BITS; bit++)
             {
                 if ((byte & (1 << bit)) == 0)
                 {
-                    uint32_t block = byte_idx * 8 + bit + 1;
-                    bitmap[byte_idx] |= (1 << bit);
-                    writeBlock(BlockGroupDescriptor->bgd_block_address_of_block_usage, (uint8_t *)EXT2_BLOCK_USAGE_MAP, cacheActive);
+                    uint32_t block = blockFromBitmapIndex(byte_idx * 8 + bit);
+                    bitmapSet(bitmap, byte_idx * 8 + bit);
+                    journalWriteBlock(BlockGroupDescriptor->bgd_block_address_of_block_usage, (uint8_t *)EXT2_BLOCK_USAGE_MAP, cacheActive);
                     return block;
                 }
             }
@@ -177,6 +525,52 @@ uint32_t allocateFreeBlock(bool cacheActive)
     return 0;
 }
 
+uint32_t allocateFreeExtent(uint32_t numberOfBlocks, bool cacheActive)
+{
+    struct blockGroupDescriptor *BlockGroupDescriptor = (blockGroupDescriptor*)(BLOCK_GROUP_DESCRIPTOR_TABLE);
+    readBlock(BlockGroupDescriptor->bgd_block_address_of_block_usage, (uint8_t *)EXT2_BLOCK_USAGE_MAP, cacheActive);
+
+    uint8_t *bitmap = (uint8_t *)EXT2_BLOCK_USAGE_MAP;
+    uint32_t runStart = 0;
+    uint32_t runLength = 0;
+
+    if (numberOfBlocks == 0) { return 0; }
+
+    for (uint32_t bitIndex = 0; bitIndex < EXT2_BLOCK_BITMAP_BITS; bitIndex++)
+    {
+        // A full byte ends any run, skip all eight bits at once
+        if ((bitIndex % 8) == 0 && bitmap[bitIndex / 8] == 0xff)
+        {
+            runLength = 0;
+            bitIndex = bitIndex + 7;
+            continue;
+        }
+
+        if (bitmapTest(bitmap, bitIndex))
+        {
+            runLength = 0;
+            continue;
+        }
+
+        if (runLength == 0) { runStart = bitIndex; }
+        runLength++;
+
+        if (runLength == numberOfBlocks)
+        {
+            for (uint32_t x = runStart; x < runStart + numberOfBlocks; x++)
+            {
+                bitmapSet(bitmap, x);
+            }
+
+            journalWriteBlock(BlockGroupDescriptor->bgd_block_address_of_block_usage, (uint8_t *)EXT2_BLOCK_USAGE_MAP, cacheActive);
+            return blockFromBitmapIndex(runStart);
+        }
+    }
+
+    // No run long enough
+    return 0;
+}
+
 uint32_t readNextAvailableBlock(bool cacheActive)
 {
     // Dan O'Malley
@@ -187,7 +581,7 @@ uint32_t readNextAvailableBlock(bool cacheActive)
     uint32_t lastUsedBlock = 0;
     uint32_t blockNumber = 0;
 
-    while (blockNumber < 0x7D0) // Max byte of block bit flag for this 32 MB file system (16000/8)
+    while (blockNumber < ceiling(EXT2_BLOCK_BITMAP_BITS, 8)) // Bytes of the block bitmap
     {
         if (*(uint8_t*)(EXT2_BLOCK_USAGE_MAP + blockNumber) == (uint8_t)1) { lastUsedBlock++; break;}
         else if (((uint8_t)*(uint8_t*)(EXT2_BLOCK_USAGE_MAP + blockNumber) == (uint8_t)3)) { lastUsedBlock=lastUsedBlock+2; break;}
@@ -201,9 +595,7 @@ uint32_t readNextAvailableBlock(bool cacheActive)
         blockNumber++;
     }
 
-    lastUsedBlock++;
-
-    return (uint32_t)lastUsedBlock;
+    return blockFromBitmapIndex(lastUsedBlock);
 }
 
 uint32_t readTotalBlocksUsed(bool cacheActive)
@@ -216,7 +608,7 @@ uint32_t readTotalBlocksUsed(bool cacheActive)
     uint32_t blocksInUse = 0;
     uint32_t blockNumber = 0;
 
-    while (blockNumber < 0x7D0) // Max byte of block bit flag for this 32 MB file system (16000/8)
+    while (blockNumber < ceiling(EXT2_BLOCK_BITMAP_BITS, 8)) // Bytes of the block bitmap
     {
         if (*(uint8_t*)(EXT2_BLOCK_USAGE_MAP + blockNumber) == (uint8_t)1) { blocksInUse++;}
         else if (((uint8_t)*(uint8_t*)(EXT2_BLOCK_USAGE_MAP + blockNumber) == (uint8_t)3)) { blocksInUse=blocksInUse+2;}
@@ -236,26 +628,14 @@ void freeBlock(uint32_t blockNumber, bool cacheActive)
 {
     // Initial version by Dan O'Malley. Extended with Grok.
     // 12/2025 with Grok v4.
-    
-    uint32_t blockGroupByte = blockNumber / 8;
-    uint32_t blockGroupBit = blockNumber % 8;
-    uint32_t valueToWrite = 0;
 
     struct blockGroupDescriptor *BlockGroupDescriptor = (blockGroupDescriptor*)(BLOCK_GROUP_DESCRIPTOR_TABLE);
     readBlock(BlockGroupDescriptor->bgd_block_address_of_block_usage, (uint8_t *)EXT2_BLOCK_USAGE_MAP, cacheActive);
 
-    if (blockGroupBit == (uint8_t)1) { valueToWrite = ((uint8_t)*(uint8_t*)(EXT2_BLOCK_USAGE_MAP + blockGroupByte)) -1;}
-    else if (blockGroupBit == (uint8_t)2) { valueToWrite = ((uint8_t)*(uint8_t*)(EXT2_BLOCK_USAGE_MAP + blockGroupByte)) -2;}
-    else if (blockGroupBit == (uint8_t)3) { valueToWrite = ((uint8_t)*(uint8_t*)(EXT2_BLOCK_USAGE_MAP + blockGroupByte)) -4;}
-    else if (blockGroupBit == (uint8_t)4) { valueToWrite = ((uint8_t)*(uint8_t*)(EXT2_BLOCK_USAGE_MAP + blockGroupByte)) -8;}
-    else if (blockGroupBit == (uint8_t)5) { valueToWrite = ((uint8_t)*(uint8_t*)(EXT2_BLOCK_USAGE_MAP + blockGroupByte)) -16;}
-    else if (blockGroupBit == (uint8_t)6) { valueToWrite = ((uint8_t)*(uint8_t*)(EXT2_BLOCK_USAGE_MAP + blockGroupByte)) -32;}
-    else if (blockGroupBit == (uint8_t)7) { valueToWrite = ((uint8_t)*(uint8_t*)(EXT2_BLOCK_USAGE_MAP + blockGroupByte)) -64;}
-    else if (blockGroupBit == (uint8_t)0) { valueToWrite = ((uint8_t)*(uint8_t*)(EXT2_BLOCK_USAGE_MAP + blockGroupByte)) -128;}
+    bitmapClear((uint8_t *)EXT2_BLOCK_USAGE_MAP, blockBitmapIndex(blockNumber));
 
-    *(uint8_t *)(EXT2_BLOCK_USAGE_MAP + blockGroupByte) = (uint8_t)valueToWrite;
-
-    writeBlock(BlockGroupDescriptor->bgd_block_address_of_block_usage, (uint8_t *)EXT2_BLOCK_USAGE_MAP, cacheActive);   
+    journalWriteBlock(BlockGroupDescriptor->bgd_block_address_of_block_usage, (uint8_t *)EXT2_BLOCK_USAGE_MAP, cacheActive);
+    journalRevokeBlock(blockNumber);
 }
 
 void freeAllBlocks(struct inode *inodeStructMemory, bool cacheActive)
@@ -290,6 +670,12 @@ void deleteFile(uint8_t *fileName, uint32_t currentPid, bool cacheActive, uint32
 {
     // Dan O'Malley
     
+    // The journal logs into its file's blocks, freeing them would corrupt the next commit
+    if (journalFileInode() != 0 && returnInodeofFileName(fileName, cacheActive, directoryInode) == journalFileInode())
+    {
+        return;
+    }
+
     uint8_t *inodePage = requestAvailablePage(currentPid, PG_USER_PRESENT_RW);
     struct blockGroupDescriptor *BlockGroupDescriptor = (blockGroupDescriptor*)(BLOCK_GROUP_DESCRIPTOR_TABLE);
     
@@ -302,21 +688,19 @@ void deleteFile(uint8_t *fileName, uint32_t currentPid, bool cacheActive, uint32
     }
     //freeAllBlocks((struct inode *)inodePage, cacheActive);
 
-    // Load all inodes of a directory up to max number of files per directory. This requires 16KB of memory.
-    for (uint32_t blocksOfInodes=0; blocksOfInodes < (MAX_FILES_PER_DIRECTORY / INODES_PER_BLOCK); blocksOfInodes++)
-    {
-        readBlock(BlockGroupDescriptor->bgd_starting_block_of_inode_table + blocksOfInodes, (uint8_t *)(uint32_t)EXT2_TEMP_INODE_STRUCTS + (BLOCK_SIZE * blocksOfInodes), cacheActive);
-    }
+    uint32_t inodeNumber = returnInodeofFileName(fileName, cacheActive, directoryInode);
+
+    // Only the inode table block holding this inode, any inode number works, not just the first 64
+    uint32_t inodeTableBlock = BlockGroupDescriptor->bgd_starting_block_of_inode_table + ((inodeNumber - 1) / INODES_PER_BLOCK);
+    readBlock(inodeTableBlock, EXT2_TEMP_INODE_STRUCTS, cacheActive);
 
     // Zero out the inode
-    fillMemory((EXT2_TEMP_INODE_STRUCTS + ((returnInodeofFileName(fileName, cacheActive, directoryInode)-1) * INODE_SIZE)), 0x0, INODE_SIZE);
+    fillMemory((EXT2_TEMP_INODE_STRUCTS + (((inodeNumber - 1) % INODES_PER_BLOCK) * INODE_SIZE)), 0x0, INODE_SIZE);
 
-    for (uint32_t blocksOfInodes=0; blocksOfInodes < (MAX_FILES_PER_DIRECTORY / INODES_PER_BLOCK); blocksOfInodes++)
-    {
-        writeBlock(BlockGroupDescriptor->bgd_starting_block_of_inode_table + blocksOfInodes, (uint8_t *)(uint32_t)EXT2_TEMP_INODE_STRUCTS + (BLOCK_SIZE * blocksOfInodes), cacheActive);
-    }
+    journalWriteBlock(inodeTableBlock, EXT2_TEMP_INODE_STRUCTS, cacheActive);
 
     deleteDirectoryEntry(fileName, cacheActive, directoryInode);
+    fsInodeChanged(inodeNumber);
     freePage(currentPid, inodePage);
 }
 
@@ -330,7 +714,7 @@ uint32_t allocateInode(bool cacheActive)
 
     uint8_t *bitmap = (uint8_t *)EXT2_INODE_USAGE_MAP;
 
-    for (uint32_t byte_idx = 0; byte_idx < 0x3E8; byte_idx++)
+    for (uint32_t byte_idx = 0; byte_idx < (EXT2_INODE_COUNT / 8); byte_idx++)
     {
         uint8_t byte = bitmap[byte_idx];
         if (byte != 0xff)
@@ -341,7 +725,9 @@ uint32_t allocateInode(bool cacheActive)
                 {
                     uint32_t inode = byte_idx * 8 + bit + 1;
                     bitmap[byte_idx] |= (1 << bit);
-                    writeBlock(BlockGroupDescriptor->bgd_block_address_of_inode_usage, (uint8_t *)EXT2_INODE_USAGE_MAP, cacheActive);
+                    journalWriteBlock(BlockGroupDescriptor->bgd_block_address_of_inode_usage, (uint8_t *)EXT2_INODE_USAGE_MAP, cacheActive);
+                    // Nothing cached under a previous owner of this number may leak into the new file
+                    fsInodeChanged(inode);
                     return inode;
                 }
             }
@@ -361,7 +747,7 @@ uint32_t readNextAvailableInode(bool cacheActive)
     uint32_t lastUsedInode = 0;
     uint32_t inodeNumber = 0;
 
-    while (inodeNumber < 0x3E8) // Max byte of inode bit flag for this 32 MB file system (8000 inodes/8)
+    while (inodeNumber < (EXT2_INODE_COUNT / 8)) // Bytes of the inode bitmap
     {
         if (*(uint8_t*)(EXT2_INODE_USAGE_MAP + inodeNumber) == (uint8_t)1) { lastUsedInode++; break; }
         else if (((uint8_t)*(uint8_t*)(EXT2_INODE_USAGE_MAP + inodeNumber) == (uint8_t)3)) { lastUsedInode=lastUsedInode+2; break;}
@@ -417,7 +803,7 @@ void deleteDirectoryEntry(uint8_t *fileName, bool cacheActive, uint32_t director
             
             // I only write the first block, if directories require more than one block,
             // I will have to add more writes here.
-            writeBlock(Inode->i_block[0], (uint8_t *)KERNEL_WORKING_DIR, cacheActive);
+            journalWriteBlock(Inode->i_block[0], (uint8_t *)KERNEL_WORKING_DIR, cacheActive);
             return;
         }
         if (dir->directoryInode != 0)
@@ -428,7 +814,7 @@ void deleteDirectoryEntry(uint8_t *fileName, bool cacheActive, uint32_t director
     }
 }
 
-void createFile(uint8_t *fileName, uint32_t currentPid, uint32_t fileDescriptor, bool cacheActive, uint32_t directoryInode)
+bool createFile(uint8_t *fileName, uint32_t currentPid, uint32_t fileDescriptor, bool cacheActive, uint32_t directoryInode)
 {
     // Initial version written by Dan O'Malley but extended with bug fix by Grok.
     // 12/2025 with Grok v4.
@@ -462,7 +848,7 @@ void createFile(uint8_t *fileName, uint32_t currentPid, uint32_t fileDescriptor,
 
     if (last_entry == NULL)
     {
-        return; // empty dir, need to handle . ..
+        return false; // empty dir, need to handle . ..
     }
 
     uint16_t old_rec = last_entry->recLength;
@@ -474,13 +860,34 @@ void createFile(uint8_t *fileName, uint32_t currentPid, uint32_t fileDescriptor,
 
     if (old_rec < min_old + min_new)
     {
-        return; // not enough, need extend dir
+        return false; // not enough, need extend dir
+    }
+
+    // The directory entry, inode, bitmaps and the blocks writeBufferToDisk() maps all commit together,
+    // whether or not the caller already holds a handle
+    journalStart(cacheActive);
+
+    uint32_t newInode = allocateInode(cacheActive);
+
+    // The entry is only added once the file's inode and blocks are written, so a file too large
+    // to map leaves no trace but the inode number it was given back
+    if (newInode == 0 || !writeInodeEntry(newInode, 0x81b6, (struct globalObjectTableEntry *)Task->fileDescriptor[fileDescriptor], cacheActive))
+    {
+        if (newInode != 0)
+        {
+            struct blockGroupDescriptor *BlockGroupDescriptor = (blockGroupDescriptor*)(BLOCK_GROUP_DESCRIPTOR_TABLE);
+            bitmapClear((uint8_t *)EXT2_INODE_USAGE_MAP, newInode - 1);
+            journalWriteBlock(BlockGroupDescriptor->bgd_block_address_of_inode_usage, (uint8_t *)EXT2_INODE_USAGE_MAP, cacheActive);
+        }
+
+        journalStop(cacheActive);
+        return false;
     }
 
     last_entry->recLength = min_old;
 
     struct directoryEntry *new_entry = (directoryEntry*)(KERNEL_WORKING_DIR + last_pos + min_old);
-    new_entry->directoryInode = allocateInode(cacheActive);
+    new_entry->directoryInode = newInode;
     bytecpy((uint8_t *)(new_entry) + 8, fileName, new_name_len);
     new_entry->fileType = (uint8_t)1;
     new_entry->nameLength = new_name_len;
@@ -492,90 +899,311 @@ void createFile(uint8_t *fileName, uint32_t currentPid, uint32_t fileDescriptor,
         fillMemory((uint8_t *)(new_entry) + 8 + new_name_len, 0, pad_len);
     }
 
-    writeInodeEntry(new_entry->directoryInode, 0x81b6, (struct globalObjectTableEntry *)Task->fileDescriptor[fileDescriptor], cacheActive);
-    
     // I only write the first block, if directories require more than one block,
     // I will have to add more writes here.
-    writeBlock(Inode->i_block[0], (uint8_t *)KERNEL_WORKING_DIR, cacheActive);
+    journalWriteBlock(Inode->i_block[0], (uint8_t *)KERNEL_WORKING_DIR, cacheActive);
+    journalStop(cacheActive);
+
+    return true;
 }
 
-void writeInodeEntry(uint32_t inodeEntry, uint16_t mode, struct globalObjectTableEntry *openFile, bool cacheActive)
+bool writeInodeEntry(uint32_t inodeEntry, uint16_t mode, struct globalObjectTableEntry *openFile, bool cacheActive)
 {
     // Dan O'Malley
     
     struct blockGroupDescriptor *BlockGroupDescriptor = (blockGroupDescriptor*)(BLOCK_GROUP_DESCRIPTOR_TABLE);
-    uint32_t blocksOfInodes = 0;
+    uint32_t inodeTableBlock = BlockGroupDescriptor->bgd_starting_block_of_inode_table + ((inodeEntry - 1) / INODES_PER_BLOCK);
 
-    while(blocksOfInodes < (MAX_FILES_PER_DIRECTORY / INODES_PER_BLOCK))
-    {
-        readBlock(BlockGroupDescriptor->bgd_starting_block_of_inode_table + blocksOfInodes, (uint8_t *)(int)EXT2_TEMP_INODE_STRUCTS + (BLOCK_SIZE * blocksOfInodes), cacheActive);
-        blocksOfInodes++;
-    }
+    // Only the inode table block holding this inode, writeBufferToDisk() fills in the inode in place
+    readBlock(inodeTableBlock, EXT2_TEMP_INODE_STRUCTS, cacheActive);
 
-    struct inode *Inode = (struct inode*)(EXT2_TEMP_INODE_STRUCTS + (INODE_SIZE * (inodeEntry - 1)));
+    struct inode *Inode = (struct inode*)(EXT2_TEMP_INODE_STRUCTS + (INODE_SIZE * ((inodeEntry - 1) % INODES_PER_BLOCK)));
 
     Inode->i_mode = mode;
+    // Lets fsync find the blocks of a buffer that was just turned into a file
+    openFile->inode = inodeEntry;
     // Doesn't seem to write the correct size here, though if I hard-code it with a size
     // it does write. 
     Inode->i_blocks = ceiling(openFile->size, BLOCK_SIZE);
 
-    writeBufferToDisk(openFile, inodeEntry, cacheActive);
-
-    blocksOfInodes = 0;
-
-    while(blocksOfInodes < (MAX_FILES_PER_DIRECTORY / INODES_PER_BLOCK))
+    if (!writeBufferToDisk(openFile, inodeEntry, cacheActive))
     {
-        writeBlock(BlockGroupDescriptor->bgd_starting_block_of_inode_table + blocksOfInodes, (uint8_t *)(int)EXT2_TEMP_INODE_STRUCTS + (BLOCK_SIZE * blocksOfInodes), cacheActive);
-        blocksOfInodes++;
+        return false;
     }
 
+    journalWriteBlock(inodeTableBlock, EXT2_TEMP_INODE_STRUCTS, cacheActive);
+
+    return true;
 }
 
-void writeBufferToDisk(struct globalObjectTableEntry *openFile, uint32_t inodeEntry, bool cacheActive)
+bool writeBufferToDisk(struct globalObjectTableEntry *openFile, uint32_t inodeEntry, bool cacheActive)
 {
     // Dan O'Malley
     
-    struct inode *Inode = (struct inode*)(EXT2_TEMP_INODE_STRUCTS + (INODE_SIZE * (inodeEntry - 1)));
+    struct inode *Inode = (struct inode*)(EXT2_TEMP_INODE_STRUCTS + (INODE_SIZE * ((inodeEntry - 1) % INODES_PER_BLOCK)));
 
     fillMemory((uint8_t *)EXT2_INDIRECT_BLOCK_TMP_LOC, 0x0, BLOCK_SIZE);
 
-    uint32_t blockArrayDirect[13];
     uint32_t *blockArraySinglyIndirect = (uint32_t *)EXT2_INDIRECT_BLOCK_TMP_LOC;
     uint32_t totalBlocksNeeded = ceiling((openFile->numberOfPagesForBuffer * PAGE_SIZE), BLOCK_SIZE);
-    uint32_t currentDirectBlock = 0;
-    uint32_t currentIndirectBlock = 0;
 
-    while (currentDirectBlock <= 12 && (currentDirectBlock < totalBlocksNeeded))
+    // Past the single indirect block the file can't be mapped, writing only the start of it would look like success
+    if (totalBlocksNeeded > (EXT2_NUMBER_OF_DIRECT_BLOCKS + EXT2_BLOCKS_PER_INDIRECT_BLOCK))
+    {
+        return false;
+    }
+
+    // Delayed allocation. Nothing was reserved while the file lived in its buffer, so now that the
+    // size is known the data and the indirect block are taken as one run, laid out in the order they are read.
+    // Allocating a block at a time interleaved files and cost a bitmap update per block.
+    uint32_t extentLength = totalBlocksNeeded;
+
+    if (totalBlocksNeeded > EXT2_NUMBER_OF_DIRECT_BLOCKS)
+    {
+        extentLength++;
+    }
+
+    // 0 means the disk is too fragmented for one run, so fall back to a block at a time
+    uint32_t nextExtentBlock = allocateFreeExtent(extentLength, cacheActive);
+
+    for (uint32_t fileBlock = 0; fileBlock < totalBlocksNeeded; fileBlock++)
     {
-        if (currentDirectBlock < 12)
+        if (fileBlock == EXT2_NUMBER_OF_DIRECT_BLOCKS)
+        {
+            Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK] = (nextExtentBlock != 0) ? nextExtentBlock++ : allocateFreeBlock(cacheActive);
+        }
+
+        uint32_t diskBlock = (nextExtentBlock != 0) ? nextExtentBlock++ : allocateFreeBlock(cacheActive);
+
+        writeBlock(diskBlock, (uint8_t *)(openFile->userspaceBuffer + (fileBlock * BLOCK_SIZE)), cacheActive);
+
+        if (fileBlock < EXT2_NUMBER_OF_DIRECT_BLOCKS)
         {
-            blockArrayDirect[currentDirectBlock] = allocateFreeBlock(cacheActive);
-            writeBlock(blockArrayDirect[currentDirectBlock], (uint8_t *)(openFile->userspaceBuffer + (currentDirectBlock * BLOCK_SIZE)), cacheActive);
-            Inode->i_block[currentDirectBlock] = blockArrayDirect[currentDirectBlock];
-            currentDirectBlock++;
+            Inode->i_block[fileBlock] = diskBlock;
         }
-        else if (currentDirectBlock == 12)
+        else
         {
-            blockArrayDirect[12] = allocateFreeBlock(cacheActive); //write the indirect block
-            Inode->i_block[12] = blockArrayDirect[12];
-            currentDirectBlock++;
+            blockArraySinglyIndirect[fileBlock - EXT2_NUMBER_OF_DIRECT_BLOCKS] = diskBlock;
         }
     }
 
-    if (totalBlocksNeeded > 12)
+    if (totalBlocksNeeded > EXT2_NUMBER_OF_DIRECT_BLOCKS)
+    {
+        // Write the indirect block to disk
+        journalWriteBlock(Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK], (uint8_t *)EXT2_INDIRECT_BLOCK_TMP_LOC, cacheActive);
+    }
+
+    Inode->i_size = totalBlocksNeeded * BLOCK_SIZE;
+
+    fsInodeChanged(inodeEntry);
+
+    return true;
+}
+
+uint32_t fileBlockToDiskBlock(struct inode *Inode, uint32_t fileBlock, uint8_t *indirectBlockMemory, bool cacheActive)
+{
+    if (fileBlock < EXT2_NUMBER_OF_DIRECT_BLOCKS)
+    {
+        return Inode->i_block[fileBlock];
+    }
+
+    fileBlock = fileBlock - EXT2_NUMBER_OF_DIRECT_BLOCKS;
+
+    if (fileBlock >= EXT2_BLOCKS_PER_INDIRECT_BLOCK || Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK] == 0)
+    {
+        return 0;
+    }
+
+    readBlock(Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK], indirectBlockMemory, cacheActive);
+
+    return ((uint32_t *)indirectBlockMemory)[fileBlock];
+}
+
+uint32_t readFileAtOffset(uint32_t inodeNumber, uint32_t offset, uint8_t *destinationMemory, uint32_t length, bool cacheActive)
+{
+    uint8_t inodeBuf[INODE_SIZE];
+    struct inode *Inode = (struct inode *)inodeBuf;
+    uint32_t bytesRead = 0;
+
+    // Its own scratch, not FILE_IO_BLOCK_LOC, so readers on both CPUs only meet at the inode lock
+    uint8_t *blockBuffer = fileIOScratchAcquire();
+    uint8_t *indirectBlockBuffer = blockBuffer + BLOCK_SIZE;
+    uint32_t *indirectBlock = (uint32_t *)indirectBlockBuffer;
+
+    loadInodeUsingBuffer(inodeNumber, inodeBuf, blockBuffer + (BLOCK_SIZE * 2), cacheActive);
+
+    if (offset >= Inode->i_size)
+    {
+        fileIOScratchRelease(blockBuffer);
+        return 0; // EOF
+    }
+
+    if (length > (Inode->i_size - offset))
+    {
+        length = Inode->i_size - offset;
+    }
+
+    // The indirect block is read once per call instead of once per data block
+    if (Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK] != 0 && (offset + length) > (EXT2_NUMBER_OF_DIRECT_BLOCKS * BLOCK_SIZE))
     {
+        readBlock(Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK], indirectBlockBuffer, cacheActive);
+    }
+    else
+    {
+        fillMemory(indirectBlockBuffer, 0x0, BLOCK_SIZE);
+    }
 
-        for (currentIndirectBlock=0; (currentIndirectBlock + currentDirectBlock) < totalBlocksNeeded; currentIndirectBlock++)
+    while (bytesRead < length)
+    {
+        uint32_t position = offset + bytesRead;
+        uint32_t fileBlock = position / BLOCK_SIZE;
+        uint32_t blockOffset = position % BLOCK_SIZE;
+        uint32_t bytesThisBlock = BLOCK_SIZE - blockOffset;
+        uint32_t diskBlock = 0;
+
+        if (bytesThisBlock > (length - bytesRead))
         {
-            blockArraySinglyIndirect[currentIndirectBlock] = allocateFreeBlock(cacheActive);
-            writeBlock(blockArraySinglyIndirect[currentIndirectBlock], (uint8_t *)(openFile->userspaceBuffer + ((currentIndirectBlock + currentDirectBlock) * BLOCK_SIZE)), cacheActive);
+            bytesThisBlock = length - bytesRead;
         }
 
-        // Write the indirect block to disk
-        writeBlock(Inode->i_block[12], (uint8_t *)EXT2_INDIRECT_BLOCK_TMP_LOC, cacheActive);
+        if (fileBlock < EXT2_NUMBER_OF_DIRECT_BLOCKS)
+        {
+            diskBlock = Inode->i_block[fileBlock];
+        }
+        else if ((fileBlock - EXT2_NUMBER_OF_DIRECT_BLOCKS) < EXT2_BLOCKS_PER_INDIRECT_BLOCK)
+        {
+            diskBlock = indirectBlock[fileBlock - EXT2_NUMBER_OF_DIRECT_BLOCKS];
+        }
+
+        // A hole reads back as zeros
+        if (diskBlock == 0)
+        {
+            fillMemory(destinationMemory + bytesRead, 0x0, bytesThisBlock);
+        }
+        else
+        {
+            readBlock(diskBlock, blockBuffer, cacheActive);
+            bytecpy(destinationMemory + bytesRead, blockBuffer + blockOffset, bytesThisBlock);
+        }
+
+        bytesRead = bytesRead + bytesThisBlock;
+    }
+
+    fileIOScratchRelease(blockBuffer);
+
+    return bytesRead;
+}
+
+uint32_t writeFileAtOffset(uint32_t inodeNumber, uint32_t offset, uint8_t *sourceMemory, uint32_t length, bool cacheActive)
+{
+    uint8_t inodeBuf[INODE_SIZE];
+    struct inode *Inode = (struct inode *)inodeBuf;
+    uint32_t *indirectBlock = (uint32_t *)FILE_IO_INDIRECT_BLOCK_LOC;
+    uint32_t maxFileSize = (EXT2_NUMBER_OF_DIRECT_BLOCKS + EXT2_BLOCKS_PER_INDIRECT_BLOCK) * BLOCK_SIZE;
+    bool indirectBlockChanged = false;
+    bool inodeChanged = false;
+    uint32_t bytesWritten = 0;
+
+    loadInode(inodeNumber, inodeBuf, cacheActive);
+
+    if (offset >= maxFileSize)
+    {
+        return 0;
+    }
+
+    if (length > (maxFileSize - offset))
+    {
+        length = maxFileSize - offset;
+    }
+
+    if (Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK] != 0 && (offset + length) > (EXT2_NUMBER_OF_DIRECT_BLOCKS * BLOCK_SIZE))
+    {
+        readBlock(Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK], FILE_IO_INDIRECT_BLOCK_LOC, cacheActive);
+    }
+
+    while (bytesWritten < length)
+    {
+        uint32_t position = offset + bytesWritten;
+        uint32_t fileBlock = position / BLOCK_SIZE;
+        uint32_t blockOffset = position % BLOCK_SIZE;
+        uint32_t bytesThisBlock = BLOCK_SIZE - blockOffset;
+        uint32_t *blockPointer;
+
+        if (bytesThisBlock > (length - bytesWritten))
+        {
+            bytesThisBlock = length - bytesWritten;
+        }
+
+        if (fileBlock < EXT2_NUMBER_OF_DIRECT_BLOCKS)
+        {
+            blockPointer = &Inode->i_block[fileBlock];
+        }
+        else
+        {
+            if (Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK] == 0)
+            {
+                Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK] = allocateFreeBlock(cacheActive);
+                if (Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK] == 0)
+                {
+                    break; // Disk full
+                }
+                fillMemory(FILE_IO_INDIRECT_BLOCK_LOC, 0x0, BLOCK_SIZE);
+                Inode->i_blocks = Inode->i_blocks + (BLOCK_SIZE / SECTOR_SIZE);
+                indirectBlockChanged = true;
+                inodeChanged = true;
+            }
+            blockPointer = &indirectBlock[fileBlock - EXT2_NUMBER_OF_DIRECT_BLOCKS];
+        }
+
+        if (*blockPointer == 0)
+        {
+            *blockPointer = allocateFreeBlock(cacheActive);
+            if (*blockPointer == 0)
+            {
+                break; // Disk full
+            }
+            Inode->i_blocks = Inode->i_blocks + (BLOCK_SIZE / SECTOR_SIZE);
+            inodeChanged = true;
+            if (fileBlock >= EXT2_NUMBER_OF_DIRECT_BLOCKS)
+            {
+                indirectBlockChanged = true;
+            }
+            fillMemory(FILE_IO_BLOCK_LOC, 0x0, BLOCK_SIZE);
+        }
+        else if (bytesThisBlock < BLOCK_SIZE)
+        {
+            // Partial block, keep the bytes around the write
+            readBlock(*blockPointer, FILE_IO_BLOCK_LOC, cacheActive);
+        }
+
+        bytecpy(FILE_IO_BLOCK_LOC + blockOffset, sourceMemory + bytesWritten, bytesThisBlock);
+        writeBlock(*blockPointer, FILE_IO_BLOCK_LOC, cacheActive);
+
+        bytesWritten = bytesWritten + bytesThisBlock;
+    }
+
+    if (indirectBlockChanged)
+    {
+        journalWriteBlock(Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK], FILE_IO_INDIRECT_BLOCK_LOC, cacheActive);
+    }
+
+    if ((offset + bytesWritten) > Inode->i_size)
+    {
+        Inode->i_size = offset + bytesWritten;
+        inodeChanged = true;
     }
 
-    Inode->i_size = (currentDirectBlock + currentIndirectBlock) * BLOCK_SIZE;
+    if (inodeChanged)
+    {
+        writeInode(inodeNumber, inodeBuf, cacheActive);
+    }
+
+    if (bytesWritten != 0)
+    {
+        fsInodeChanged(inodeNumber);
+    }
+
+    return bytesWritten;
 }
 
 
@@ -625,12 +1253,9 @@ bool fsFindFile(uint8_t *fileName, uint8_t *destinationMemory, bool cacheActive,
             }
             if (match) 
             {      
-                // Load all inodes of a directory up to max number of files per directory. This requires 16KB of memory.
-                for (uint32_t blocksOfInodes=0; blocksOfInodes < (MAX_FILES_PER_DIRECTORY / INODES_PER_BLOCK); blocksOfInodes++)
-                {
-                    readBlock(BlockGroupDescriptor->bgd_starting_block_of_inode_table + blocksOfInodes, (uint8_t *)(uint32_t)EXT2_TEMP_INODE_STRUCTS + (BLOCK_SIZE * blocksOfInodes), cacheActive);
-                }
-                memoryCopy( (uint8_t *)((uint32_t)EXT2_TEMP_INODE_STRUCTS + ((DirectoryEntry->directoryInode -1) * INODE_SIZE)), destinationMemory, INODE_SIZE);
+                // Only the inode table block holding this inode, so inodes past the first 64 are found too
+                readBlock(BlockGroupDescriptor->bgd_starting_block_of_inode_table + ((DirectoryEntry->directoryInode - 1) / INODES_PER_BLOCK), EXT2_TEMP_INODE_STRUCTS, cacheActive);
+                memoryCopy( (uint8_t *)((uint32_t)EXT2_TEMP_INODE_STRUCTS + (((DirectoryEntry->directoryInode - 1) % INODES_PER_BLOCK) * INODE_SIZE)), destinationMemory, INODE_SIZE);
                 
                 return true;
             }
@@ -682,14 +1307,29 @@ void loadInode(uint32_t inodeNumber, uint8_t* memoryAddress, bool cacheActive)
     // This code was written with Grok, an AI by xAI, based on my guidance and specifications.
     // 12/2025 with Grok v4.
     
+    loadInodeUsingBuffer(inodeNumber, memoryAddress, KERNEL_TEMP_INODE_LOC, cacheActive);
+}
+
+void loadInodeUsingBuffer(uint32_t inodeNumber, uint8_t* memoryAddress, uint8_t *blockBuffer, bool cacheActive)
+{
     struct blockGroupDescriptor *BlockGroupDescriptor = (struct blockGroupDescriptor*)(BLOCK_GROUP_DESCRIPTOR_TABLE);
     uint32_t inode_index = inodeNumber - 1;
     uint32_t inodes_per_block = BLOCK_SIZE / INODE_SIZE;
     uint32_t block_offset = inode_index / inodes_per_block;
     uint32_t inode_block = BlockGroupDescriptor->bgd_starting_block_of_inode_table + block_offset;
-    readBlock(inode_block, KERNEL_TEMP_INODE_LOC, cacheActive);
+    readBlock(inode_block, blockBuffer, cacheActive);
     uint32_t offset = (inode_index % inodes_per_block) * INODE_SIZE;
-    bytecpy(memoryAddress, KERNEL_TEMP_INODE_LOC + offset, INODE_SIZE);
+    bytecpy(memoryAddress, blockBuffer + offset, INODE_SIZE);
+}
+
+void writeInode(uint32_t inodeNumber, uint8_t* memoryAddress, bool cacheActive)
+{
+    struct blockGroupDescriptor *BlockGroupDescriptor = (struct blockGroupDescriptor*)(BLOCK_GROUP_DESCRIPTOR_TABLE);
+    uint32_t inodeBlock = BlockGroupDescriptor->bgd_starting_block_of_inode_table + ((inodeNumber - 1) / INODES_PER_BLOCK);
+
+    readBlock(inodeBlock, KERNEL_TEMP_INODE_LOC, cacheActive);
+    bytecpy(KERNEL_TEMP_INODE_LOC + (((inodeNumber - 1) % INODES_PER_BLOCK) * INODE_SIZE), memoryAddress, INODE_SIZE);
+    journalWriteBlock(inodeBlock, KERNEL_TEMP_INODE_LOC, cacheActive);
 }
 
 bool getFilenameFromInode(uint32_t inodeNumber, uint8_t *destinationMemory, bool cacheActive, uint32_t directoryInode)
@@ -793,6 +1433,10 @@ void moveFile(uint8_t *fileName, uint8_t *sourceDirectory, uint8_t *destinationD
         return;
     }
 
+    // The directory entry, inode, bitmaps and the blocks writeBufferToDisk() maps all commit together,
+    // whether or not the caller already holds a handle
+    journalStart(cacheActive);
+
     last_entry->recLength = min_old;
 
     struct directoryEntry *new_entry = (directoryEntry*)(KERNEL_WORKING_DIR + last_pos + min_old);
@@ -808,7 +1452,7 @@ void moveFile(uint8_t *fileName, uint8_t *sourceDirectory, uint8_t *destinationD
     }
 
     struct inode *Inode = (struct inode*)KERNEL_WORKING_DIR_TEMP_INODE_LOC;
-    writeBlock(Inode->i_block[0], (uint8_t *)KERNEL_WORKING_DIR, cacheActive);
+    journalWriteBlock(Inode->i_block[0], (uint8_t *)KERNEL_WORKING_DIR, cacheActive);
 
     deleteDirectoryEntry(fileName, cacheActive, getInodeFromPath(sourceDirectory, cacheActive));
 }
@@ -842,7 +1486,7 @@ void changeFileMode(uint8_t *fileName, uint16_t newMode, uint32_t currentPid, bo
     struct inode *Inode = (struct inode *)(inode_block_buffer + offset);
     Inode->i_mode = (Inode->i_mode & 0xF000) | (newMode & 0x0FFF);
 
-    writeBlock(inode_block, inode_block_buffer, cacheActive);
+    journalWriteBlock(inode_block, inode_block_buffer, cacheActive);
 
 }
 
@@ -912,4 +1556,836 @@ uint32_t getInodeFromPath(uint8_t *path, bool cacheActive)
     }
 
     return currentInode;
-}
\ No newline at end of file
+}
+
+void fsLockRead(uint32_t *lockWord)
+{
+    while (true)
+    {
+        uint32_t lockValue = *(volatile uint32_t *)lockWord;
+
+        if ((lockValue & (FS_LOCK_WRITER | FS_LOCK_WRITER_WAITING)) == 0 && compareAndSwap(lockWord, lockValue, lockValue + 1))
+        {
+            return;
+        }
+    }
+}
+
+void fsUnlockRead(uint32_t *lockWord)
+{
+    while (true)
+    {
+        uint32_t lockValue = *(volatile uint32_t *)lockWord;
+
+        // Keeps a waiting writer's flag
+        if (compareAndSwap(lockWord, lockValue, lockValue - 1))
+        {
+            return;
+        }
+    }
+}
+
+void fsLockWrite(uint32_t *lockWord)
+{
+    while (true)
+    {
+        uint32_t lockValue = *(volatile uint32_t *)lockWord;
+
+        if ((lockValue & ~FS_LOCK_WRITER_WAITING) == 0)
+        {
+            if (compareAndSwap(lockWord, lockValue, FS_LOCK_WRITER))
+            {
+                return;
+            }
+        }
+        else if ((lockValue & FS_LOCK_WRITER_WAITING) == 0)
+        {
+            // Stop new readers so a busy file can't starve the writer
+            compareAndSwap(lockWord, lockValue, lockValue | FS_LOCK_WRITER_WAITING);
+        }
+    }
+}
+
+void fsUnlockWrite(uint32_t *lockWord)
+{
+    // A writer still waiting sets its flag again on its next pass
+    compareAndSwap(lockWord, FS_LOCK_WRITER, 0);
+    compareAndSwap(lockWord, FS_LOCK_WRITER | FS_LOCK_WRITER_WAITING, 0);
+}
+
+uint32_t *inodeLock(uint32_t inodeNumber)
+{
+    return &INODE_LOCK_TABLE[inodeNumber % FS_LOCK_BUCKETS];
+}
+
+uint32_t *directoryLock(uint32_t directoryInode)
+{
+    return &DIRECTORY_LOCK_TABLE[directoryInode % FS_LOCK_BUCKETS];
+}
+
+void fsMetadataLock()
+{
+    while (!acquireLock(KERNEL_OWNED, KERNEL_WORKING_DIR)) {}
+}
+
+void fsMetadataUnlock()
+{
+    while (!releaseLock(KERNEL_OWNED, KERNEL_WORKING_DIR)) {}
+}
+
+uint8_t *fileIOScratchAcquire()
+{
+    while (true)
+    {
+        for (uint32_t slot = 0; slot < FILE_IO_SCRATCH_SLOTS; slot++)
+        {
+            if (compareAndSwap(&FILE_IO_SCRATCH_IN_USE[slot], 0, 1))
+            {
+                return FILE_IO_SCRATCH + (slot * FILE_IO_SCRATCH_SLOT_SIZE);
+            }
+        }
+    }
+}
+
+void fileIOScratchRelease(uint8_t *scratch)
+{
+    uint32_t slot = (uint32_t)(scratch - FILE_IO_SCRATCH) / FILE_IO_SCRATCH_SLOT_SIZE;
+
+    compareAndSwap(&FILE_IO_SCRATCH_IN_USE[slot], 1, 0);
+}
+
+bool fsCheckMarkBlock(uint32_t blockNumber, struct fsCheckReport *Report)
+{
+    if (blockNumber < EXT2_FIRST_DATA_BLOCK || blockNumber >= EXT2_BLOCK_COUNT)
+    {
+        Report->badBlockPointers++;
+        return false;
+    }
+
+    if (bitmapTest(FSCK_BLOCK_MAP, blockBitmapIndex(blockNumber)))
+    {
+        Report->duplicateBlocks++;
+    }
+
+    bitmapSet(FSCK_BLOCK_MAP, blockBitmapIndex(blockNumber));
+
+    return true;
+}
+
+uint32_t fsCheckWalkBlocks(uint32_t blockNumber, uint32_t level, uint32_t *previousBlock, uint32_t *blocksWalked, struct fsCheckReport *Report, bool cacheActive)
+{
+    uint32_t extents = 0;
+
+    if (!fsCheckMarkBlock(blockNumber, Report))
+    {
+        return 0;
+    }
+
+    // Indirect blocks count as part of the run, writeBufferToDisk() lays them out in line with the data
+    if (*previousBlock == 0 || blockNumber != *previousBlock + 1)
+    {
+        extents++;
+    }
+
+    *previousBlock = blockNumber;
+    *blocksWalked = *blocksWalked + 1;
+
+    if (level == 0)
+    {
+        return extents;
+    }
+
+    // One buffer per level, so a lower level never overwrites the block its parent is still walking
+    uint32_t *indirectBlock = (uint32_t *)(FSCK_SCRATCH + (MAX_BLOCK_SIZE * (1 + level)));
+    readBlock(blockNumber, (uint8_t *)indirectBlock, cacheActive);
+
+    for (uint32_t entry = 0; entry < EXT2_BLOCKS_PER_INDIRECT_BLOCK; entry++)
+    {
+        if (indirectBlock[entry] != 0)
+        {
+            extents = extents + fsCheckWalkBlocks(indirectBlock[entry], level - 1, previousBlock, blocksWalked, Report, cacheActive);
+        }
+    }
+
+    return extents;
+}
+
+void fsCheckDirectory(uint32_t directoryInode, uint32_t *queueLength, struct fsCheckReport *Report, bool repair, bool cacheActive)
+{
+    uint8_t directoryInodeBuf[INODE_SIZE];
+    uint8_t entryInodeBuf[INODE_SIZE];
+    struct inode *DirectoryInode = (struct inode *)directoryInodeBuf;
+    struct inode *EntryInode = (struct inode *)entryInodeBuf;
+    uint8_t *directoryBlock = FSCK_SCRATCH;
+    uint8_t *inodeTableBlock = FSCK_SCRATCH + MAX_BLOCK_SIZE;
+    uint8_t *indirectBlock = FSCK_SCRATCH + (MAX_BLOCK_SIZE * 2);
+
+    loadInodeUsingBuffer(directoryInode, directoryInodeBuf, inodeTableBlock, cacheActive);
+
+    if ((DirectoryInode->i_mode & EXT2_INODE_TYPE_MASK) != EXT2_INODE_TYPE_DIRECTORY)
+    {
+        return;
+    }
+
+    for (uint32_t fileBlock = 0; fileBlock < ceiling(DirectoryInode->i_size, BLOCK_SIZE); fileBlock++)
+    {
+        uint32_t diskBlock = fileBlockToDiskBlock(DirectoryInode, fileBlock, indirectBlock, cacheActive);
+
+        // Bad block numbers are counted when fsCheckInode() gets to the directory
+        if (diskBlock == 0 || diskBlock < EXT2_FIRST_DATA_BLOCK || diskBlock >= EXT2_BLOCK_COUNT)
+        {
+            continue;
+        }
+
+        readBlock(diskBlock, directoryBlock, cacheActive);
+
+        bool blockChanged = false;
+        struct directoryEntry *previous = NULL;
+        uint32_t pos = 0;
+
+        while (pos < BLOCK_SIZE)
+        {
+            struct directoryEntry *DirectoryEntry = (directoryEntry *)(directoryBlock + pos);
+            uint32_t recordLength = DirectoryEntry->recLength;
+
+            if (recordLength < EXT2_DIRECTORY_ENTRY_HEADER_SIZE || (recordLength % 4) != 0 || recordLength > (BLOCK_SIZE - pos)
+                || (uint32_t)(DirectoryEntry->nameLength + EXT2_DIRECTORY_ENTRY_HEADER_SIZE) > recordLength)
+            {
+                // Nothing after a broken record can be trusted, so the record before it takes the rest of the block
+                Report->badDirectoryEntries++;
+
+                if (repair)
+                {
+                    if (previous != NULL)
+                    {
+                        previous->recLength = (directoryBlock + BLOCK_SIZE) - (uint8_t *)previous;
+                    }
+                    else
+                    {
+                        fillMemory((uint8_t *)DirectoryEntry, 0x0, EXT2_DIRECTORY_ENTRY_HEADER_SIZE);
+                        DirectoryEntry->recLength = BLOCK_SIZE - pos;
+                    }
+
+                    blockChanged = true;
+                    Report->problemsRepaired++;
+                }
+                break;
+            }
+
+            uint32_t entryInode = DirectoryEntry->directoryInode;
+            uint8_t *entryName = (uint8_t *)DirectoryEntry + EXT2_DIRECTORY_ENTRY_HEADER_SIZE;
+            bool isDotEntry = (DirectoryEntry->nameLength == 1 && entryName[0] == '.')
+                || (DirectoryEntry->nameLength == 2 && entryName[0] == '.' && entryName[1] == '.');
+
+            if (entryInode != 0)
+            {
+                bool entryValid = entryInode <= EXT2_INODE_COUNT;
+
+                if (entryValid)
+                {
+                    loadInodeUsingBuffer(entryInode, entryInodeBuf, inodeTableBlock, cacheActive);
+                    entryValid = EntryInode->i_mode != 0;
+                }
+
+                if (!entryValid)
+                {
+                    Report->badDirectoryEntries++;
+
+                    // Removed the way deleteDirectoryEntry() does it, by folding the record into the one before
+                    if (repair)
+                    {
+                        if (previous != NULL)
+                        {
+                            previous->recLength = previous->recLength + recordLength;
+                        }
+                        else
+                        {
+                            DirectoryEntry->directoryInode = 0;
+                            previous = DirectoryEntry;
+                        }
+
+                        blockChanged = true;
+                        Report->problemsRepaired++;
+                        pos = pos + recordLength;
+                        continue;
+                    }
+                }
+                else
+                {
+                    if (FSCK_LINK_COUNTS[entryInode - 1] == 0 && !bitmapTest((uint8_t *)EXT2_INODE_USAGE_MAP, entryInode - 1))
+                    {
+                        Report->unmarkedInodes++;
+
+                        if (repair)
+                        {
+                            bitmapSet((uint8_t *)EXT2_INODE_USAGE_MAP, entryInode - 1);
+                            Report->problemsRepaired++;
+                        }
+                    }
+
+                    FSCK_LINK_COUNTS[entryInode - 1]++;
+
+                    // Each directory is queued once. "." and ".." only count towards link counts.
+                    if (!isDotEntry && (EntryInode->i_mode & EXT2_INODE_TYPE_MASK) == EXT2_INODE_TYPE_DIRECTORY
+                        && !bitmapTest(FSCK_DIRECTORY_MAP, entryInode - 1))
+                    {
+                        bitmapSet(FSCK_DIRECTORY_MAP, entryInode - 1);
+                        FSCK_DIRECTORY_QUEUE[*queueLength] = entryInode;
+                        *queueLength = *queueLength + 1;
+                    }
+                }
+            }
+
+            previous = DirectoryEntry;
+            pos = pos + recordLength;
+        }
+
+        // Each repaired block is a handle of its own. The entries it drops name free inodes, so nothing else has to change with it.
+        if (blockChanged)
+        {
+            journalStart(cacheActive);
+            journalWriteBlock(diskBlock, directoryBlock, cacheActive);
+            journalStop(cacheActive);
+        }
+    }
+}
+
+void fsCheckInode(uint32_t inodeNumber, struct fsCheckReport *Report, bool repair, bool cacheActive)
+{
+    uint8_t inodeBuf[INODE_SIZE];
+    struct inode *Inode = (struct inode *)inodeBuf;
+    uint32_t references = FSCK_LINK_COUNTS[inodeNumber - 1];
+    bool reserved = inodeNumber < EXT2_FIRST_INODE && inodeNumber != ROOTDIR_INODE;
+    bool inodeChanged = false;
+
+    loadInodeUsingBuffer(inodeNumber, inodeBuf, FSCK_SCRATCH + MAX_BLOCK_SIZE, cacheActive);
+    Report->inodesInUse++;
+
+    if (!reserved && references == 0)
+    {
+        if (Inode->i_mode == 0 || Inode->i_links_count == 0)
+        {
+            // deleteFile() zeroes the inode but leaves its bitmap bit set. Its blocks aren't marked,
+            // so the bitmap pass reclaims them along with the inode.
+            Report->leakedInodes++;
+
+            if (repair)
+            {
+                bitmapClear((uint8_t *)EXT2_INODE_USAGE_MAP, inodeNumber - 1);
+
+                // Zeroed with its bit still set is what deleteFile() leaves, so this is safe to commit before the bitmap
+                if (Inode->i_mode != 0)
+                {
+                    fillMemory(inodeBuf, 0x0, INODE_SIZE);
+                    journalStart(cacheActive);
+                    writeInode(inodeNumber, inodeBuf, cacheActive);
+                    journalStop(cacheActive);
+                }
+
+                Report->problemsRepaired++;
+            }
+            return;
+        }
+
+        // A live file with nowhere to put it, there is no lost+found support. Keep its blocks.
+        Report->unattachedInodes++;
+    }
+    else if (!reserved && Inode->i_links_count != references)
+    {
+        Report->badLinkCounts++;
+
+        if (repair)
+        {
+            Inode->i_links_count = references;
+            inodeChanged = true;
+            Report->problemsRepaired++;
+        }
+    }
+
+    uint32_t previousBlock = 0;
+    uint32_t blocksWalked = 0;
+    uint32_t extents = 0;
+
+    for (uint32_t x = 0; x < EXT2_NUMBER_OF_DIRECT_BLOCKS; x++)
+    {
+        if (Inode->i_block[x] != 0)
+        {
+            extents = extents + fsCheckWalkBlocks(Inode->i_block[x], 0, &previousBlock, &blocksWalked, Report, cacheActive);
+        }
+    }
+
+    for (uint32_t level = 1; level <= FSCK_INDIRECT_LEVELS; level++)
+    {
+        if (Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK + level - 1] != 0)
+        {
+            extents = extents + fsCheckWalkBlocks(Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK + level - 1], level, &previousBlock, &blocksWalked, Report, cacheActive);
+        }
+    }
+
+    // i_blocks is in 512 byte units whatever the block size
+    if (!reserved && Inode->i_blocks != blocksWalked * (BLOCK_SIZE / SECTOR_SIZE))
+    {
+        Report->badBlockCounts++;
+
+        if (repair)
+        {
+            Inode->i_blocks = blocksWalked * (BLOCK_SIZE / SECTOR_SIZE);
+            inodeChanged = true;
+            Report->problemsRepaired++;
+        }
+    }
+
+    if ((Inode->i_mode & EXT2_INODE_TYPE_MASK) == EXT2_INODE_TYPE_DIRECTORY)
+    {
+        Report->directories++;
+    }
+    else if (!reserved && (Inode->i_mode & EXT2_INODE_TYPE_MASK) == EXT2_INODE_TYPE_FILE)
+    {
+        Report->files++;
+        Report->fileExtents = Report->fileExtents + extents;
+
+        if (extents > 1)
+        {
+            Report->fragmentedFiles++;
+        }
+    }
+
+    if (inodeChanged)
+    {
+        journalStart(cacheActive);
+        writeInode(inodeNumber, inodeBuf, cacheActive);
+        journalStop(cacheActive);
+    }
+}
+
+void fsCheckBitmaps(struct fsCheckReport *Report, bool repair)
+{
+    uint8_t *bitmap = (uint8_t *)EXT2_BLOCK_USAGE_MAP;
+    uint32_t freeRunLength = 0;
+
+    for (uint32_t bitIndex = 0; bitIndex < EXT2_BLOCK_BITMAP_BITS; bitIndex++)
+    {
+        bool reachable = bitmapTest(FSCK_BLOCK_MAP, bitIndex);
+        bool marked = bitmapTest(bitmap, bitIndex);
+
+        if (marked && !reachable)
+        {
+            Report->leakedBlocks++;
+
+            if (repair)
+            {
+                // Same as freeBlock(), but the bitmap is written once by fsCheck()
+                bitmapClear(bitmap, bitIndex);
+                journalRevokeBlock(blockFromBitmapIndex(bitIndex));
+                marked = false;
+                Report->problemsRepaired++;
+            }
+        }
+        else if (reachable && !marked)
+        {
+            Report->unmarkedBlocks++;
+
+            if (repair)
+            {
+                bitmapSet(bitmap, bitIndex);
+                marked = true;
+                Report->problemsRepaired++;
+            }
+        }
+
+        if (marked)
+        {
+            Report->blocksInUse++;
+            freeRunLength = 0;
+            continue;
+        }
+
+        freeRunLength++;
+
+        if (freeRunLength == 1)
+        {
+            Report->freeExtents++;
+        }
+
+        if (freeRunLength > Report->largestFreeExtent)
+        {
+            Report->largestFreeExtent = freeRunLength;
+        }
+    }
+}
+
+void fsCheckSummaryCounts(struct fsCheckReport *Report, bool repair, bool cacheActive)
+{
+    struct blockGroupDescriptor *BlockGroupDescriptor = (blockGroupDescriptor*)(BLOCK_GROUP_DESCRIPTOR_TABLE);
+    uint8_t *superBlockBlock = FSCK_SCRATCH;
+    struct ext2SuperBlock *Ext2SuperBlock = (ext2SuperBlock *)(superBlockBlock + EXT2_SUPERBLOCK_OFFSET);
+    uint32_t freeBlocks = EXT2_BLOCK_BITMAP_BITS - Report->blocksInUse;
+    uint32_t freeInodes = 0;
+
+    for (uint32_t bitIndex = 0; bitIndex < EXT2_INODE_COUNT; bitIndex++)
+    {
+        if (!bitmapTest((uint8_t *)EXT2_INODE_USAGE_MAP, bitIndex))
+        {
+            freeInodes++;
+        }
+    }
+
+    readBlock(SUPERBLOCK, superBlockBlock, cacheActive);
+
+    if (Ext2SuperBlock->sb_total_unallocated_blocks == freeBlocks && Ext2SuperBlock->sb_total_unallocated_inodes == freeInodes
+        && BlockGroupDescriptor->bgd_number_of_unallocated_blocks_in_group == freeBlocks
+        && BlockGroupDescriptor->bgd_number_of_unallocated_inodes_in_group == freeInodes
+        && BlockGroupDescriptor->bgd_number_directories_in_group == Report->directories)
+    {
+        return;
+    }
+
+    Report->badSummaryCounts++;
+
+    if (!repair)
+    {
+        return;
+    }
+
+    Ext2SuperBlock->sb_total_unallocated_blocks = freeBlocks;
+    Ext2SuperBlock->sb_total_unallocated_inodes = freeInodes;
+    journalWriteBlock(SUPERBLOCK, superBlockBlock, cacheActive);
+    bytecpy(SUPERBLOCK_LOC, superBlockBlock, BLOCK_SIZE);
+
+    BlockGroupDescriptor->bgd_number_of_unallocated_blocks_in_group = freeBlocks;
+    BlockGroupDescriptor->bgd_number_of_unallocated_inodes_in_group = freeInodes;
+    BlockGroupDescriptor->bgd_number_directories_in_group = Report->directories;
+    journalWriteBlock(GROUP_DESCRIPTOR_BLOCK, BLOCK_GROUP_DESCRIPTOR_TABLE, cacheActive);
+
+    Report->problemsRepaired++;
+}
+
+uint32_t fsCheck(struct fsCheckReport *Report, bool repair, bool cacheActive)
+{
+    struct blockGroupDescriptor *BlockGroupDescriptor = (blockGroupDescriptor*)(BLOCK_GROUP_DESCRIPTOR_TABLE);
+    uint32_t inodeTableBlocks = ceiling(EXT2_INODE_COUNT * INODE_SIZE, BLOCK_SIZE);
+    uint32_t queueLength = 0;
+
+    fillMemory((uint8_t *)Report, 0x0, sizeof(fsCheckReport));
+    fillMemory(FSCK_BLOCK_MAP, 0x0, ceiling(EXT2_BLOCK_BITMAP_BITS, 8));
+    fillMemory(FSCK_DIRECTORY_MAP, 0x0, ceiling(EXT2_INODE_COUNT, 8));
+    fillMemory((uint8_t *)FSCK_LINK_COUNTS, 0x0, EXT2_INODE_COUNT * sizeof(uint16_t));
+
+    fsMetadataLock();
+
+    readBlock(BlockGroupDescriptor->bgd_block_address_of_block_usage, (uint8_t *)EXT2_BLOCK_USAGE_MAP, cacheActive);
+    readBlock(BlockGroupDescriptor->bgd_block_address_of_inode_usage, (uint8_t *)EXT2_INODE_USAGE_MAP, cacheActive);
+
+    // The blocks that belong to the file system rather than to an inode. The reserved group descriptor
+    // blocks mkfs.ext2 leaves for resizing belong to inode 7 and are marked when it is walked.
+    for (uint32_t block = SUPERBLOCK; block <= GROUP_DESCRIPTOR_BLOCK; block++)
+    {
+        fsCheckMarkBlock(block, Report);
+    }
+
+    fsCheckMarkBlock(BlockGroupDescriptor->bgd_block_address_of_block_usage, Report);
+    fsCheckMarkBlock(BlockGroupDescriptor->bgd_block_address_of_inode_usage, Report);
+
+    for (uint32_t block = 0; block < inodeTableBlocks; block++)
+    {
+        fsCheckMarkBlock(BlockGroupDescriptor->bgd_starting_block_of_inode_table + block, Report);
+    }
+
+    // Pass 1, breadth first from the root so the queue never holds a directory twice
+    bitmapSet(FSCK_DIRECTORY_MAP, ROOTDIR_INODE - 1);
+    FSCK_DIRECTORY_QUEUE[queueLength++] = ROOTDIR_INODE;
+
+    for (uint32_t next = 0; next < queueLength; next++)
+    {
+        fsCheckDirectory(FSCK_DIRECTORY_QUEUE[next], &queueLength, Report, repair, cacheActive);
+    }
+
+    // Pass 2, only the inodes the bitmap or a directory says are in use, which is what keeps this fast
+    for (uint32_t inodeNumber = 1; inodeNumber <= EXT2_INODE_COUNT; inodeNumber++)
+    {
+        if (bitmapTest((uint8_t *)EXT2_INODE_USAGE_MAP, inodeNumber - 1) || FSCK_LINK_COUNTS[inodeNumber - 1] != 0)
+        {
+            fsCheckInode(inodeNumber, Report, repair, cacheActive);
+        }
+    }
+
+    // Pass 3
+    fsCheckBitmaps(Report, repair);
+
+    // The bitmaps and the free counts agree with each other, so they go in the last handle together.
+    // A bitmap is only written if a repair changed it, a clean file system gets no writes at all.
+    journalStart(cacheActive);
+
+    if (repair && (Report->leakedBlocks + Report->unmarkedBlocks) != 0)
+    {
+        journalWriteBlock(BlockGroupDescriptor->bgd_block_address_of_block_usage, (uint8_t *)EXT2_BLOCK_USAGE_MAP, cacheActive);
+    }
+
+    if (repair && (Report->leakedInodes + Report->unmarkedInodes) != 0)
+    {
+        journalWriteBlock(BlockGroupDescriptor->bgd_block_address_of_inode_usage, (uint8_t *)EXT2_INODE_USAGE_MAP, cacheActive);
+    }
+
+    fsCheckSummaryCounts(Report, repair, cacheActive);
+
+    Report->problemsFound = Report->leakedBlocks + Report->unmarkedBlocks + Report->duplicateBlocks + Report->badBlockPointers
+        + Report->leakedInodes + Report->unattachedInodes + Report->unmarkedInodes + Report->badLinkCounts + Report->badBlockCounts
+        + Report->badDirectoryEntries + Report->badSummaryCounts;
+
+    journalStop(cacheActive);
+    fsMetadataUnlock();
+
+    return Report->problemsFound;
+}
+
+uint32_t fsDefragCountFragments(uint32_t *blockList, uint32_t numberOfBlocks)
+{
+    uint32_t fragments = 0;
+    uint32_t previousBlock = 0;
+
+    for (uint32_t x = 0; x < numberOfBlocks; x++)
+    {
+        if (blockList[x] == 0) { continue; }
+
+        if (previousBlock == 0 || blockList[x] != previousBlock + 1)
+        {
+            fragments++;
+        }
+
+        previousBlock = blockList[x];
+    }
+
+    return fragments;
+}
+
+bool fsDefragFile(uint32_t inodeNumber, struct fsDefragReport *Report, bool cacheActive)
+{
+    struct blockGroupDescriptor *BlockGroupDescriptor = (blockGroupDescriptor*)(BLOCK_GROUP_DESCRIPTOR_TABLE);
+    uint8_t inodeBuf[INODE_SIZE];
+    struct inode *Inode = (struct inode *)inodeBuf;
+    uint8_t *indirectBlockBuffer = DEFRAG_SCRATCH;
+    uint8_t *dataBlockBuffer = DEFRAG_SCRATCH + MAX_BLOCK_SIZE;
+    uint32_t *indirectBlock = (uint32_t *)indirectBlockBuffer;
+    uint32_t numberOfBlocks = 0;
+    bool movable = true;
+
+    fillMemory((uint8_t *)Report, 0x0, sizeof(fsDefragReport));
+
+    // The reserved inodes and the journal, which logs into its own blocks, stay where mkfs.ext2 put them
+    if (inodeNumber < EXT2_FIRST_INODE || inodeNumber > EXT2_INODE_COUNT || inodeNumber == journalFileInode())
+    {
+        return false;
+    }
+
+    fsLockWrite(inodeLock(inodeNumber));
+    fsMetadataLock();
+    journalStart(cacheActive);
+
+    readBlock(BlockGroupDescriptor->bgd_block_address_of_inode_usage, (uint8_t *)EXT2_INODE_USAGE_MAP, cacheActive);
+    loadInode(inodeNumber, inodeBuf, cacheActive);
+
+    // Only the layout writeBufferToDisk() and writeFileAtOffset() build, direct blocks and one indirect block
+    if (!bitmapTest((uint8_t *)EXT2_INODE_USAGE_MAP, inodeNumber - 1) || (Inode->i_mode & EXT2_INODE_TYPE_MASK) != EXT2_INODE_TYPE_FILE
+        || Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK + 1] != 0 || Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK + 2] != 0)
+    {
+        movable = false;
+    }
+
+    if (movable)
+    {
+        // The file's blocks in the order they are read, which is the order they are laid back down in
+        for (uint32_t x = 0; x < EXT2_NUMBER_OF_DIRECT_BLOCKS; x++)
+        {
+            DEFRAG_BLOCK_LIST[numberOfBlocks++] = Inode->i_block[x];
+        }
+
+        if (Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK] != 0)
+        {
+            readBlock(Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK], indirectBlockBuffer, cacheActive);
+            DEFRAG_BLOCK_LIST[numberOfBlocks++] = Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK];
+
+            for (uint32_t y = 0; y < EXT2_BLOCKS_PER_INDIRECT_BLOCK; y++)
+            {
+                DEFRAG_BLOCK_LIST[numberOfBlocks++] = indirectBlock[y];
+            }
+        }
+
+        for (uint32_t x = 0; x < numberOfBlocks; x++)
+        {
+            if (DEFRAG_BLOCK_LIST[x] == 0) { continue; }
+
+            // A bad pointer is fsCheck()'s to report. Copying from it or freeing it would do damage.
+            if (DEFRAG_BLOCK_LIST[x] < EXT2_FIRST_DATA_BLOCK || DEFRAG_BLOCK_LIST[x] >= EXT2_BLOCK_COUNT)
+            {
+                movable = false;
+            }
+
+            Report->blocks++;
+        }
+
+        Report->fragmentsBefore = fsDefragCountFragments(DEFRAG_BLOCK_LIST, numberOfBlocks);
+        Report->fragmentsAfter = Report->fragmentsBefore;
+    }
+
+    uint32_t nextNewBlock = 0;
+
+    if (movable && Report->fragmentsBefore > 1)
+    {
+        // 0 means no free run is long enough, and the file stays as it is
+        nextNewBlock = allocateFreeExtent(Report->blocks, cacheActive);
+    }
+
+    if (nextNewBlock != 0)
+    {
+        // The data goes to the new blocks first. Nothing points at them until the transaction commits, and the
+        // commit flushes the data ahead of the journal, so a crash before then leaves the file where it was.
+        for (uint32_t x = 0; x < numberOfBlocks; x++)
+        {
+            if (DEFRAG_BLOCK_LIST[x] == 0) { continue; }
+
+            uint32_t newBlock = nextNewBlock++;
+            Report->blocksMoved++;
+
+            if (x == EXT2_NUMBER_OF_DIRECT_BLOCKS)
+            {
+                // The indirect block. Its pointers are filled in as the loop goes and it is logged after.
+                Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK] = newBlock;
+                continue;
+            }
+
+            readBlock(DEFRAG_BLOCK_LIST[x], dataBlockBuffer, cacheActive);
+            writeBlock(newBlock, dataBlockBuffer, cacheActive);
+
+            if (x < EXT2_NUMBER_OF_DIRECT_BLOCKS)
+            {
+                Inode->i_block[x] = newBlock;
+            }
+            else
+            {
+                indirectBlock[x - EXT2_NUMBER_OF_DIRECT_BLOCKS - 1] = newBlock;
+            }
+        }
+
+        if (Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK] != 0)
+        {
+            journalWriteBlock(Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK], indirectBlockBuffer, cacheActive);
+        }
+
+        writeInode(inodeNumber, inodeBuf, cacheActive);
+
+        // allocateFreeExtent() left the new run set in EXT2_BLOCK_USAGE_MAP, so the old blocks come out of the same copy
+        for (uint32_t x = 0; x < numberOfBlocks; x++)
+        {
+            if (DEFRAG_BLOCK_LIST[x] == 0) { continue; }
+
+            bitmapClear((uint8_t *)EXT2_BLOCK_USAGE_MAP, blockBitmapIndex(DEFRAG_BLOCK_LIST[x]));
+            journalRevokeBlock(DEFRAG_BLOCK_LIST[x]);
+        }
+
+        journalWriteBlock(BlockGroupDescriptor->bgd_block_address_of_block_usage, (uint8_t *)EXT2_BLOCK_USAGE_MAP, cacheActive);
+
+        Report->fragmentsAfter = 1;
+    }
+
+    journalStop(cacheActive);
+
+    if (nextNewBlock != 0)
+    {
+        // Commit before anyone else can allocate. Until the new pointers are on disk the old blocks still hold the file.
+        journalCommit(cacheActive);
+    }
+
+    fsMetadataUnlock();
+    fsUnlockWrite(inodeLock(inodeNumber));
+
+    return movable;
+}
+
+uint32_t readDirectoryEntries(uint32_t directoryInode, uint32_t *position, struct directoryListingEntry *Entries, uint32_t maxEntries, bool cacheActive)
+{
+    struct blockGroupDescriptor *BlockGroupDescriptor = (blockGroupDescriptor*)(BLOCK_GROUP_DESCRIPTOR_TABLE);
+    uint8_t inodeBuf[INODE_SIZE];
+    struct inode *DirectoryInode = (struct inode *)inodeBuf;
+    uint32_t entriesRead = 0;
+    uint32_t loadedFileBlock = 0xFFFFFFFF;
+
+    uint8_t *directoryBlock = fileIOScratchAcquire();
+    uint8_t *indirectBlockBuffer = directoryBlock + BLOCK_SIZE;
+    uint8_t *inodeTableBlock = directoryBlock + (BLOCK_SIZE * 2);
+
+    loadInodeUsingBuffer(directoryInode, inodeBuf, inodeTableBlock, cacheActive);
+    uint32_t loadedInodeTableBlock = BlockGroupDescriptor->bgd_starting_block_of_inode_table + ((directoryInode - 1) / INODES_PER_BLOCK);
+
+    if ((DirectoryInode->i_mode & EXT2_INODE_TYPE_MASK) != EXT2_INODE_TYPE_DIRECTORY)
+    {
+        fileIOScratchRelease(directoryBlock);
+        return 0;
+    }
+
+    while (entriesRead < maxEntries && *position < DirectoryInode->i_size)
+    {
+        uint32_t fileBlock = *position / BLOCK_SIZE;
+        uint32_t blockOffset = *position % BLOCK_SIZE;
+
+        if (fileBlock != loadedFileBlock)
+        {
+            uint32_t diskBlock = fileBlockToDiskBlock(DirectoryInode, fileBlock, indirectBlockBuffer, cacheActive);
+
+            if (diskBlock == 0)
+            {
+                *position = (fileBlock + 1) * BLOCK_SIZE;
+                continue;
+            }
+
+            readBlock(diskBlock, directoryBlock, cacheActive);
+            loadedFileBlock = fileBlock;
+        }
+
+        struct directoryEntry *DirectoryEntry = (struct directoryEntry *)(directoryBlock + blockOffset);
+
+        // A record that runs off the block ends it. Repairing it is fsCheck()'s job.
+        if (DirectoryEntry->recLength < EXT2_DIRECTORY_ENTRY_HEADER_SIZE || (blockOffset + DirectoryEntry->recLength) > BLOCK_SIZE)
+        {
+            *position = (fileBlock + 1) * BLOCK_SIZE;
+            continue;
+        }
+
+        *position = *position + DirectoryEntry->recLength;
+
+        if (DirectoryEntry->directoryInode == 0 || DirectoryEntry->directoryInode > EXT2_INODE_COUNT)
+        {
+            continue;
+        }
+
+        // Files made one after another sit next to each other in the inode table, so most entries need no read at all
+        uint32_t entryInodeTableBlock = BlockGroupDescriptor->bgd_starting_block_of_inode_table + ((DirectoryEntry->directoryInode - 1) / INODES_PER_BLOCK);
+
+        if (entryInodeTableBlock != loadedInodeTableBlock)
+        {
+            readBlock(entryInodeTableBlock, inodeTableBlock, cacheActive);
+            loadedInodeTableBlock = entryInodeTableBlock;
+        }
+
+        struct inode *Inode = (struct inode *)(inodeTableBlock + (((DirectoryEntry->directoryInode - 1) % INODES_PER_BLOCK) * INODE_SIZE));
+        struct directoryListingEntry *Entry = &Entries[entriesRead++];
+        uint32_t nameLength = DirectoryEntry->nameLength;
+
+        if (nameLength > (DIRECTORY_LISTING_NAME_SIZE - 1))
+        {
+            nameLength = DIRECTORY_LISTING_NAME_SIZE - 1;
+        }
+
+        Entry->inode = DirectoryEntry->directoryInode;
+        Entry->size = Inode->i_size;
+        Entry->modifyTime = Inode->i_mtime;
+        Entry->mode = Inode->i_mode;
+        Entry->linksCount = Inode->i_links_count;
+        Entry->nameLength = DirectoryEntry->nameLength;
+        bytecpy(Entry->name, (uint8_t *)DirectoryEntry + EXT2_DIRECTORY_ENTRY_HEADER_SIZE, nameLength);
+        Entry->name[nameLength] = 0;
+    }
+
+    fileIOScratchRelease(directoryBlock);
+
+    return entriesRead;
+}
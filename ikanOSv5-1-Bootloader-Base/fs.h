@@ -154,8 +154,136 @@ struct cacheLineDetail {
     uint32_t sector;
     uint32_t valid;
     uint32_t accessTime;
+    /** Set when the line holds a write that has not reached the disk yet. */
+    uint32_t dirty;
+    /** Timer tick of the first write since the line was last clean. */
+    uint32_t dirtyTime;
 };
 
+/**
+ * The Block Device structure. Everything in this file reaches the disk through one of these, so the same EXT2 code
+ * can run on the ATA disk in the kernel or on a file backed image in the host side fs-bench harness.
+ */
+struct blockDevice {
+    /** Reads one SECTOR_SIZE sector in LBA format into memory. */
+    void (*readSector)(uint32_t sectorNumber, uint8_t *destinationMemory);
+    /** Writes one SECTOR_SIZE sector in LBA format from memory. */
+    void (*writeSector)(uint32_t sectorNumber, uint8_t *sourceMemory);
+};
+
+/**
+ * The boot readahead list. Kept at BOOT_TRACE_LOC while a boot is being recorded and saved as the contents of
+ * BOOT_TRACE_FILE_NAME for the next boot to prefetch.
+ */
+struct bootTrace {
+    uint32_t magic;
+    uint32_t numberOfBlocks;
+    /** EXT2 block numbers in the order the boot first read them. */
+    uint32_t blocks[BOOT_TRACE_MAX_BLOCKS];
+};
+
+/**
+ * What fsCheck() found. Every count except the totals at the top is a kind of problem, and problemsFound is their sum.
+ */
+struct fsCheckReport {
+    /** Inodes checked, the ones marked in the inode bitmap or named by a directory entry. */
+    uint32_t inodesInUse;
+    uint32_t directories;
+    /** Blocks marked in the block bitmap once the check is done. */
+    uint32_t blocksInUse;
+    /** Marked in the block bitmap but not part of any file or of the file system metadata. Reclaimed by a repair. */
+    uint32_t leakedBlocks;
+    /** Part of a file but free in the block bitmap. */
+    uint32_t unmarkedBlocks;
+    /** Claimed by more than one file, or twice by the same one. Reported, not repaired. */
+    uint32_t duplicateBlocks;
+    /** Block numbers outside the file system. Reported, not repaired. */
+    uint32_t badBlockPointers;
+    /** Marked in the inode bitmap with no directory entry and no links, usually left behind by deleteFile(). */
+    uint32_t leakedInodes;
+    /** A live file that no directory entry points at. Reported, not repaired. */
+    uint32_t unattachedInodes;
+    /** Named by a directory entry but free in the inode bitmap. */
+    uint32_t unmarkedInodes;
+    /** i_links_count doesn't match the number of directory entries. */
+    uint32_t badLinkCounts;
+    /** i_blocks doesn't match the blocks the inode points at. */
+    uint32_t badBlockCounts;
+    /** Directory records that point at a free or out of range inode, or whose length runs off the block. */
+    uint32_t badDirectoryEntries;
+    /** The free block, free inode or directory counts in the superblock and group descriptor are wrong. */
+    uint32_t badSummaryCounts;
+    /** Regular files, and how many extents (runs of adjacent blocks) they take up. */
+    uint32_t files;
+    uint32_t fragmentedFiles;
+    uint32_t fileExtents;
+    /** Runs of free blocks in the block bitmap and the longest one, which is the largest file allocateFreeExtent() can place. */
+    uint32_t freeExtents;
+    uint32_t largestFreeExtent;
+    uint32_t problemsFound;
+    uint32_t problemsRepaired;
+};
+
+/**
+ * One directory entry with the inode fields a listing needs, as readDirectoryEntries() returns it.
+ */
+struct directoryListingEntry {
+    uint32_t inode;
+    uint32_t size;
+    uint32_t modifyTime;
+    /** Type in the top four bits, permissions in the rest, as in i_mode. */
+    uint16_t mode;
+    uint16_t linksCount;
+    uint8_t nameLength;
+    /** Null terminated, cut to DIRECTORY_LISTING_NAME_SIZE - 1 characters. */
+    uint8_t name[DIRECTORY_LISTING_NAME_SIZE];
+};
+
+/**
+ * What fsDefragFile() did to one file. A fragment is a run of adjacent blocks, counted in the order the file is read:
+ * the direct blocks, the indirect block, then the blocks it points at.
+ */
+struct fsDefragReport {
+    /** Blocks the file takes up, including the indirect block. Holes are not counted. */
+    uint32_t blocks;
+    uint32_t fragmentsBefore;
+    uint32_t fragmentsAfter;
+    uint32_t blocksMoved;
+};
+
+/**
+ * Switches the disk that diskReadSector() and diskWriteSector() use. The default is the primary ATA disk.
+ * \param BlockDevice The device to use from now on.
+ */
+void fsSetBlockDevice(struct blockDevice *BlockDevice);
+
+/**
+ * Sets the function called whenever a file's contents change, the file is deleted or its inode number is handed out again.
+ * The kernel uses it to drop stale pages from the mmap page cache, which lives outside fs.o. No handler by default.
+ * \param InodeChangedHandler The function to call with the inode number, or 0 for none.
+ */
+void fsSetInodeChangedHandler(void (*InodeChangedHandler)(uint32_t inodeNumber));
+
+/**
+ * Tells the inode changed handler, if there is one, that an inode's contents are no longer what was read before.
+ * \param inodeNumber The inode that changed.
+ */
+void fsInodeChanged(uint32_t inodeNumber);
+
+/**
+ * Reads a 512-byte sector from the primary ATA disk using LBA format. The readSector of the default block device.
+ * \param sectorNumber The sector to read in LBA format.
+ * \param destinationMemory The pointer to the destination memory to write the sector.
+ */
+void ataReadSector(uint32_t sectorNumber, uint8_t *destinationMemory);
+
+/**
+ * Writes 512 bytes of memory to a sector of the primary ATA disk. The writeSector of the default block device.
+ * \param sectorNumber The sector to write in LBA format.
+ * \param sourceMemory The pointer to the memory to write to the sector.
+ */
+void ataWriteSector(uint32_t sectorNumber, uint8_t *sourceMemory);
+
 /**
  * Checks hard disk status and loops again if not ready.
  */
@@ -178,7 +306,78 @@ void diskReadSector(uint32_t sectorNumber, uint8_t *destinationMemory, bool cach
 void diskWriteSector(uint32_t sectorNumber, uint8_t *sourceMemory, bool cacheActive);
 
 /**
- * Reads an EXT2 block number and writes 1024 bytes of the block to the destination memory address.
+ * Picks a cache line to load a new sector into: an invalid line if there is one, otherwise the LRU line,
+ * which is written back first if dirty. Returns the line number. The caller must hold the cache lock.
+ */
+uint32_t cacheAllocateLine();
+
+/**
+ * Writes one dirty cache line to the disk and marks it clean. The caller must hold the cache lock.
+ * \param cacheLine The cache line.
+ */
+void cacheWriteBackLine(uint32_t cacheLine);
+
+/**
+ * Writes back every dirty cache line that has been dirty for at least minimumAge timer ticks, in ascending LBA order.
+ * The caller must hold the cache lock.
+ * \param minimumAge The age in timer ticks. Zero writes back everything.
+ */
+void cacheWriteBackDirty(uint32_t minimumAge);
+
+/**
+ * Takes the cache lock and writes back dirty sectors older than minimumAge. See cacheWriteBackDirty().
+ * \param minimumAge The age in timer ticks. Zero writes back everything.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void diskFlushCache(uint32_t minimumAge, bool cacheActive);
+
+/**
+ * Writes back the dirty sectors of one EXT2 block.
+ * \param blockNumber This is the EXT2 block number, not the disk LBA sector.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void diskFlushBlock(uint32_t blockNumber, bool cacheActive);
+
+/**
+ * The background flusher, called from the system timer. Commits an idle journal transaction and, every
+ * DISK_FLUSH_INTERVAL ticks, writes back sectors that have been dirty longer than the configured writeback age.
+ * Both are skipped for the tick when the code it interrupted holds the journal or the disk cache lock.
+ * \param timerTicks The current system timer interrupt count.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void diskFlushTimerTick(uint32_t timerTicks, bool cacheActive);
+
+/**
+ * Loads every sector of a list of EXT2 blocks into the disk read cache in one pass, lowest LBA first, so later
+ * readBlock() calls for them are cache hits. Sorts blockList in place. Sectors already cached are skipped.
+ * \param blockList The EXT2 block numbers, not disk LBA sectors.
+ * \param numberOfBlocks The number of entries in blockList.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void diskPrefetchBlocks(uint32_t *blockList, uint32_t numberOfBlocks, bool cacheActive);
+
+/**
+ * Called once at boot after the journal is replayed. Prefetches the blocks the last boot recorded in BOOT_TRACE_FILE_NAME,
+ * then starts recording this boot's block reads at BOOT_TRACE_LOC. Does nothing if the file is missing.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void bootTraceReplay(bool cacheActive);
+
+/**
+ * Adds a block to the boot trace if one is being recorded and the block isn't in it yet. Called by readBlock().
+ * \param blockNumber This is the EXT2 block number, not the disk LBA sector.
+ */
+void bootTraceRecord(uint32_t blockNumber);
+
+/**
+ * Stops recording and writes the trace over BOOT_TRACE_FILE_NAME for the next boot. Does nothing if no trace is being recorded.
+ * Takes the file system locks itself.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void bootTraceSave(bool cacheActive);
+
+/**
+ * Reads an EXT2 block number and writes BLOCK_SIZE bytes of the block to the destination memory address.
  * \param blockNumber This is the EXT2 block number, not the disk LBA sector. 
  * \param destinationMemory The pointer to the destination memory to write the block.
  * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
@@ -186,18 +385,53 @@ void diskWriteSector(uint32_t sectorNumber, uint8_t *sourceMemory, bool cacheAct
 void readBlock(uint32_t blockNumber, uint8_t *destinationMemory, bool cacheActive);
 
 /**
- * Writes 1024 bytes of memory to an EXT2 block number. The opposite of readBlock(). 
+ * Writes BLOCK_SIZE bytes of memory to an EXT2 block number. The opposite of readBlock(). 
  * \param blockNumber This is the EXT2 block number, not the disk LBA sector. 
- * \param sourceMemory This is the starting pointing to write 1024 bytes to the EXT2 block.
+ * \param sourceMemory This is the starting pointing to write BLOCK_SIZE bytes to the EXT2 block.
  * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
  */
 void writeBlock(uint32_t blockNumber, uint8_t *sourceMemory, bool cacheActive);
 
+/** Returns the bit of the block bitmap that stands for a block. Bit 0 is EXT2_FIRST_DATA_BLOCK, which depends on BLOCK_SIZE.
+ * \param blockNumber This is the EXT2 block number, not the disk LBA sector.
+ */
+uint32_t blockBitmapIndex(uint32_t blockNumber);
+
+/** The opposite of blockBitmapIndex(). Returns the block a bit of the block bitmap stands for.
+ * \param bitIndex The bit, counted from bit 0 of the first byte.
+ */
+uint32_t blockFromBitmapIndex(uint32_t bitIndex);
+
+/** Returns true if a bit of an EXT2 block or inode bitmap is set.
+ * \param bitmap The bitmap, usually EXT2_BLOCK_USAGE_MAP or EXT2_INODE_USAGE_MAP.
+ * \param bitIndex The bit, counted from bit 0 of the first byte.
+ */
+bool bitmapTest(uint8_t *bitmap, uint32_t bitIndex);
+
+/** Sets a bit of an EXT2 block or inode bitmap.
+ * \param bitmap The bitmap, usually EXT2_BLOCK_USAGE_MAP or EXT2_INODE_USAGE_MAP.
+ * \param bitIndex The bit, counted from bit 0 of the first byte.
+ */
+void bitmapSet(uint8_t *bitmap, uint32_t bitIndex);
+
+/** Clears a bit of an EXT2 block or inode bitmap.
+ * \param bitmap The bitmap, usually EXT2_BLOCK_USAGE_MAP or EXT2_INODE_USAGE_MAP.
+ * \param bitIndex The bit, counted from bit 0 of the first byte.
+ */
+void bitmapClear(uint8_t *bitmap, uint32_t bitIndex);
+
 /** Finds a free block and returns the block number.
  * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel. 
  */
 uint32_t allocateFreeBlock(bool cacheActive);
 
+/** Finds a run of free blocks next to each other, marks all of them used with one bitmap update and returns the first
+ * block number. Returns 0 if there is no run that long, in which case nothing is allocated.
+ * \param numberOfBlocks How many blocks the run needs.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+uint32_t allocateFreeExtent(uint32_t numberOfBlocks, bool cacheActive);
+
 /** Returns the next available block number without actually allocating it.
  * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
 */
@@ -245,29 +479,64 @@ uint32_t readNextAvailableInode(bool cacheActive);
  */
 void deleteDirectoryEntry(uint8_t *fileName, bool cacheActive, uint32_t directoryInode);
 
-/** Creates a new file based on an open buffer/file descriptor.
+/** Creates a new file based on an open buffer/file descriptor. Returns false, and leaves the directory as it was,
+ * if the directory has no room for the entry or the buffer is too large for one indirect block to map.
  * \param fileName The name you'd like the new file to be called.
  * \param currentPid The pid of the process requesting the new file.
  * \param fileDescriptor The file descriptor that serves as the basis for the new file's contents.
  * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
  * \param directoryInode Current working directory.
  */
-void createFile(uint8_t *fileName, uint32_t currentPid, uint32_t fileDescriptor, bool cacheActive, uint32_t directoryInode);
+bool createFile(uint8_t *fileName, uint32_t currentPid, uint32_t fileDescriptor, bool cacheActive, uint32_t directoryInode);
 
-/** Creates an inode entry on the disk.
+/** Creates an inode entry on the disk. Returns false without writing the inode if writeBufferToDisk() fails.
  * \param inodeEntry The inode associated with the file you wish to write.
  * \param mode The EXT2 mode value for the permissions/file type, etc.
  * \param openFile The pointer to the open file table entry associated with the buffer/file descriptor.
  * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
  */
-void writeInodeEntry(uint32_t inodeEntry, uint16_t mode, struct globalObjectTableEntry *openFile, bool cacheActive);
+bool writeInodeEntry(uint32_t inodeEntry, uint16_t mode, struct globalObjectTableEntry *openFile, bool cacheActive);
 
-/** Given a file name and inode entry, writes the buffer to disk.
+/** Given a file name and inode entry, writes the buffer to disk. Blocks are not picked until here, and then the whole
+ * file (and its indirect block) gets one extent so it lands contiguous on disk. Returns false, with nothing allocated,
+ * if the buffer needs more blocks than the direct blocks and one indirect block can map.
  * \param openFile The pointer to the open file table entry associated with the buffer/file descriptor.
  * \param inodeEntry The inode associated with the file.
  * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
  */
-void writeBufferToDisk(struct globalObjectTableEntry *openFile, uint32_t inodeEntry, bool cacheActive);
+bool writeBufferToDisk(struct globalObjectTableEntry *openFile, uint32_t inodeEntry, bool cacheActive);
+
+/**
+ * Returns the disk block holding a block of a file, or 0 for a hole or a block past what the direct and single indirect blocks map.
+ * \param Inode The file's inode.
+ * \param fileBlock The block number within the file.
+ * \param indirectBlockMemory A BLOCK_SIZE scratch buffer for the indirect block.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+uint32_t fileBlockToDiskBlock(struct inode *Inode, uint32_t fileBlock, uint8_t *indirectBlockMemory, bool cacheActive);
+
+/**
+ * Reads up to length bytes of a file starting at a byte offset, one block at a time, without loading the whole file.
+ * Returns the number of bytes read, which is 0 at or past the end of the file.
+ * \param inodeNumber The inode of the file.
+ * \param offset The byte offset into the file.
+ * \param destinationMemory Where to copy the bytes.
+ * \param length The number of bytes requested.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+uint32_t readFileAtOffset(uint32_t inodeNumber, uint32_t offset, uint8_t *destinationMemory, uint32_t length, bool cacheActive);
+
+/**
+ * Writes length bytes into a file starting at a byte offset. Blocks are allocated as the file grows and the
+ * size is extended when writing past the end. Returns the number of bytes written, short if the disk fills up
+ * or the file reaches the largest size the direct and single indirect blocks can map.
+ * \param inodeNumber The inode of the file.
+ * \param offset The byte offset into the file.
+ * \param sourceMemory The bytes to write.
+ * \param length The number of bytes to write.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+uint32_t writeFileAtOffset(uint32_t inodeNumber, uint32_t offset, uint8_t *sourceMemory, uint32_t length, bool cacheActive);
 
 /**
  * Checks to see if a file name exists in the current directory of the file system. If found, stores the inode to the destinationMemory location.
@@ -302,10 +571,189 @@ void loadFileFromInodeStruct(uint8_t *inodeStructMemory, uint8_t *fileBuffer, bo
 
 void loadInode(uint32_t inodeNumber, uint8_t* memoryAddress, bool cacheActive);
 
+/**
+ * Same as loadInode() but reads the inode table block into the caller's buffer instead of KERNEL_TEMP_INODE_LOC,
+ * so it can run without fsMetadataLock().
+ * \param inodeNumber The inode to load.
+ * \param memoryAddress Where to copy the INODE_SIZE bytes of the inode.
+ * \param blockBuffer A BLOCK_SIZE scratch buffer.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void loadInodeUsingBuffer(uint32_t inodeNumber, uint8_t* memoryAddress, uint8_t *blockBuffer, bool cacheActive);
+
+/**
+ * Writes one inode back to the inode table through the journal. The counterpart of loadInode().
+ * \param inodeNumber The inode to write.
+ * \param memoryAddress The INODE_SIZE bytes of the inode.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void writeInode(uint32_t inodeNumber, uint8_t* memoryAddress, bool cacheActive);
+
 bool getFilenameFromInode(uint32_t inodeNumber, uint8_t *destinationMemory, bool cacheActive, uint32_t directoryInode);
 
 void moveFile(uint8_t *fileName, uint8_t *sourceDirectory, uint8_t *destinationDirectory, bool cacheActive);
 
 void changeFileMode(uint8_t *fileName, uint16_t newMode, uint32_t currentPid, bool cacheActive, uint32_t directoryInode);
 
-uint32_t getInodeFromPath(uint8_t *path, bool cacheActive);
\ No newline at end of file
+uint32_t getInodeFromPath(uint8_t *path, bool cacheActive);
+
+/**
+ * Takes a reader-writer spin lock for reading. Any number of readers can hold it together, but not while a writer holds it
+ * or is waiting for it.
+ * \param lockWord The lock, from inodeLock() or directoryLock().
+ */
+void fsLockRead(uint32_t *lockWord);
+
+/**
+ * Releases a lock taken with fsLockRead().
+ * \param lockWord The lock, from inodeLock() or directoryLock().
+ */
+void fsUnlockRead(uint32_t *lockWord);
+
+/**
+ * Takes a reader-writer spin lock for writing. New readers are held off while the writer waits for the current ones to leave.
+ * \param lockWord The lock, from inodeLock() or directoryLock().
+ */
+void fsLockWrite(uint32_t *lockWord);
+
+/**
+ * Releases a lock taken with fsLockWrite().
+ * \param lockWord The lock, from inodeLock() or directoryLock().
+ */
+void fsUnlockWrite(uint32_t *lockWord);
+
+/**
+ * Returns the reader-writer lock for a file's inode and data. Inodes share FS_LOCK_BUCKETS locks, so never hold two at once.
+ * \param inodeNumber The inode of the file.
+ */
+uint32_t *inodeLock(uint32_t inodeNumber);
+
+/**
+ * Returns the reader-writer lock for a directory's entries. Take it before any inode lock.
+ * \param directoryInode The inode of the directory.
+ */
+uint32_t *directoryLock(uint32_t directoryInode);
+
+/**
+ * Serializes everything that uses the shared directory, inode table and bitmap scratch buffers (KERNEL_WORKING_DIR,
+ * KERNEL_TEMP_INODE_LOC, EXT2_TEMP_INODE_STRUCTS, EXT2_BLOCK_USAGE_MAP and friends). Always taken last, after any
+ * directory or inode lock, and never held across sysWait().
+ */
+void fsMetadataLock();
+
+/**
+ * Releases fsMetadataLock().
+ */
+void fsMetadataUnlock();
+
+/**
+ * Claims one of the FILE_IO_SCRATCH_SLOTS buffers so reads on different CPUs don't share FILE_IO_BLOCK_LOC. Spins while
+ * every slot is taken. The slot holds a data block, an indirect block and an inode table block, in that order.
+ */
+uint8_t *fileIOScratchAcquire();
+
+/**
+ * Gives back a buffer from fileIOScratchAcquire().
+ * \param scratch The buffer.
+ */
+void fileIOScratchRelease(uint8_t *scratch);
+
+/**
+ * Marks a block as reachable in FSCK_BLOCK_MAP for fsCheck(), counting it as a duplicate if it already was.
+ * Returns false if the block number is outside the file system.
+ * \param blockNumber This is the EXT2 block number, not the disk LBA sector.
+ * \param Report The report to count problems in.
+ */
+bool fsCheckMarkBlock(uint32_t blockNumber, struct fsCheckReport *Report);
+
+/**
+ * Marks a block and, for an indirect block, everything under it. Returns the number of extents the blocks start, so the caller
+ * can tell how fragmented the file is.
+ * \param blockNumber The block an inode or indirect block points at.
+ * \param level 0 for a data block, 1 for a single indirect block, up to FSCK_INDIRECT_LEVELS.
+ * \param previousBlock The last block walked in this file, 0 at the start. Updated as blocks are walked.
+ * \param blocksWalked Incremented for every block walked, including indirect blocks.
+ * \param Report The report to count problems in.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+uint32_t fsCheckWalkBlocks(uint32_t blockNumber, uint32_t level, uint32_t *previousBlock, uint32_t *blocksWalked, struct fsCheckReport *Report, bool cacheActive);
+
+/**
+ * The first pass of fsCheck(). Counts the entries of one directory in FSCK_LINK_COUNTS and adds the directories it holds
+ * to FSCK_DIRECTORY_QUEUE. A repair drops entries that point at a free inode.
+ * \param directoryInode The directory to read.
+ * \param queueLength The number of directories in FSCK_DIRECTORY_QUEUE. Updated as directories are added.
+ * \param Report The report to count problems in.
+ * \param repair Fix what can be fixed.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void fsCheckDirectory(uint32_t directoryInode, uint32_t *queueLength, struct fsCheckReport *Report, bool repair, bool cacheActive);
+
+/**
+ * The second pass of fsCheck(). Checks one inode's link count and block count against the first pass and marks its blocks.
+ * A repair frees an inode no directory points at if it has no links, and leaves its blocks for the bitmap pass to reclaim.
+ * \param inodeNumber The inode to check.
+ * \param Report The report to count problems in.
+ * \param repair Fix what can be fixed.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void fsCheckInode(uint32_t inodeNumber, struct fsCheckReport *Report, bool repair, bool cacheActive);
+
+/**
+ * The third pass of fsCheck(). Compares EXT2_BLOCK_USAGE_MAP with the blocks the other passes found and measures the free space.
+ * A repair frees leaked blocks and marks unmarked ones.
+ * \param Report The report to count problems in.
+ * \param repair Fix what can be fixed.
+ */
+void fsCheckBitmaps(struct fsCheckReport *Report, bool repair);
+
+/**
+ * The last pass of fsCheck(). Checks the free block, free inode and directory counts in the superblock and group descriptor.
+ * \param Report The report to count problems in.
+ * \param repair Fix what can be fixed.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void fsCheckSummaryCounts(struct fsCheckReport *Report, bool repair, bool cacheActive);
+
+/**
+ * Checks the file system against itself: the block and inode bitmaps against the inodes, link counts against directory entries,
+ * and directory entries against the inode table. Only inodes marked in the bitmap and directories reachable from the root are read,
+ * so it is quick enough to run at every boot. Takes the file system locks itself. Returns the number of problems found.
+ * \param Report Filled in with what was found and repaired.
+ * \param repair Fix what can be fixed through the journal. Otherwise nothing is written. A repair is not one transaction: each
+ * directory block and inode it fixes is its own handle, and the bitmaps and free counts go together last, so the journal
+ * may commit between any two of them and every commit leaves the file system consistent.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+uint32_t fsCheck(struct fsCheckReport *Report, bool repair, bool cacheActive);
+
+/**
+ * Counts the runs of adjacent blocks in a list of block numbers. Zero entries are holes and don't break a run.
+ * \param blockList The block numbers in the order the file is read.
+ * \param numberOfBlocks The number of entries in blockList.
+ */
+uint32_t fsDefragCountFragments(uint32_t *blockList, uint32_t numberOfBlocks);
+
+/**
+ * Moves a fragmented file into one run of free blocks. The data is copied first, then the inode, the indirect block and the block
+ * bitmap change in a single journal transaction, so after a crash the file is either all in its old blocks or all in its new ones.
+ * Leaves the file where it is if no free run is long enough. Takes the file system locks itself. Returns false for anything that
+ * isn't a regular file fsDefragFile() can move: a free or reserved inode, a directory, or a file with double indirect blocks.
+ * \param inodeNumber The file to move.
+ * \param Report Filled in with the fragments before and after.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+bool fsDefragFile(uint32_t inodeNumber, struct fsDefragReport *Report, bool cacheActive);
+
+/**
+ * Reads a directory's entries, with each entry's inode, into a list. Picks up at position and moves it past the entries read,
+ * so a large directory can be read in batches. The directory blocks are read directly and each inode table block is read once
+ * for the run of entries whose inodes are in it, instead of a lookup per name. The caller holds the directory's lock.
+ * Returns the number of entries read, 0 once the whole directory has been read.
+ * \param directoryInode The directory to read.
+ * \param position The byte offset in the directory to start at, 0 for the first entry. Updated for the next call.
+ * \param Entries Where to put the entries.
+ * \param maxEntries The number of entries there is room for.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+uint32_t readDirectoryEntries(uint32_t directoryInode, uint32_t *position, struct directoryListingEntry *Entries, uint32_t maxEntries, bool cacheActive);
@@ -0,0 +1,73 @@
+// Copyright (c) 2025-2026 Dan O’Malley
+// This file is licensed under the MIT License. See LICENSE for details.
+
+
+#include "screen.h"
+#include "keyboard.h"
+#include "libc-main.h"
+#include "constants.h"
+#include "x86.h"
+#include "file.h"
+#include "fs.h"
+
+void main()
+{
+    uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+
+    // sh leaves "fsck\0-r" in COMMAND_BUFFER
+    bool repair = (strcmp((uint8_t*)(COMMAND_BUFFER + 5), (uint8_t*)"-r") == 0);
+
+    struct fsCheckReport *Report = (struct fsCheckReport *)malloc(currentPid, sizeof(fsCheckReport));
+
+    clearScreen();
+
+    uint32_t row = 3;
+    uint32_t column = 3;
+
+    if (repair)
+    {
+        printf(COLOR_GREEN, row++, column, (uint8_t*)"Checking and repairing the file system.");
+    }
+    else
+    {
+        printf(COLOR_GREEN, row++, column, (uint8_t*)"Checking the file system (fsck -r to repair).");
+    }
+    row++;
+
+    if (systemFsCheck(Report, repair) == SYSCALL_FAIL)
+    {
+        printf(COLOR_RED, row++, column, (uint8_t*)"The check could not be run.");
+    }
+    else
+    {
+        printf(COLOR_LIGHT_BLUE, row++, column, (uint8_t*)"Inodes in use: %d (%d directories)", Report->inodesInUse, Report->directories);
+        printf(COLOR_LIGHT_BLUE, row++, column, (uint8_t*)"Blocks in use: %d", Report->blocksInUse);
+        row++;
+        printf(COLOR_WHITE, row++, column, (uint8_t*)"Leaked blocks: %d   Unmarked blocks: %d", Report->leakedBlocks, Report->unmarkedBlocks);
+        printf(COLOR_WHITE, row++, column, (uint8_t*)"Duplicate blocks: %d   Bad block pointers: %d", Report->duplicateBlocks, Report->badBlockPointers);
+        printf(COLOR_WHITE, row++, column, (uint8_t*)"Leaked inodes: %d   Unattached inodes: %d   Unmarked inodes: %d", Report->leakedInodes, Report->unattachedInodes, Report->unmarkedInodes);
+        printf(COLOR_WHITE, row++, column, (uint8_t*)"Bad link counts: %d   Bad block counts: %d", Report->badLinkCounts, Report->badBlockCounts);
+        printf(COLOR_WHITE, row++, column, (uint8_t*)"Bad directory entries: %d   Bad summary counts: %d", Report->badDirectoryEntries, Report->badSummaryCounts);
+        row++;
+        printf(COLOR_LIGHT_BLUE, row++, column, (uint8_t*)"Files: %d   Fragmented: %d   File extents: %d", Report->files, Report->fragmentedFiles, Report->fileExtents);
+        printf(COLOR_LIGHT_BLUE, row++, column, (uint8_t*)"Free extents: %d   Largest free extent: %d blocks", Report->freeExtents, Report->largestFreeExtent);
+        row++;
+
+        if (Report->problemsFound == 0)
+        {
+            printf(COLOR_GREEN, row++, column, (uint8_t*)"The file system is clean.");
+        }
+        else
+        {
+            printf(COLOR_RED, row++, column, (uint8_t*)"Problems found: %d   Repaired: %d", Report->problemsFound, Report->problemsRepaired);
+        }
+    }
+
+    free((uint8_t *)Report);
+
+    row+= 2;
+    printf(COLOR_WHITE, row++, column, (uint8_t*)"Press Enter to quit.");
+
+    waitForEnterOrQuit();
+    systemExit(PROCESS_EXIT_CODE_SUCCESS);
+}
@@ -11,6 +11,8 @@
 #include "file.h"
 
 #define MAX_LINE_LENGTH 80
+#define GREP_CHUNK_SIZE 0x200
+#define GREP_LAST_ROW 46
 
 
 // Custom strncmp implementation
@@ -40,6 +42,90 @@ uint8_t *my_strstr(uint8_t *haystack, uint8_t *needle) {
     return 0;
 }
 
+// sh leaves "grep\0word\0file" in COMMAND_BUFFER when grep runs on its own. As the second half of a pipe
+// it only gets "word". Everything after the last token is zeroed, so a missing argument is an empty string.
+uint8_t *commandArgument(uint32_t argumentNumber)
+{
+    uint8_t *argument = COMMAND_BUFFER;
+
+    for (uint32_t x = 0; x < argumentNumber && *argument != 0; x++)
+    {
+        argument = argument + strlen(argument) + 1;
+    }
+
+    return argument;
+}
+
+// Streams the file through one small buffer and prints the matching lines, so the file can be any size.
+// Lines longer than MAX_LINE_LENGTH are matched and printed on their first MAX_LINE_LENGTH characters.
+void grepFile(uint32_t currentPid, uint8_t *searchWord, uint8_t *fileName)
+{
+    uint8_t *chunk = malloc(currentPid, GREP_CHUNK_SIZE);
+    uint8_t *line = malloc(currentPid, MAX_LINE_LENGTH + 1);
+    uint32_t lineLength = 0;
+    uint32_t bytesRead = 0;
+    uint32_t row = 0;
+    bool quit = false;
+
+    clearScreen();
+
+    if (systemOpenFileStream(fileName, RDONLY) == SYSCALL_FAIL)
+    {
+        printString(COLOR_RED, 0, 0, (uint8_t *)"No such file!");
+        free(line);
+        free(chunk);
+        return;
+    }
+
+    uint32_t fileDescriptor = readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR);
+
+    while (!quit)
+    {
+        bytesRead = systemReadFile(fileDescriptor, chunk, GREP_CHUNK_SIZE);
+        if (bytesRead == SYSCALL_FAIL) { bytesRead = 0; }
+
+        for (uint32_t x = 0; x <= bytesRead && !quit; x++)
+        {
+            // The end of the file finishes the last line even without a newline
+            bool endOfLine = (x == bytesRead) ? (bytesRead == 0 && lineLength > 0) : (chunk[x] == 0x0a);
+
+            if (!endOfLine)
+            {
+                if (x < bytesRead && lineLength < MAX_LINE_LENGTH) { line[lineLength++] = chunk[x]; }
+                continue;
+            }
+
+            line[lineLength] = 0;
+            lineLength = 0;
+
+            if (my_strstr(line, searchWord) != 0)
+            {
+                printString(COLOR_WHITE, row++, 0, line);
+            }
+
+            if (row > GREP_LAST_ROW)
+            {
+                printString(COLOR_LIGHT_BLUE, GREP_LAST_ROW + 2, 0, (uint8_t *)"Enter = next page, Q = quit");
+                quit = (waitForEnterOrQuit() == 0);
+                clearScreen();
+                row = 0;
+            }
+        }
+
+        if (bytesRead == 0) { break; }
+    }
+
+    systemCloseFile(fileDescriptor);
+    free(line);
+    free(chunk);
+
+    if (!quit)
+    {
+        printString(COLOR_LIGHT_BLUE, GREP_LAST_ROW + 2, 0, (uint8_t *)"Press Enter to quit.");
+        waitForEnterOrQuit();
+    }
+}
+
 void main() 
 {
     uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
@@ -49,6 +135,13 @@ void main()
     itoa(0, pipeInFdString);
     itoa(1, pipeOutFdString);
 
+    // Run on its own as "grep word file"
+    if (*commandArgument(2) != 0)
+    {
+        grepFile(currentPid, commandArgument(1), commandArgument(2));
+        systemExit(PROCESS_EXIT_CODE_SUCCESS);
+    }
+
     // Get the search word from command arguments, similar to edlin.cpp
     uint8_t *searchWord = (uint8_t *)malloc(currentPid, MAX_LINE_LENGTH + 1);
     uint8_t *commandLine = (uint8_t *)COMMAND_BUFFER;
@@ -0,0 +1,182 @@
+// Copyright (c) 2023-2026 Dan O’Malley
+// This file is licensed under the MIT License. See LICENSE for details.
+
+
+#include "initramfs.h"
+#include "fs.h"
+#include "file.h"
+#include "vm.h"
+#include "libc-main.h"
+#include "constants.h"
+
+// The boot time binaries (init, sh, bin/ and libc.o) are packed by mkinitramfs into one LZ4 compressed
+// archive that sits after the EXT2 image on the disk. It is read into memory once at boot and never
+// written, so exec of those binaries is a name lookup in the index and one decompression instead of a
+// directory walk and a block by block load from EXT2. A file in the initramfs hides any EXT2 file of the same name.
+
+bool initramfsMounted = false;
+
+
+bool initramfsMount()
+{
+    struct initramfsHeader *InitramfsHeader = (struct initramfsHeader *)INITRAMFS_LOC;
+
+    initramfsMounted = false;
+
+    // Not through the sector cache, nothing else ever reads these sectors
+    diskReadSector(INITRAMFS_SECTOR_START, INITRAMFS_LOC, false);
+
+    if (InitramfsHeader->magic != INITRAMFS_MAGIC || InitramfsHeader->archiveSize > INITRAMFS_MAX_SIZE
+        || InitramfsHeader->archiveSize < (sizeof(initramfsHeader) + (InitramfsHeader->numberOfEntries * sizeof(initramfsEntry))))
+    {
+        return false;
+    }
+
+    for (uint32_t sector = 1; sector < ceiling(InitramfsHeader->archiveSize, SECTOR_SIZE); sector++)
+    {
+        diskReadSector(INITRAMFS_SECTOR_START + sector, INITRAMFS_LOC + (sector * SECTOR_SIZE), false);
+    }
+
+    initramfsMounted = true;
+
+    return true;
+}
+
+struct initramfsEntry *initramfsFind(uint8_t *fileName)
+{
+    if (!initramfsMounted)
+    {
+        return 0;
+    }
+
+    struct initramfsHeader *InitramfsHeader = (struct initramfsHeader *)INITRAMFS_LOC;
+    struct initramfsEntry *InitramfsEntry = (struct initramfsEntry *)(INITRAMFS_LOC + sizeof(initramfsHeader));
+
+    for (uint32_t entry = 0; entry < InitramfsHeader->numberOfEntries; entry++)
+    {
+        uint32_t i = 0;
+        while (i < INITRAMFS_MAX_NAME_LENGTH && InitramfsEntry[entry].name[i] != 0 && InitramfsEntry[entry].name[i] == fileName[i])
+        {
+            i++;
+        }
+
+        if (i < INITRAMFS_MAX_NAME_LENGTH && InitramfsEntry[entry].name[i] == 0 && fileName[i] == 0)
+        {
+            return &InitramfsEntry[entry];
+        }
+    }
+
+    return 0;
+}
+
+bool initramfsFindFile(uint8_t *fileName, uint8_t *destinationMemory)
+{
+    struct initramfsEntry *InitramfsEntry = initramfsFind(fileName);
+
+    if (InitramfsEntry == 0)
+    {
+        return false;
+    }
+
+    struct inode *Inode = (struct inode *)destinationMemory;
+
+    fillMemory(destinationMemory, 0x0, INODE_SIZE);
+    Inode->i_mode = InitramfsEntry->mode;
+    Inode->i_size = InitramfsEntry->size;
+
+    return true;
+}
+
+bool initramfsLoadFile(uint8_t *fileName, uint8_t *fileBuffer)
+{
+    struct initramfsEntry *InitramfsEntry = initramfsFind(fileName);
+    struct initramfsHeader *InitramfsHeader = (struct initramfsHeader *)INITRAMFS_LOC;
+
+    if (InitramfsEntry == 0 || InitramfsEntry->dataOffset > InitramfsHeader->archiveSize
+        || InitramfsEntry->compressedSize > (InitramfsHeader->archiveSize - InitramfsEntry->dataOffset))
+    {
+        return false;
+    }
+
+    return lz4DecompressBlock(INITRAMFS_LOC + InitramfsEntry->dataOffset, InitramfsEntry->compressedSize, fileBuffer, InitramfsEntry->size) == InitramfsEntry->size;
+}
+
+uint32_t lz4DecompressBlock(uint8_t *sourceMemory, uint32_t sourceLength, uint8_t *destinationMemory, uint32_t destinationLength)
+{
+    uint32_t sourcePosition = 0;
+    uint32_t destinationPosition = 0;
+
+    // Each sequence is a token, some literals copied as is, then a match copied from earlier output
+    while (sourcePosition < sourceLength)
+    {
+        uint8_t token = sourceMemory[sourcePosition++];
+        uint32_t literalLength = token >> 4;
+        uint8_t extraLength = 0xFF;
+
+        if (literalLength == 0xF)
+        {
+            while (extraLength == 0xFF)
+            {
+                if (sourcePosition >= sourceLength) { return 0; }
+                extraLength = sourceMemory[sourcePosition++];
+                literalLength = literalLength + extraLength;
+            }
+        }
+
+        if (literalLength > (sourceLength - sourcePosition) || literalLength > (destinationLength - destinationPosition))
+        {
+            return 0;
+        }
+
+        bytecpy(destinationMemory + destinationPosition, sourceMemory + sourcePosition, literalLength);
+        sourcePosition = sourcePosition + literalLength;
+        destinationPosition = destinationPosition + literalLength;
+
+        // The last sequence is literals only
+        if (sourcePosition == sourceLength)
+        {
+            break;
+        }
+
+        if ((sourceLength - sourcePosition) < 2)
+        {
+            return 0;
+        }
+
+        uint32_t matchOffset = sourceMemory[sourcePosition] | (sourceMemory[sourcePosition + 1] << 8);
+        uint32_t matchLength = token & 0xF;
+        sourcePosition = sourcePosition + 2;
+
+        if (matchOffset == 0 || matchOffset > destinationPosition)
+        {
+            return 0;
+        }
+
+        if (matchLength == 0xF)
+        {
+            extraLength = 0xFF;
+            while (extraLength == 0xFF)
+            {
+                if (sourcePosition >= sourceLength) { return 0; }
+                extraLength = sourceMemory[sourcePosition++];
+                matchLength = matchLength + extraLength;
+            }
+        }
+
+        matchLength = matchLength + 4; // LZ4 never encodes a match shorter than 4
+
+        if (matchLength > (destinationLength - destinationPosition))
+        {
+            return 0;
+        }
+
+        // A byte at a time because the match may overlap the bytes it is producing
+        for (uint32_t i = 0; i < matchLength; i++)
+        {
+            destinationMemory[destinationPosition] = destinationMemory[destinationPosition - matchOffset];
+            destinationPosition++;
+        }
+    }
+
+    return destinationPosition;
+}
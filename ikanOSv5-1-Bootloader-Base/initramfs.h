@@ -0,0 +1,72 @@
+// Copyright (c) 2023-2026 Dan O’Malley
+// This file is licensed under the MIT License. See LICENSE for details.
+
+
+#include "constants.h"
+
+/**
+ * The start of the initramfs archive. The index (numberOfEntries initramfsEntry structures) follows it,
+ * then the LZ4 compressed contents of each file.
+ */
+struct initramfsHeader
+{
+    uint32_t magic;
+    uint32_t numberOfEntries;
+    /** Bytes in the whole archive, header and index included. */
+    uint32_t archiveSize;
+};
+
+/**
+ * One file in the initramfs index.
+ */
+struct initramfsEntry
+{
+    /** The file name with no directory. */
+    uint8_t name[INITRAMFS_MAX_NAME_LENGTH];
+    /** Same bits as an EXT2 i_mode. */
+    uint16_t mode;
+    uint16_t reserved;
+    /** Bytes once decompressed. */
+    uint32_t size;
+    /** Where the LZ4 block starts, counted from the start of the archive. */
+    uint32_t dataOffset;
+    uint32_t compressedSize;
+};
+
+/**
+ * Reads the archive the Makefile appends to fs.img at INITRAMFS_SECTOR_START into INITRAMFS_LOC and mounts it read-only.
+ * Returns false, and leaves everything to EXT2, if there is no valid archive there.
+ */
+bool initramfsMount();
+
+/**
+ * Returns the index entry for a file or 0 if the initramfs doesn't have it or isn't mounted.
+ * \param fileName The file name with no directory and no newline.
+ */
+struct initramfsEntry *initramfsFind(uint8_t *fileName);
+
+/**
+ * The initramfs version of fsFindFile(). Fills in an inode with just the mode and size of the file.
+ * Returns false if the file isn't in the initramfs.
+ * \param fileName The file name with no directory and no newline.
+ * \param destinationMemory Where to put the INODE_SIZE bytes of the inode.
+ */
+bool initramfsFindFile(uint8_t *fileName, uint8_t *destinationMemory);
+
+/**
+ * The initramfs version of loadFileFromInodeStruct(). Decompresses the whole file. Returns false if the file isn't in
+ * the initramfs or its data is damaged.
+ * \param fileName The file name with no directory and no newline.
+ * \param fileBuffer Where to put the file. Must hold the size initramfsFindFile() reported.
+ */
+bool initramfsLoadFile(uint8_t *fileName, uint8_t *fileBuffer);
+
+/**
+ * Decompresses one raw LZ4 block (no frame header). Returns the number of bytes written, or 0 if the block is
+ * malformed or doesn't fit.
+ * \param sourceMemory The compressed block.
+ * \param sourceLength Bytes in the compressed block.
+ * \param destinationMemory Where to write the decompressed bytes.
+ * \param destinationLength The room at destinationMemory.
+ */
+uint32_t lz4DecompressBlock(uint8_t *sourceMemory, uint32_t sourceLength, uint8_t *destinationMemory, uint32_t destinationLength);
@@ -0,0 +1,351 @@
+// Copyright (c) 2023-2026 Dan O’Malley
+// This file is licensed under the MIT License. See LICENSE for details.
+
+
+#include "journal.h"
+#include "fs.h"
+#include "libc-main.h"
+#include "constants.h"
+#include "x86.h"
+#include "vm.h"
+#include "exceptions.h"
+
+// The running transaction is built in place at JOURNAL_TRANSACTION_LOC exactly as it is laid out
+// in the journal: slot 0 is the descriptor, slots 1..blockCount are the logged blocks and the
+// commit block goes right after the last one. Committing is then one pass over the journal blocks.
+// The journal blocks themselves belong to JOURNAL_FILE_NAME, an ordinary file in the root directory.
+
+bool journalActive = false;
+uint32_t journalHandles = 0;
+uint32_t journalSequence = 1;
+uint32_t journalOpenedAt = 0;
+uint32_t journalLastTick = 0;
+uint32_t journalLocation[JOURNAL_BLOCKS];
+uint32_t journalInode = 0;
+
+
+void journalInit(bool cacheActive)
+{
+    struct journalDescriptor *JournalDescriptor = (struct journalDescriptor *)JOURNAL_TRANSACTION_LOC;
+    uint8_t journalInodeBuf[INODE_SIZE];
+    struct inode *JournalInode = (struct inode *)journalInodeBuf;
+
+    journalActive = false;
+    journalInode = returnInodeofFileName((uint8_t *)JOURNAL_FILE_NAME, cacheActive, ROOTDIR_INODE);
+
+    if (journalInode == 0)
+    {
+        return; // No journal file on this image, metadata keeps going straight to disk
+    }
+
+    loadInode(journalInode, journalInodeBuf, cacheActive);
+
+    // The journal is an ordinary file, so e2fsck and mkfs.ext2 see nothing unusual. The transaction area
+    // doubles as the indirect block buffer since nothing is staged there yet.
+    for (uint32_t x = 0; x < JOURNAL_BLOCKS; x++)
+    {
+        journalLocation[x] = fileBlockToDiskBlock(JournalInode, x, JOURNAL_TRANSACTION_LOC, cacheActive);
+
+        if (journalLocation[x] == 0)
+        {
+            journalInode = 0;
+            return; // Too short or sparse, there is nowhere to log to
+        }
+    }
+
+    fillMemory(JOURNAL_TRANSACTION_LOC, 0x0, JOURNAL_BLOCKS * BLOCK_SIZE);
+
+    // Replay. At most one transaction can be in the journal since every commit is
+    // checkpointed before the next one starts, so recovery is bounded by JOURNAL_BLOCKS reads.
+    readBlock(journalLocation[0], JOURNAL_TRANSACTION_LOC, cacheActive);
+
+    if (JournalDescriptor->magic == JOURNAL_DESCRIPTOR_MAGIC && JournalDescriptor->blockCount > 0 && JournalDescriptor->blockCount <= JOURNAL_MAX_TRANSACTION_BLOCKS)
+    {
+        uint32_t commitSlot = JournalDescriptor->blockCount + 1;
+        struct journalCommitBlock *JournalCommitBlock = (struct journalCommitBlock *)(JOURNAL_TRANSACTION_LOC + (commitSlot * BLOCK_SIZE));
+
+        for (uint32_t slot = 1; slot <= commitSlot; slot++)
+        {
+            readBlock(journalLocation[slot], JOURNAL_TRANSACTION_LOC + (slot * BLOCK_SIZE), cacheActive);
+        }
+
+        // A torn commit (crash before the commit block hit the disk) is simply discarded.
+        // The home locations were never touched so the file system is still consistent.
+        if (JournalCommitBlock->magic == JOURNAL_COMMIT_MAGIC && JournalCommitBlock->sequence == JournalDescriptor->sequence && JournalCommitBlock->checksum == journalChecksum(JournalDescriptor->blockCount))
+        {
+            for (uint32_t x = 0; x < JournalDescriptor->blockCount; x++)
+            {
+                writeBlock(JournalDescriptor->homeBlock[x], JOURNAL_TRANSACTION_LOC + ((x + 1) * BLOCK_SIZE), cacheActive);
+            }
+            diskFlushCache(0, cacheActive);
+        }
+
+        journalSequence = JournalDescriptor->sequence + 1;
+        JournalDescriptor->blockCount = 0;
+        writeBlock(journalLocation[0], JOURNAL_TRANSACTION_LOC, cacheActive);
+        diskFlushBlock(journalLocation[0], cacheActive);
+    }
+
+    fillMemory(JOURNAL_TRANSACTION_LOC, 0x0, JOURNAL_BLOCKS * BLOCK_SIZE);
+    journalHandles = 0;
+    journalActive = true;
+}
+
+void journalStart(bool cacheActive)
+{
+    if (!journalActive) { return; }
+
+    struct journalDescriptor *JournalDescriptor = (struct journalDescriptor *)JOURNAL_TRANSACTION_LOC;
+
+    while (!acquireLock(KERNEL_OWNED, JOURNAL_TRANSACTION_LOC)) {}
+
+    // Reserve room up front, the way jbd2 hands out credits. An outermost handle that might not fit
+    // commits the transaction first, while no handle is open, so a handle never has to be split later.
+    // Nested handles live inside the outer one's reservation.
+    if (journalHandles == 0 && (JOURNAL_MAX_TRANSACTION_BLOCKS - JournalDescriptor->blockCount) < JOURNAL_HANDLE_CREDITS)
+    {
+        journalWriteTransaction(cacheActive);
+    }
+
+    journalHandles++;
+    while (!releaseLock(KERNEL_OWNED, JOURNAL_TRANSACTION_LOC)) {}
+}
+
+void journalStop(bool cacheActive)
+{
+    if (!journalActive) { return; }
+
+    struct journalDescriptor *JournalDescriptor = (struct journalDescriptor *)JOURNAL_TRANSACTION_LOC;
+
+    while (!acquireLock(KERNEL_OWNED, JOURNAL_TRANSACTION_LOC)) {}
+
+    if (journalHandles > 0)
+    {
+        journalHandles--;
+    }
+
+    // Small transactions are left open so the next syscall, possibly from another process,
+    // rides along on the same commit. The timer closes them out.
+    if (journalHandles == 0 && JournalDescriptor->blockCount >= JOURNAL_GROUP_COMMIT_THRESHOLD)
+    {
+        journalWriteTransaction(cacheActive);
+    }
+
+    while (!releaseLock(KERNEL_OWNED, JOURNAL_TRANSACTION_LOC)) {}
+}
+
+void journalWriteBlock(uint32_t blockNumber, uint8_t *sourceMemory, bool cacheActive)
+{
+    if (!journalActive)
+    {
+        writeBlock(blockNumber, sourceMemory, cacheActive);
+        return;
+    }
+
+    struct journalDescriptor *JournalDescriptor = (struct journalDescriptor *)JOURNAL_TRANSACTION_LOC;
+
+    while (!acquireLock(KERNEL_OWNED, JOURNAL_TRANSACTION_LOC)) {}
+
+    uint32_t slot = 0;
+    while (slot < JournalDescriptor->blockCount && JournalDescriptor->homeBlock[slot] != blockNumber)
+    {
+        slot++;
+    }
+
+    if (slot < JournalDescriptor->blockCount)
+    {
+        *(uint32_t *)KERNEL_JOURNAL_BLOCKS_ABSORBED = *(uint32_t *)KERNEL_JOURNAL_BLOCKS_ABSORBED + 1;
+    }
+    else
+    {
+        if (JournalDescriptor->blockCount == JOURNAL_MAX_TRANSACTION_BLOCKS)
+        {
+            if (journalHandles != 0)
+            {
+                // A handle logged more than JOURNAL_HANDLE_CREDITS blocks. Committing now would make half of its
+                // update durable without the rest, and writing the block home would do the same, so there is no safe way on.
+                panic((uint8_t *)"journal.cpp:journalWriteBlock() -> handle logged more than JOURNAL_HANDLE_CREDITS blocks");
+            }
+
+            // Writes made outside any handle have nothing to keep them together
+            journalWriteTransaction(cacheActive);
+        }
+
+        if (JournalDescriptor->blockCount == 0)
+        {
+            journalOpenedAt = journalLastTick;
+        }
+
+        slot = JournalDescriptor->blockCount;
+        JournalDescriptor->homeBlock[slot] = blockNumber;
+        JournalDescriptor->blockCount++;
+    }
+
+    memoryCopy(sourceMemory, JOURNAL_TRANSACTION_LOC + ((slot + 1) * BLOCK_SIZE), ceiling(BLOCK_SIZE, 2));
+
+    while (!releaseLock(KERNEL_OWNED, JOURNAL_TRANSACTION_LOC)) {}
+}
+
+bool journalReadBlock(uint32_t blockNumber, uint8_t *destinationMemory)
+{
+    if (!journalActive) { return false; }
+
+    struct journalDescriptor *JournalDescriptor = (struct journalDescriptor *)JOURNAL_TRANSACTION_LOC;
+    bool found = false;
+
+    while (!acquireLock(KERNEL_OWNED, JOURNAL_TRANSACTION_LOC)) {}
+
+    for (uint32_t slot = 0; slot < JournalDescriptor->blockCount; slot++)
+    {
+        if (JournalDescriptor->homeBlock[slot] == blockNumber)
+        {
+            memoryCopy(JOURNAL_TRANSACTION_LOC + ((slot + 1) * BLOCK_SIZE), destinationMemory, ceiling(BLOCK_SIZE, 2));
+            found = true;
+            break;
+        }
+    }
+
+    while (!releaseLock(KERNEL_OWNED, JOURNAL_TRANSACTION_LOC)) {}
+
+    return found;
+}
+
+void journalRevokeBlock(uint32_t blockNumber)
+{
+    if (!journalActive) { return; }
+
+    struct journalDescriptor *JournalDescriptor = (struct journalDescriptor *)JOURNAL_TRANSACTION_LOC;
+
+    while (!acquireLock(KERNEL_OWNED, JOURNAL_TRANSACTION_LOC)) {}
+
+    for (uint32_t slot = 0; slot < JournalDescriptor->blockCount; slot++)
+    {
+        if (JournalDescriptor->homeBlock[slot] == blockNumber)
+        {
+            // Move the last logged block into the hole to keep the slots packed
+            uint32_t lastSlot = JournalDescriptor->blockCount - 1;
+            if (slot != lastSlot)
+            {
+                JournalDescriptor->homeBlock[slot] = JournalDescriptor->homeBlock[lastSlot];
+                memoryCopy(JOURNAL_TRANSACTION_LOC + ((lastSlot + 1) * BLOCK_SIZE), JOURNAL_TRANSACTION_LOC + ((slot + 1) * BLOCK_SIZE), ceiling(BLOCK_SIZE, 2));
+            }
+            JournalDescriptor->homeBlock[lastSlot] = 0;
+            JournalDescriptor->blockCount--;
+            break;
+        }
+    }
+
+    while (!releaseLock(KERNEL_OWNED, JOURNAL_TRANSACTION_LOC)) {}
+}
+
+void journalCommit(bool cacheActive)
+{
+    if (!journalActive) { return; }
+
+    while (!acquireLock(KERNEL_OWNED, JOURNAL_TRANSACTION_LOC)) {}
+    journalWriteTransaction(cacheActive);
+    while (!releaseLock(KERNEL_OWNED, JOURNAL_TRANSACTION_LOC)) {}
+}
+
+void journalWriteTransaction(bool cacheActive)
+{
+    struct journalDescriptor *JournalDescriptor = (struct journalDescriptor *)JOURNAL_TRANSACTION_LOC;
+    uint32_t blockCount = JournalDescriptor->blockCount;
+
+    if (blockCount == 0) { return; }
+
+    uint32_t commitSlot = blockCount + 1;
+    struct journalCommitBlock *JournalCommitBlock = (struct journalCommitBlock *)(JOURNAL_TRANSACTION_LOC + (commitSlot * BLOCK_SIZE));
+
+    JournalDescriptor->magic = JOURNAL_DESCRIPTOR_MAGIC;
+    JournalDescriptor->sequence = journalSequence;
+
+    fillMemory((uint8_t *)JournalCommitBlock, 0x0, BLOCK_SIZE);
+    JournalCommitBlock->magic = JOURNAL_COMMIT_MAGIC;
+    JournalCommitBlock->sequence = journalSequence;
+    JournalCommitBlock->checksum = journalChecksum(blockCount);
+
+    // The disk cache is write-back, so each step below ends with a flush to keep the on-disk order.
+    // File data written before this commit goes first so no committed inode points at stale blocks.
+    diskFlushCache(0, cacheActive);
+
+    // Descriptor, logged blocks and commit block go out front to back in one sweep of the journal
+    for (uint32_t slot = 0; slot <= commitSlot; slot++)
+    {
+        writeBlock(journalLocation[slot], JOURNAL_TRANSACTION_LOC + (slot * BLOCK_SIZE), cacheActive);
+    }
+    diskFlushCache(0, cacheActive);
+
+    // Checkpoint. The flush sorts the home blocks by LBA.
+    for (uint32_t slot = 0; slot < blockCount; slot++)
+    {
+        writeBlock(JournalDescriptor->homeBlock[slot], JOURNAL_TRANSACTION_LOC + ((slot + 1) * BLOCK_SIZE), cacheActive);
+    }
+    diskFlushCache(0, cacheActive);
+
+    // Mark the journal clean so the checkpointed blocks are never replayed
+    JournalDescriptor->blockCount = 0;
+    writeBlock(journalLocation[0], JOURNAL_TRANSACTION_LOC, cacheActive);
+    diskFlushBlock(journalLocation[0], cacheActive);
+
+    *(uint32_t *)KERNEL_JOURNAL_COMMITS = *(uint32_t *)KERNEL_JOURNAL_COMMITS + 1;
+    journalSequence++;
+    fillMemory(JOURNAL_TRANSACTION_LOC, 0x0, (commitSlot + 1) * BLOCK_SIZE);
+}
+
+uint32_t journalChecksum(uint32_t blockCount)
+{
+    struct journalDescriptor *JournalDescriptor = (struct journalDescriptor *)JOURNAL_TRANSACTION_LOC;
+    uint32_t checksum = JournalDescriptor->sequence;
+
+    for (uint32_t slot = 0; slot < blockCount; slot++)
+    {
+        uint32_t *loggedBlock = (uint32_t *)(JOURNAL_TRANSACTION_LOC + ((slot + 1) * BLOCK_SIZE));
+
+        checksum = ((checksum << 1) | (checksum >> 31)) ^ JournalDescriptor->homeBlock[slot];
+        for (uint32_t word = 0; word < (BLOCK_SIZE / sizeof(uint32_t)); word++)
+        {
+            checksum = ((checksum << 1) | (checksum >> 31)) ^ loggedBlock[word];
+        }
+    }
+
+    return checksum;
+}
+
+void journalTimerTick(uint32_t timerTicks, bool cacheActive)
+{
+    journalLastTick = timerTicks;
+
+    if (!journalActive) { return; }
+
+    struct journalDescriptor *JournalDescriptor = (struct journalDescriptor *)JOURNAL_TRANSACTION_LOC;
+
+    if (journalHandles != 0 || JournalDescriptor->blockCount == 0 || (timerTicks - journalOpenedAt) < JOURNAL_COMMIT_INTERVAL)
+    {
+        return;
+    }
+
+    // Never spin in the timer. If a syscall we interrupted holds the journal, try again next tick.
+    if (!acquireLock(KERNEL_OWNED, JOURNAL_TRANSACTION_LOC)) { return; }
+
+    // The commit takes the disk cache lock for every block it writes. If the code this tick interrupted
+    // is inside readBlock() or writeBlock(), that lock never comes free on this CPU, so skip the tick too.
+    if (!acquireLock(KERNEL_OWNED, DISK_READ_CACHE_LOC))
+    {
+        while (!releaseLock(KERNEL_OWNED, JOURNAL_TRANSACTION_LOC)) {}
+        return;
+    }
+    while (!releaseLock(KERNEL_OWNED, DISK_READ_CACHE_LOC)) {}
+
+    if (journalHandles == 0)
+    {
+        journalWriteTransaction(cacheActive);
+    }
+
+    while (!releaseLock(KERNEL_OWNED, JOURNAL_TRANSACTION_LOC)) {}
+}
+
+uint32_t journalFileInode()
+{
+    return journalInode;
+}
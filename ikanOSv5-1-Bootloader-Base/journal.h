@@ -0,0 +1,107 @@
+// Copyright (c) 2023-2026 Dan O’Malley
+// This file is licensed under the MIT License. See LICENSE for details.
+
+
+#include "constants.h"
+
+/**
+ * The first block of the on-disk journal. Lists the home location of every metadata block
+ * logged in the transaction. The logged blocks follow it in the journal, then the commit block.
+ */
+struct journalDescriptor
+{
+    uint32_t magic;
+    uint32_t sequence;
+    /** Number of logged blocks. Zero means the journal is clean and there is nothing to replay. */
+    uint32_t blockCount;
+    uint32_t homeBlock[JOURNAL_MAX_TRANSACTION_BLOCKS];
+};
+
+/**
+ * The block written after the logged blocks. A transaction only counts as committed
+ * if this block carries the same sequence as the descriptor and a matching checksum.
+ */
+struct journalCommitBlock
+{
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t checksum;
+};
+
+/**
+ * Finds JOURNAL_FILE_NAME in the root directory and replays a committed transaction left behind by a crash.
+ * Without that file the journal stays off. Must run before the block and inode bitmaps are cached.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void journalInit(bool cacheActive);
+
+/**
+ * Opens a handle on the running transaction. Every metadata write until the matching
+ * journalStop() lands in the same transaction. Handles nest. An outermost handle reserves
+ * JOURNAL_HANDLE_CREDITS blocks, committing the running transaction first if they don't fit.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void journalStart(bool cacheActive);
+
+/**
+ * Closes a handle opened with journalStart(). The transaction is only committed here once it is
+ * large enough, otherwise it stays open so other processes can join it and journalTimerTick() commits it.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void journalStop(bool cacheActive);
+
+/**
+ * Writes an EXT2 metadata block (bitmap, inode table, directory or indirect block) through the journal.
+ * Writing the same block twice in one transaction only keeps the latest copy. Falls back to writeBlock()
+ * when the journal is not running (boot loader and user programs). Never commits while a handle is open,
+ * and panics if a handle outgrows the transaction rather than writing part of it home.
+ * \param blockNumber The EXT2 block number.
+ * \param sourceMemory The block contents.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void journalWriteBlock(uint32_t blockNumber, uint8_t *sourceMemory, bool cacheActive);
+
+/**
+ * Copies a block out of the running transaction if it has been logged but not yet checkpointed. Returns true if found.
+ * \param blockNumber The EXT2 block number.
+ * \param destinationMemory Where to copy the block.
+ */
+bool journalReadBlock(uint32_t blockNumber, uint8_t *destinationMemory);
+
+/**
+ * Drops a freed block from the running transaction so a stale copy is never checkpointed over its next owner.
+ * \param blockNumber The EXT2 block number being freed.
+ */
+void journalRevokeBlock(uint32_t blockNumber);
+
+/**
+ * Writes the running transaction to the journal with one sequential write, then checkpoints the
+ * blocks to their home locations and marks the journal clean.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void journalCommit(bool cacheActive);
+
+/**
+ * Called from the system timer. Commits an idle transaction once it has been open for JOURNAL_COMMIT_INTERVAL ticks.
+ * Never waits: if the journal or the disk cache is locked, the commit is left for a later tick.
+ * \param timerTicks The current system timer interrupt count.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void journalTimerTick(uint32_t timerTicks, bool cacheActive);
+
+/**
+ * Does the work of journalCommit(). The caller must already hold the journal lock.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void journalWriteTransaction(bool cacheActive);
+
+/**
+ * Checksums the home block numbers and contents of the logged blocks at JOURNAL_TRANSACTION_LOC. Returns the checksum.
+ * \param blockCount The number of logged blocks.
+ */
+uint32_t journalChecksum(uint32_t blockCount);
+
+/**
+ * Returns the inode number of the journal file, or 0 when the journal is off. Its blocks must never be moved or freed.
+ */
+uint32_t journalFileInode();
@@ -16,6 +16,10 @@
 #include "exceptions.h"
 #include "file.h"
 #include "net.h"
+#include "journal.h"
+#include "tmpfs.h"
+#include "initramfs.h"
+#include "mmap.h"
 
 uint32_t currentPid = 0;
 uint32_t cursorRow = 0;
@@ -31,6 +35,11 @@ void kInit()
     createSemaphore(KERNEL_OWNED, (uint8_t *)GLOBAL_OBJECT_TABLE, 1, 1);
     createSemaphore(KERNEL_OWNED, (uint8_t *)PROCESS_TABLE_LOC, 1, 1);
     createSemaphore(KERNEL_OWNED, (uint8_t *)PAGEFRAME_MAP_BASE, 1, 1);
+    createSemaphore(KERNEL_OWNED, DISK_READ_CACHE_LOC, 1, 1);
+    createSemaphore(KERNEL_OWNED, JOURNAL_TRANSACTION_LOC, 1, 1);
+    createSemaphore(KERNEL_OWNED, FILE_MAPPING_TABLE, 1, 1);
+    createSemaphore(KERNEL_OWNED, TMPFS_TABLE, 1, 1);
+    createSemaphore(KERNEL_OWNED, KERNEL_WORKING_DIR, 1, 1); // fsMetadataLock()
 
     clearScreen();
 
@@ -40,13 +49,48 @@ void kInit()
     fillMemory((uint8_t *)(PROCESS_TABLE_LOC) , (uint8_t)0x0, PAGE_SIZE);
     fillMemory((uint8_t *)(KERNEL_HEAP) , (uint8_t)0x0, KERNEL_HEAP_SIZE);
     fillMemory((uint8_t *)(USER_HEAP) , (uint8_t)0x0, HEAP_SIZE);
+    fillMemory(DISK_READ_CACHE_LOC, (uint8_t)0x0, PAGE_SIZE);
+    fillMemory(FILE_MAPPING_TABLE, (uint8_t)0x0, PAGE_SIZE);
+    fillMemory(PAGE_CACHE_TABLE, (uint8_t)0x0, PAGE_SIZE);
+    fillMemory(TMPFS_TABLE, (uint8_t)0x0, MAX_TMPFS_FILES * sizeof(tmpfsFile));
+    fillMemory(TMPFS_PAGE_MAP, (uint8_t)0x0, TMPFS_MAX_PAGES);
+    fillMemory((uint8_t *)INODE_LOCK_TABLE, (uint8_t)0x0, FS_LOCK_BUCKETS * sizeof(uint32_t));
+    fillMemory((uint8_t *)DIRECTORY_LOCK_TABLE, (uint8_t)0x0, FS_LOCK_BUCKETS * sizeof(uint32_t));
+    fillMemory((uint8_t *)FILE_IO_SCRATCH_IN_USE, (uint8_t)0x0, FILE_IO_SCRATCH_SLOTS * sizeof(uint32_t));
+    fillMemory((uint8_t *)SHARED_LIBRARY_FRAMES, (uint8_t)0x0, SHARED_LIBRARY_PAGES * sizeof(uint32_t));
+    fillMemory(EXEC_IMAGE_CACHE, (uint8_t)0x0, MAX_EXEC_IMAGES * sizeof(execImage));
+    storeValueAtMemLoc((uint8_t *)EXEC_IMAGE_CACHE_CURSOR, 0);
+
+    struct kernelConfiguration *KernelConfiguration = (struct kernelConfiguration*)KERNEL_CONFIGURATION;
+    KernelConfiguration->writebackAge = DISK_WRITEBACK_AGE;
+
+    // Replay the metadata journal before the bitmaps are cached below
+    journalInit(true);
+
+    // Writes, deletes and reused inode numbers make the mmap page cache and the exec image cache drop what they read before
+    fsSetInodeChangedHandler(kInodeChanged);
 
     struct blockGroupDescriptor *BlockGroupDescriptor = (blockGroupDescriptor*)(BLOCK_GROUP_DESCRIPTOR_TABLE);
     readBlock(BlockGroupDescriptor->bgd_block_address_of_block_usage, (uint8_t *)EXT2_BLOCK_USAGE_MAP, true);
     readBlock(BlockGroupDescriptor->bgd_block_address_of_inode_usage, (uint8_t *)EXT2_INODE_USAGE_MAP, true);
 
+    // Warm the sector cache with what the last boot read, and record what this one reads
+    bootTraceReplay(true);
+
+    // Preen the file system: put back what an interrupted write or deleteFile() left behind. The check
+    // alone never writes, so a clean image is left exactly as it was.
+    struct fsCheckReport FsCheckReport;
+    if (fsCheck(&FsCheckReport, false, true) != 0)
+    {
+        fsCheck(&FsCheckReport, true, true);
+    }
+
+    // The boot time binaries, so init and sh don't come from EXT2. Everything still works from EXT2 without it.
+    bool initramfsAvailable = initramfsMount();
+
     currentPid = initializeTask(currentPid, PROC_SLEEPING, STACK_START_LOC, (uint8_t *)"init", 100, ROOTDIR_INODE, 0, 0, 0);
     createPageFrameMap((uint8_t *)PAGEFRAME_MAP_BASE, PAGEFRAME_MAP_SIZE);
+    pageFrameIndexBuild((uint8_t *)PAGEFRAME_MAP_BASE, PAGEFRAME_MAP_SIZE);
 
     printString(COLOR_GREEN, cursorRow++, 0, (uint8_t *)"   -> Initialized Task Struct -> PID: ");
     printHexNumber(COLOR_GREEN, (cursorRow - 1), 38, currentPid);
@@ -55,6 +99,10 @@ void kInit()
     printString(COLOR_GREEN, cursorRow++, 0, (uint8_t *)"   -> Initialized Page Directory and Page Table -> PID: ");
     printHexNumber(COLOR_GREEN, (cursorRow - 1), 56, currentPid);
 
+    printString(COLOR_GREEN, cursorRow++, 0, (uint8_t *)"   -> Kernel 4 MB Pages: ");
+    printHexNumber(COLOR_GREEN, (cursorRow - 1), 25, mapKernelLargePages(currentPid));
+    mapZeroPoolWindow(currentPid);
+
     contextSwitch(currentPid);
 
     printString(COLOR_GREEN, cursorRow++, 0, (uint8_t *)"   -> Paging Enabled");
@@ -69,12 +117,20 @@ void kInit()
     loadIDTR((uint8_t *)INTERRUPT_DESC_TABLE, (uint8_t *)INTERRUPT_DESC_TABLE_REG);
     printString(COLOR_GREEN, cursorRow++, 0, (uint8_t *)"   -> Interrupt Descriptor Table (IDT) Setup Complete");
 
+    if (initramfsAvailable)
+    {
+        printString(COLOR_GREEN, cursorRow++, 0, (uint8_t *)"   -> Initramfs Mounted");
+    }
+
+    printString(COLOR_GREEN, cursorRow++, 0, (uint8_t *)"   -> File System Checked -> Repairs: ");
+    printHexNumber(COLOR_GREEN, (cursorRow - 1), 38, FsCheckReport.problemsRepaired);
+
     printString(COLOR_GREEN, cursorRow++, 0, (uint8_t *)"   -> Kernel Initialization Complete");
     cursorRow++;
 
     createOpenFileTable((uint8_t *)GLOBAL_OBJECT_TABLE);
 
-    storeValueAtMemLoc(RUNNING_PID_LOC, currentPid);
+    storeValueAtProtectedMemLoc(RUNNING_PID_LOC, currentPid);
 
     enableInterrupts();
 
@@ -94,6 +150,12 @@ void kInit()
 
 }
 
+void kInodeChanged(uint32_t inode)
+{
+    pageCacheInvalidate(inode);
+    execImageInvalidate(inode);
+}
+
 void logonPrompt()
 {
     clearScreen();
@@ -121,13 +183,6 @@ void logonPrompt()
 
 void loadInit()
 {
-    if (!requestSpecificPage(currentPid, (uint8_t *)(STACK_PAGE - PAGE_SIZE), PG_USER_PRESENT_RW))
-    {
-        clearScreen();
-        printString(COLOR_RED, 2, 2, (uint8_t *)"Requested page is not available");
-        panic((uint8_t *)"kernel.cpp -> STACK_PAGE - PAGE_SIZE page request");
-    }
-
     if (!requestSpecificPage(currentPid, (uint8_t *)(STACK_PAGE), PG_USER_PRESENT_RW))
     {
         clearScreen();
@@ -135,15 +190,9 @@ void loadInit()
         panic((uint8_t *)"kernel.cpp -> STACK_PAGE page request");
     }
 
-    for (uint32_t userHeapLoc = 0; userHeapLoc < (USER_HEAP_PAGES * PAGE_SIZE); userHeapLoc = userHeapLoc + PAGE_SIZE)
-    {
-        if (!requestSpecificPage(currentPid, (uint8_t*)(USER_HEAP + userHeapLoc), PG_USER_PRESENT_RW))
-        {
-            clearScreen();
-            printString(COLOR_RED, 2, 2, (uint8_t *)"Requested page is not available");
-            panic((uint8_t *)"kernel.cpp -> USER_HEAP page request");
-        }
-    }
+    // The stack's second page and the heap get frames only when the program touches them
+    reserveDemandPages(currentPid, (uint8_t *)(STACK_PAGE - PAGE_SIZE), 1);
+    reserveDemandPages(currentPid, (uint8_t *)USER_HEAP, USER_HEAP_PAGES);
 
     cursorRow++;
     printString(COLOR_GREEN, cursorRow++, 0, (uint8_t *)"   -> Loading binary to Temp File Storage");
@@ -155,7 +204,9 @@ void loadInit()
         panic((uint8_t *)"kernel.cpp -> USER_TEMP_INODE_LOC page request");
     }
 
-    if (!fsFindFile((uint8_t *)"init", USER_TEMP_INODE_LOC, true, ROOTDIR_INODE))
+    bool initInInitramfs = initramfsFindFile((uint8_t *)"init", USER_TEMP_INODE_LOC);
+
+    if (!initInInitramfs && !fsFindFile((uint8_t *)"init", USER_TEMP_INODE_LOC, true, ROOTDIR_INODE))
     {
         panic((uint8_t *)"kernel.cpp -> Cannot find init in root directory");
     }
@@ -174,7 +225,17 @@ void loadInit()
         }
     }
 
-    loadFileFromInodeStruct(USER_TEMP_INODE_LOC, USER_TEMP_FILE_LOC, true);
+    if (initInInitramfs)
+    {
+        if (!initramfsLoadFile((uint8_t *)"init", USER_TEMP_FILE_LOC))
+        {
+            panic((uint8_t *)"kernel.cpp -> init in the initramfs is damaged");
+        }
+    }
+    else
+    {
+        loadFileFromInodeStruct(USER_TEMP_INODE_LOC, USER_TEMP_FILE_LOC, true);
+    }
     printString(COLOR_GREEN, cursorRow++, 0, (uint8_t *)"   -> Raw binary loaded to 0x31000");
 
     struct elfHeader *ELFHeader = (struct elfHeader*)USER_TEMP_FILE_LOC;
@@ -185,16 +246,9 @@ void loadInit()
 
         if (ProgramHeader->p_type == PT_LOAD)
         {
-            for (uint32_t tempFileLoc = 0; tempFileLoc < ((ceiling(ProgramHeader->p_memsz, PAGE_SIZE)) * PAGE_SIZE); tempFileLoc = tempFileLoc + PAGE_SIZE)
-            {
-                if (!requestSpecificPage(currentPid, (uint8_t *)(ProgramHeader->p_vaddr + tempFileLoc), PG_USER_PRESENT_RW))
-                {
-                    clearScreen();
-                    printString(COLOR_RED, 2, 2, (uint8_t *)"Requested page is not available");
-                    panic((uint8_t *)"kernel.cpp -> USERPROG TEXT and DATA VADDR page requests");
-                }
-
-            }
+            // loadElfFile() faults in the pages it copies to, and the untouched .bss stays unbacked
+            uint32_t segmentOffset = ProgramHeader->p_vaddr % PAGE_SIZE;
+            reserveDemandPages(currentPid, (uint8_t *)ProgramHeader->p_vaddr, ceiling(ProgramHeader->p_memsz + segmentOffset, PAGE_SIZE));
 
         }
     }
@@ -207,7 +261,7 @@ void launchInit()
 {
     struct elfHeader *ELFHeaderLaunch = (struct elfHeader*)USER_TEMP_FILE_LOC;
 
-    storeValueAtMemLoc(RUNNING_PID_LOC, currentPid);
+    storeValueAtProtectedMemLoc(RUNNING_PID_LOC, currentPid);
 
     printString(COLOR_GREEN, cursorRow++, 0, (uint8_t *)"   -> Switching to Ring 3 and launching binary");
 
@@ -226,6 +280,9 @@ void secondProcInitialFunc()
     uint32_t currentTickCount;
 
     while ((targetPid = readValueFromMemLoc((uint8_t *)AP_PID_WAIT_FLAG_LOC)) == 0xFF) {
+        // Nothing to run yet, so clear frames for the zero pool while waiting
+        zeroPoolRefill();
+
         currentTickCount = *(uint32_t*)SECOND_PROC_TICK_COUNT_LOC;
         for (uint32_t x = 0; x < 4000000; x++) {}  // Your delay
         currentTickCount++;
@@ -239,7 +296,7 @@ void secondProcInitialFunc()
 
     asm volatile ("movl %0, %%cr3" : : "r" (targetPgd));
 
-    storeValueAtMemLoc(RUNNING_PID_LOC, targetPid);
+    storeValueAtProtectedMemLoc(RUNNING_PID_LOC, targetPid);
     updateTaskState(targetPid, PROC_RUNNING);
     storeValueAtMemLoc((uint8_t*)AP_PID_WAIT_FLAG_LOC, 0xFF);
 
@@ -10,6 +10,8 @@
 struct kernelConfiguration
 {
     uint32_t runScheduler;
+    /** How many timer ticks a sector may sit dirty in the disk cache before the flusher writes it back. */
+    uint32_t writebackAge;
 };
 
 
@@ -24,6 +26,12 @@ struct kernelLog
 
 void kInit();
 
+/** Registered with fsSetInodeChangedHandler(). Drops what the mmap page cache and the exec image cache kept of a file that was written,
+ * deleted or had its inode number reused.
+ * \param inode The inode that changed.
+ */
+void kInodeChanged(uint32_t inode);
+
 /** Prompts the user to enter the root password. This is normally commented out to save time for the student. The root password is "passw0rd". It compares the password entered to a simple hashed value in the mpass file. See stringHash(). */
 void logonPrompt();
 void loadShell();
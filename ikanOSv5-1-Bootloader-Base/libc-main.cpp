@@ -14,6 +14,7 @@
 #include "screen.h"
 #include "net.h"
 #include "keyboard.h"
+#include "mmap.h"
 
 /**
  * Delays execution for a specified number of seconds by making system calls to wait.
@@ -1137,6 +1138,270 @@ void systemCloseFile(uint32_t fileDescriptor)
     currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
 }
 
+/**
+ * Flushes all pending writes to disk.
+ */
+void systemSync()
+{
+    uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    sysCall(SYS_SYNC, 0, currentPid);
+    currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+}
+
+/**
+ * Flushes one file to disk.
+ * @param fileDescriptor The FD.
+ * @return SYSCALL_SUCCESS or SYSCALL_FAIL.
+ */
+uint32_t systemFsync(uint32_t fileDescriptor)
+{
+    uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    uint32_t returnValue = sysCall(SYS_FSYNC, fileDescriptor, currentPid);
+    currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+
+    return returnValue;
+}
+
+/**
+ * Opens a file for streaming.
+ * @param fileName The file.
+ * @param requestedPermissions Permissions.
+ * @return SYSCALL_SUCCESS or SYSCALL_FAIL.
+ */
+uint32_t systemOpenFileStream(uint8_t *fileName, uint32_t requestedPermissions)
+{
+    uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    uint32_t returnValue = SYSCALL_FAIL; // Default fail.
+
+    struct fileParameter *fileParams = (struct fileParameter *)(malloc(currentPid, sizeof(fileParameter)));
+
+    fileParams->fileNameLength = strlen(fileName);
+    fileParams->requestedPermissions = requestedPermissions;
+    fileParams->fileName = fileName;
+
+    returnValue = sysCall(SYS_OPEN_STREAM, (uint32_t)fileParams, currentPid);
+    currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    free((uint8_t *)fileParams);
+
+    return returnValue;
+}
+
+/**
+ * Reads from a file at its read offset.
+ * @param fileDescriptor The FD.
+ * @param buffer Destination.
+ * @param length Max bytes.
+ * @return Bytes read or SYSCALL_FAIL.
+ */
+uint32_t systemReadFile(uint32_t fileDescriptor, uint8_t *buffer, uint32_t length)
+{
+    uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    uint32_t returnValue = SYSCALL_FAIL; // Default fail.
+
+    struct ioParameter *ioParams = (struct ioParameter *)(malloc(currentPid, sizeof(ioParameter)));
+
+    ioParams->fileDescriptor = fileDescriptor;
+    ioParams->buffer = buffer;
+    ioParams->length = length;
+
+    returnValue = sysCall(SYS_READ_FILE, (uint32_t)ioParams, currentPid);
+    currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    free((uint8_t *)ioParams);
+
+    return returnValue;
+}
+
+/**
+ * Writes to a file at its write offset.
+ * @param fileDescriptor The FD.
+ * @param buffer Source.
+ * @param length Bytes to write.
+ * @return Bytes written or SYSCALL_FAIL.
+ */
+uint32_t systemWriteFile(uint32_t fileDescriptor, uint8_t *buffer, uint32_t length)
+{
+    uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    uint32_t returnValue = SYSCALL_FAIL; // Default fail.
+
+    struct ioParameter *ioParams = (struct ioParameter *)(malloc(currentPid, sizeof(ioParameter)));
+
+    ioParams->fileDescriptor = fileDescriptor;
+    ioParams->buffer = buffer;
+    ioParams->length = length;
+
+    returnValue = sysCall(SYS_WRITE_FILE, (uint32_t)ioParams, currentPid);
+    currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    free((uint8_t *)ioParams);
+
+    return returnValue;
+}
+
+/**
+ * Moves the offsets of an open file.
+ * @param fileDescriptor The FD.
+ * @param offset Distance.
+ * @param whence SEEK_SET, SEEK_CUR or SEEK_END.
+ * @return New offset or SYSCALL_FAIL.
+ */
+uint32_t systemSeekFile(uint32_t fileDescriptor, int offset, uint32_t whence)
+{
+    uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    uint32_t returnValue = SYSCALL_FAIL; // Default fail.
+
+    struct ioParameter *ioParams = (struct ioParameter *)(malloc(currentPid, sizeof(ioParameter)));
+
+    ioParams->fileDescriptor = fileDescriptor;
+    ioParams->offset = offset;
+    ioParams->whence = whence;
+
+    returnValue = sysCall(SYS_LSEEK, (uint32_t)ioParams, currentPid);
+    currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    free((uint8_t *)ioParams);
+
+    return returnValue;
+}
+
+/**
+ * Maps part of an open file into memory.
+ * @param fileDescriptor The FD.
+ * @param fileOffset Page aligned offset.
+ * @param length Bytes to map.
+ * @param requestedPermissions PG_USER_PRESENT_RO or PG_USER_PRESENT_RW.
+ * @return Mapped address or 0.
+ */
+uint8_t *systemMMapFile(uint32_t fileDescriptor, uint32_t fileOffset, uint32_t length, uint32_t requestedPermissions)
+{
+    uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    uint32_t returnValue = SYSCALL_FAIL; // Default fail.
+
+    struct mmapParameter *mmapParams = (struct mmapParameter *)(malloc(currentPid, sizeof(mmapParameter)));
+
+    mmapParams->fileDescriptor = fileDescriptor;
+    mmapParams->fileOffset = fileOffset;
+    mmapParams->length = length;
+    mmapParams->requestedPermissions = requestedPermissions;
+    mmapParams->requestedAddress = 0;
+
+    returnValue = sysCall(SYS_MMAP_FILE, (uint32_t)mmapParams, currentPid);
+    currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    free((uint8_t *)mmapParams);
+
+    if (returnValue == SYSCALL_FAIL)
+    {
+        return 0;
+    }
+
+    return (uint8_t *)returnValue;
+}
+
+/**
+ * Removes a file mapping.
+ * @param mappedAddress Address from systemMMapFile.
+ * @return SYSCALL_SUCCESS or SYSCALL_FAIL.
+ */
+uint32_t systemMUnmap(uint8_t *mappedAddress)
+{
+    uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    uint32_t returnValue = sysCall(SYS_MUNMAP, (uint32_t)mappedAddress, currentPid);
+    currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+
+    return returnValue;
+}
+
+/**
+ * Sends part of a file to a network pipe.
+ * @param fileDescriptor The file FD.
+ * @param socketDescriptor The network pipe FD.
+ * @param offset Where to start in the file.
+ * @param length Bytes to send.
+ * @return Bytes sent or SYSCALL_FAIL.
+ */
+uint32_t systemSendFile(uint32_t fileDescriptor, uint32_t socketDescriptor, uint32_t offset, uint32_t length)
+{
+    uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    uint32_t returnValue = SYSCALL_FAIL; // Default fail.
+
+    struct sendfileParameter *sendfileParams = (struct sendfileParameter *)(malloc(currentPid, sizeof(sendfileParameter)));
+
+    sendfileParams->fileDescriptor = fileDescriptor;
+    sendfileParams->socketDescriptor = socketDescriptor;
+    sendfileParams->offset = offset;
+    sendfileParams->length = length;
+
+    returnValue = sysCall(SYS_SENDFILE, (uint32_t)sendfileParams, currentPid);
+    currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    free((uint8_t *)sendfileParams);
+
+    return returnValue;
+}
+
+uint32_t systemFsCheck(struct fsCheckReport *report, bool repair)
+{
+    uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    uint32_t returnValue = SYSCALL_FAIL; // Default fail.
+
+    struct fsCheckParameter *fsCheckParams = (struct fsCheckParameter *)(malloc(currentPid, sizeof(fsCheckParameter)));
+
+    fsCheckParams->repair = repair;
+    fsCheckParams->report = report;
+
+    returnValue = sysCall(SYS_FS_CHECK, (uint32_t)fsCheckParams, currentPid);
+    currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    free((uint8_t *)fsCheckParams);
+
+    return returnValue;
+}
+
+uint32_t systemFsDefrag(uint8_t *fileName, uint32_t *inodeNumber, struct fsDefragReport *report)
+{
+    uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    uint32_t returnValue = SYSCALL_FAIL; // Default fail.
+
+    struct fsDefragParameter *fsDefragParams = (struct fsDefragParameter *)(malloc(currentPid, sizeof(fsDefragParameter)));
+
+    fsDefragParams->fileName = fileName;
+    fsDefragParams->inodeNumber = *inodeNumber;
+    fsDefragParams->report = report;
+
+    returnValue = sysCall(SYS_FS_DEFRAG, (uint32_t)fsDefragParams, currentPid);
+    currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    *inodeNumber = fsDefragParams->inodeNumber;
+    free((uint8_t *)fsDefragParams);
+
+    return returnValue;
+}
+
+uint32_t systemGetDirectoryEntries(uint8_t *directoryName, uint32_t *position, struct directoryListingEntry *entries, uint32_t maxEntries)
+{
+    uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    uint32_t returnValue = SYSCALL_FAIL; // Default fail.
+
+    struct directoryListingParameter *directoryListingParams = (struct directoryListingParameter *)(malloc(currentPid, sizeof(directoryListingParameter)));
+
+    directoryListingParams->directoryName = directoryName;
+    directoryListingParams->position = *position;
+    directoryListingParams->entries = entries;
+    directoryListingParams->maxEntries = maxEntries;
+
+    returnValue = sysCall(SYS_GET_DIRECTORY_ENTRIES, (uint32_t)directoryListingParams, currentPid);
+    currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    *position = directoryListingParams->position;
+    free((uint8_t *)directoryListingParams);
+
+    return returnValue;
+}
+
+uint32_t systemFork()
+{
+    uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    uint32_t returnValue = SYSCALL_FAIL; // Default fail.
+
+    returnValue = sysCall(SYS_FORK, 0x0, currentPid);
+    currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+
+    return returnValue;
+}
+
 /**
  * Translates octal permissions to string like "RWX".
  * @param permissions The octal value.
@@ -2268,6 +2533,19 @@ const JumpTableEntry lib_jump_table[] __attribute__((section(".jumptable"))) =
     {"systemCreateFile", (void*)systemCreateFile},
     {"systemDeleteFile", (void*)systemDeleteFile},
     {"systemCloseFile", (void*)systemCloseFile},
+    {"systemSync", (void*)systemSync},
+    {"systemFsync", (void*)systemFsync},
+    {"systemOpenFileStream", (void*)systemOpenFileStream},
+    {"systemReadFile", (void*)systemReadFile},
+    {"systemWriteFile", (void*)systemWriteFile},
+    {"systemSeekFile", (void*)systemSeekFile},
+    {"systemMMapFile", (void*)systemMMapFile},
+    {"systemMUnmap", (void*)systemMUnmap},
+    {"systemSendFile", (void*)systemSendFile},
+    {"systemFsCheck", (void*)systemFsCheck},
+    {"systemFsDefrag", (void*)systemFsDefrag},
+    {"systemGetDirectoryEntries", (void*)systemGetDirectoryEntries},
+    {"systemFork", (void*)systemFork},
     {"octalTranslation", (void*)octalTranslation},
     {"directoryEntryTypeTranslation", (void*)directoryEntryTypeTranslation},
     {"countHeapObjects", (void*)countHeapObjects},
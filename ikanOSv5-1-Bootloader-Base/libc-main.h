@@ -379,6 +379,111 @@ void systemOpenEmptyFile(uint8_t *fileName, uint32_t requestedSizeInPages);
  * \param fileDescriptor The file descriptor to close.
  */
 void systemCloseFile(uint32_t fileDescriptor);
+/**
+ * The LibC wrapper for the SYS_SYNC sysCall(). Commits pending file system metadata and writes all cached writes to disk.
+ */
+void systemSync();
+/**
+ * The LibC wrapper for the SYS_FSYNC sysCall(). Returns once the file behind the descriptor is on disk.
+ * Returns SYSCALL_SUCCESS, or SYSCALL_FAIL if the descriptor is not a file on disk.
+ * \param fileDescriptor The file descriptor to sync.
+ */
+uint32_t systemFsync(uint32_t fileDescriptor);
+
+/**
+ * The LibC wrapper for the SYS_OPEN_STREAM sysCall(). Opens a file for systemReadFile() and systemWriteFile() without loading it,
+ * so files of any size can be streamed through a small buffer. The descriptor is left in CURRENT_FILE_DESCRIPTOR.
+ * Returns SYSCALL_SUCCESS or SYSCALL_FAIL.
+ * \param fileName The string value of the filename on the file system.
+ * \param requestedPermissions RDWRITE to be able to write, RDONLY otherwise.
+ */
+uint32_t systemOpenFileStream(uint8_t *fileName, uint32_t requestedPermissions);
+
+/**
+ * The LibC wrapper for the SYS_READ_FILE sysCall(). Reads the next bytes of an open file. Returns the number of bytes read,
+ * 0 at end of file, or SYSCALL_FAIL.
+ * \param fileDescriptor The file descriptor to read.
+ * \param buffer Where to put the bytes.
+ * \param length The most bytes to read.
+ */
+uint32_t systemReadFile(uint32_t fileDescriptor, uint8_t *buffer, uint32_t length);
+
+/**
+ * The LibC wrapper for the SYS_WRITE_FILE sysCall(). Writes bytes at the write offset of a file opened with RDWRITE.
+ * Returns the number of bytes written or SYSCALL_FAIL.
+ * \param fileDescriptor The file descriptor to write.
+ * \param buffer The bytes to write.
+ * \param length The number of bytes to write.
+ */
+uint32_t systemWriteFile(uint32_t fileDescriptor, uint8_t *buffer, uint32_t length);
+
+/**
+ * The LibC wrapper for the SYS_LSEEK sysCall(). Moves the read and write offsets of an open file. Returns the new offset or SYSCALL_FAIL.
+ * \param fileDescriptor The file descriptor to seek.
+ * \param offset The distance in bytes, negative to move backwards.
+ * \param whence SEEK_SET, SEEK_CUR or SEEK_END.
+ */
+uint32_t systemSeekFile(uint32_t fileDescriptor, int offset, uint32_t whence);
+
+/**
+ * The LibC wrapper for the SYS_MMAP_FILE sysCall(). Maps part of an open file into memory. Nothing is read until a page is touched,
+ * so only the parts of the file a program looks at come off the disk. Returns the mapped address or 0.
+ * \param fileDescriptor The open file to map.
+ * \param fileOffset Where in the file to start. Must be a multiple of PAGE_SIZE.
+ * \param length The number of bytes to map.
+ * \param requestedPermissions PG_USER_PRESENT_RO to share pages with other readers, PG_USER_PRESENT_RW for a private copy.
+ */
+uint8_t *systemMMapFile(uint32_t fileDescriptor, uint32_t fileOffset, uint32_t length, uint32_t requestedPermissions);
+
+/**
+ * The LibC wrapper for the SYS_MUNMAP sysCall(). Removes a mapping made by systemMMapFile(). Returns SYSCALL_SUCCESS or SYSCALL_FAIL.
+ * \param mappedAddress The address systemMMapFile() returned.
+ */
+uint32_t systemMUnmap(uint8_t *mappedAddress);
+
+/**
+ * The LibC wrapper for the SYS_SENDFILE sysCall(). Sends part of a file to a network pipe without copying it through a user buffer.
+ * Returns the number of bytes sent or SYSCALL_FAIL.
+ * \param fileDescriptor The open file to send.
+ * \param socketDescriptor The network pipe (socket) to send to.
+ * \param offset Where in the file to start.
+ * \param length The number of bytes to send.
+ */
+uint32_t systemSendFile(uint32_t fileDescriptor, uint32_t socketDescriptor, uint32_t offset, uint32_t length);
+
+/**
+ * The LibC wrapper for the SYS_FS_CHECK sysCall(). Checks the file system and, if asked, repairs it.
+ * Returns the number of problems found or SYSCALL_FAIL.
+ * \param report Where to put the results.
+ * \param repair Whether to repair what can be repaired.
+ */
+uint32_t systemFsCheck(struct fsCheckReport *report, bool repair);
+
+/**
+ * The LibC wrapper for the SYS_FS_DEFRAG sysCall(). Moves a fragmented file into one run of free blocks.
+ * Returns SYSCALL_SUCCESS, or SYSCALL_FAIL if there is no file to move.
+ * \param fileName The file to move, or 0 for the next file from *inodeNumber on.
+ * \param inodeNumber Where to start looking. Set to the inode of the file that was looked at.
+ * \param report Where to put the results.
+ */
+uint32_t systemFsDefrag(uint8_t *fileName, uint32_t *inodeNumber, struct fsDefragReport *report);
+
+/**
+ * The LibC wrapper for the SYS_GET_DIRECTORY_ENTRIES sysCall(). Reads a batch of directory entries, each with its inode, size, mode and
+ * link count, so a listing doesn't need a lookup per name. Call it until it returns 0 to read the whole directory.
+ * Returns the number of entries read, 0 at the end of the directory, or SYSCALL_FAIL.
+ * \param directoryName The directory to read, or 0 for the working directory.
+ * \param position Where to pick up, 0 to start. Updated for the next call.
+ * \param entries Where to put the entries.
+ * \param maxEntries The number of entries there is room for.
+ */
+uint32_t systemGetDirectoryEntries(uint8_t *directoryName, uint32_t *position, struct directoryListingEntry *entries, uint32_t maxEntries);
+
+/**
+ * The LibC wrapper for the SYS_FORK sysCall(). Makes a copy of this process that shares its memory until either one writes to it.
+ * Returns 0 in the child, the child's pid in the parent, or SYSCALL_FAIL.
+ */
+uint32_t systemFork();
 
 /**
  * Converts octal permissions in EXT2 to RWX string.
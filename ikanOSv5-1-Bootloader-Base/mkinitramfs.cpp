@@ -0,0 +1,236 @@
+// Copyright (c) 2023-2026 Dan O’Malley
+// This file is licensed under the MIT License. See LICENSE for details.
+
+
+#include "initramfs.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+
+// mkinitramfs runs on the build machine, not on ikanOS. It packs the files named on the command line into
+// the archive initramfsMount() reads: an initramfsHeader, one initramfsEntry per file, then each file as a
+// raw LZ4 block. The output is padded to whole sectors so the Makefile can append it to fs.img.
+// initramfs.h comes first because constants.h clashes with the va_list and NULL from the host's stdio.
+//
+// Usage: ./mkinitramfs initramfs.img file...
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MATCH_START_LIMIT 12
+#define LZ4_MAX_OFFSET 0xFFFF
+#define LZ4_HASH_BITS 12
+
+
+void fail(const char *message, const char *detail)
+{
+    write(2, "mkinitramfs: ", 13);
+    write(2, message, strlen(message));
+    write(2, detail, strlen(detail));
+    write(2, "\n", 1);
+    exit(1);
+}
+
+uint32_t lz4Hash(uint8_t *memory)
+{
+    uint32_t value = memory[0] | (memory[1] << 8) | (memory[2] << 16) | (memory[3] << 24);
+
+    return (value * 2654435761U) >> (32 - LZ4_HASH_BITS);
+}
+
+uint8_t *lz4WriteLength(uint8_t *output, uint32_t length)
+{
+    // The first 15 are in the token, the rest follow as 255s and a final byte below 255
+    length = length - 0xF;
+
+    while (length >= 0xFF)
+    {
+        *output++ = 0xFF;
+        length = length - 0xFF;
+    }
+
+    *output++ = (uint8_t)length;
+
+    return output;
+}
+
+uint8_t *lz4WriteSequence(uint8_t *output, uint8_t *literals, uint32_t literalLength, uint32_t matchOffset, uint32_t matchLength)
+{
+    uint8_t *token = output++;
+    *token = 0;
+
+    if (literalLength >= 0xF)
+    {
+        *token = 0xF0;
+        output = lz4WriteLength(output, literalLength);
+    }
+    else
+    {
+        *token = literalLength << 4;
+    }
+
+    memcpy(output, literals, literalLength);
+    output = output + literalLength;
+
+    // matchLength is 0 only for the final literal run
+    if (matchLength == 0)
+    {
+        return output;
+    }
+
+    *output++ = matchOffset & 0xFF;
+    *output++ = (matchOffset >> 8) & 0xFF;
+
+    matchLength = matchLength - LZ4_MIN_MATCH;
+
+    if (matchLength >= 0xF)
+    {
+        *token = *token | 0xF;
+        output = lz4WriteLength(output, matchLength);
+    }
+    else
+    {
+        *token = *token | matchLength;
+    }
+
+    return output;
+}
+
+uint32_t lz4CompressBlock(uint8_t *input, uint32_t inputLength, uint8_t *output)
+{
+    // Greedy single probe compressor. Worse ratio than lz4 -9 but the output is a plain LZ4 block, and
+    // decompression speed, the only thing the kernel cares about, is the same.
+    uint32_t *hashTable = (uint32_t *)calloc(1 << LZ4_HASH_BITS, sizeof(uint32_t));
+    uint8_t *outputStart = output;
+    uint32_t anchor = 0;
+    uint32_t position = 0;
+
+    if (inputLength > LZ4_MATCH_START_LIMIT)
+    {
+        while (position <= inputLength - LZ4_MATCH_START_LIMIT)
+        {
+            uint32_t hash = lz4Hash(input + position);
+            uint32_t candidate = hashTable[hash]; // Stored plus one so 0 means empty
+            hashTable[hash] = position + 1;
+
+            if (candidate == 0 || (position - (candidate - 1)) > LZ4_MAX_OFFSET
+                || memcmp(input + position, input + candidate - 1, LZ4_MIN_MATCH) != 0)
+            {
+                position++;
+                continue;
+            }
+
+            candidate = candidate - 1;
+
+            uint32_t matchLength = LZ4_MIN_MATCH;
+            while (position + matchLength < inputLength - LZ4_LAST_LITERALS && input[position + matchLength] == input[candidate + matchLength])
+            {
+                matchLength++;
+            }
+
+            output = lz4WriteSequence(output, input + anchor, position - anchor, position - candidate, matchLength);
+            position = position + matchLength;
+            anchor = position;
+        }
+    }
+
+    output = lz4WriteSequence(output, input + anchor, inputLength - anchor, 0, 0);
+
+    free(hashTable);
+
+    return output - outputStart;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fail("usage: mkinitramfs output file...", "");
+    }
+
+    uint32_t numberOfEntries = argc - 2;
+    uint32_t indexSize = sizeof(initramfsHeader) + (numberOfEntries * sizeof(initramfsEntry));
+    uint8_t *archive = (uint8_t *)calloc(INITRAMFS_MAX_SIZE, 1);
+    struct initramfsHeader *InitramfsHeader = (struct initramfsHeader *)archive;
+    struct initramfsEntry *InitramfsEntry = (struct initramfsEntry *)(archive + sizeof(initramfsHeader));
+    uint32_t archiveSize = indexSize;
+
+    if (indexSize > INITRAMFS_MAX_SIZE)
+    {
+        fail("too many files", "");
+    }
+
+    for (uint32_t entry = 0; entry < numberOfEntries; entry++)
+    {
+        char *path = argv[entry + 2];
+        char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+        struct stat fileStat;
+        int fd = open(path, O_RDONLY);
+
+        if (fd < 0 || fstat(fd, &fileStat) != 0)
+        {
+            fail("can't read ", path);
+        }
+
+        // Leave room for the null terminator
+        if (strlen(name) >= INITRAMFS_MAX_NAME_LENGTH)
+        {
+            fail("name too long: ", name);
+        }
+
+        uint32_t fileSize = fileStat.st_size;
+        uint8_t *fileContents = (uint8_t *)malloc(fileSize + 1);
+        uint32_t bytesRead = 0;
+
+        while (bytesRead < fileSize)
+        {
+            ssize_t result = read(fd, fileContents + bytesRead, fileSize - bytesRead);
+            if (result <= 0)
+            {
+                fail("can't read ", path);
+            }
+            bytesRead = bytesRead + result;
+        }
+
+        close(fd);
+
+        // Worst case LZ4 output is the input plus one length byte per 255 literals and a token
+        uint8_t *compressed = (uint8_t *)malloc(fileSize + (fileSize / 0xFF) + 0x10);
+        uint32_t compressedSize = lz4CompressBlock(fileContents, fileSize, compressed);
+
+        if (compressedSize > INITRAMFS_MAX_SIZE - archiveSize)
+        {
+            fail("archive is larger than INITRAMFS_MAX_SIZE at ", name);
+        }
+
+        memcpy(InitramfsEntry[entry].name, name, strlen(name));
+        InitramfsEntry[entry].mode = fileStat.st_mode & 0xFFFF; // Linux and EXT2 use the same mode bits
+        InitramfsEntry[entry].size = fileSize;
+        InitramfsEntry[entry].dataOffset = archiveSize;
+        InitramfsEntry[entry].compressedSize = compressedSize;
+
+        memcpy(archive + archiveSize, compressed, compressedSize);
+        archiveSize = archiveSize + compressedSize;
+
+        free(compressed);
+        free(fileContents);
+    }
+
+    InitramfsHeader->magic = INITRAMFS_MAGIC;
+    InitramfsHeader->numberOfEntries = numberOfEntries;
+    InitramfsHeader->archiveSize = archiveSize;
+
+    uint32_t paddedSize = ((archiveSize + SECTOR_SIZE - 1) / SECTOR_SIZE) * SECTOR_SIZE;
+    int fd = open(argv[1], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0 || write(fd, archive, paddedSize) != (ssize_t)paddedSize)
+    {
+        fail("can't write ", argv[1]);
+    }
+
+    close(fd);
+    free(archive);
+
+    return 0;
+}
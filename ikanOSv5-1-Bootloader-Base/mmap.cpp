@@ -0,0 +1,376 @@
+// Copyright (c) 2023-2026 Dan O’Malley
+// This file is licensed under the MIT License. See LICENSE for details.
+
+
+#include "mmap.h"
+#include "fs.h"
+#include "vm.h"
+#include "x86.h"
+#include "frame-allocator.h"
+#include "libc-main.h"
+#include "constants.h"
+
+// File pages are never read at mmap time. fileMappingCreate() only stamps the page table entries with
+// PG_FILE_MAPPED, which is not present, so the first touch of each page lands in pageFault() and
+// fileMappingFault() reads just that page. Read-only mappings go through the page cache table so every
+// process mapping the same page of the same file shares one frame.
+
+
+uint32_t *fileMappingPageTableEntry(uint32_t pid, uint8_t *virtualAddress)
+{
+    return userPageTableEntry(pid, virtualAddress);
+}
+
+uint8_t *fileMappingCreate(uint32_t pid, uint32_t inode, uint32_t fileOffset, uint32_t length, uint8_t *virtualAddress, uint32_t perms)
+{
+    struct fileMapping *FileMapping = (struct fileMapping *)FILE_MAPPING_TABLE;
+    uint32_t numberOfPages = ceiling(length, PAGE_SIZE);
+
+    if (pid == 0 || inode == 0 || length == 0 || (fileOffset % PAGE_SIZE) != 0 || ((uint32_t)virtualAddress % PAGE_SIZE) != 0)
+    {
+        return 0;
+    }
+
+    if (perms != PG_USER_PRESENT_RO && perms != PG_USER_PRESENT_RW)
+    {
+        return 0;
+    }
+
+    if (virtualAddress == 0)
+    {
+        virtualAddress = findBuffer(pid, numberOfPages, perms);
+    }
+
+    if (virtualAddress == 0 || ((uint32_t)virtualAddress + (numberOfPages * PAGE_SIZE)) > (USER_SPACE_LIMIT + 1))
+    {
+        return 0;
+    }
+
+    while (!acquireLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+
+    for (uint32_t page = 0; page < numberOfPages; page++)
+    {
+        if (*fileMappingPageTableEntry(pid, virtualAddress + (page * PAGE_SIZE)) != 0)
+        {
+            while (!releaseLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+            return 0; // Part of the range is already in use
+        }
+    }
+
+    uint32_t slot = 0;
+    while (slot < MAX_FILE_MAPPINGS && FileMapping[slot].pid != 0)
+    {
+        slot++;
+    }
+
+    if (slot == MAX_FILE_MAPPINGS)
+    {
+        while (!releaseLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+        return 0;
+    }
+
+    FileMapping[slot].pid = pid;
+    FileMapping[slot].inode = inode;
+    FileMapping[slot].virtualAddress = virtualAddress;
+    FileMapping[slot].numberOfPages = numberOfPages;
+    FileMapping[slot].fileOffset = fileOffset;
+    FileMapping[slot].perms = perms;
+
+    // Reserved but not present. This also keeps findBuffer() from handing the range out again.
+    for (uint32_t page = 0; page < numberOfPages; page++)
+    {
+        *fileMappingPageTableEntry(pid, virtualAddress + (page * PAGE_SIZE)) = PG_FILE_MAPPED;
+    }
+
+    while (!releaseLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+
+    return virtualAddress;
+}
+
+void fileMappingReadPage(uint32_t inode, uint32_t pageIndex, uint8_t *destinationMemory, bool cacheActive)
+{
+    uint8_t inodeBuf[INODE_SIZE];
+    struct inode *Inode = (struct inode *)inodeBuf;
+    uint32_t pageStart = pageIndex * PAGE_SIZE;
+
+    // Not loadInode(), its KERNEL_TEMP_INODE_LOC belongs to whoever holds fsMetadataLock()
+    loadInodeUsingBuffer(inode, inodeBuf, FILE_MAPPING_FAULT_BLOCK_LOC, cacheActive);
+
+    for (uint32_t pageOffset = 0; pageOffset < PAGE_SIZE; pageOffset = pageOffset + BLOCK_SIZE)
+    {
+        uint32_t diskBlock = 0;
+
+        if ((pageStart + pageOffset) < Inode->i_size)
+        {
+            // Not FILE_IO_INDIRECT_BLOCK_LOC, the fault may have interrupted a read or write that is using it
+            diskBlock = fileBlockToDiskBlock(Inode, (pageStart + pageOffset) / BLOCK_SIZE, FILE_MAPPING_FAULT_BLOCK_LOC, cacheActive);
+        }
+
+        if (diskBlock == 0)
+        {
+            fillMemory(destinationMemory + pageOffset, 0x0, BLOCK_SIZE);
+        }
+        else
+        {
+            readBlock(diskBlock, destinationMemory + pageOffset, cacheActive);
+        }
+    }
+
+    // Whatever is left of the last block past the end of the file reads as zeros
+    if (Inode->i_size > pageStart && Inode->i_size < (pageStart + PAGE_SIZE))
+    {
+        fillMemory(destinationMemory + (Inode->i_size - pageStart), 0x0, (pageStart + PAGE_SIZE) - Inode->i_size);
+    }
+}
+
+bool fileMappingFault(uint32_t pid, uint8_t *faultAddress, bool cacheActive)
+{
+    struct fileMapping *FileMapping = (struct fileMapping *)FILE_MAPPING_TABLE;
+    struct pageCacheEntry *PageCacheEntry = (struct pageCacheEntry *)PAGE_CACHE_TABLE;
+    struct pageCacheEntry *freePageCacheEntry = 0;
+    uint8_t *page = (uint8_t *)((uint32_t)faultAddress & ~(PAGE_SIZE - 1));
+
+    if (pid == 0 || (uint32_t)faultAddress > USER_SPACE_LIMIT)
+    {
+        return false;
+    }
+
+    uint32_t *pageTableEntry = fileMappingPageTableEntry(pid, page);
+
+    // Anything else, including a write to a present read-only page, is a real fault
+    if (*pageTableEntry != PG_FILE_MAPPED)
+    {
+        return false;
+    }
+
+    while (!acquireLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+
+    uint32_t slot = 0;
+    while (slot < MAX_FILE_MAPPINGS && !(FileMapping[slot].pid == pid && page >= FileMapping[slot].virtualAddress && page < (FileMapping[slot].virtualAddress + (FileMapping[slot].numberOfPages * PAGE_SIZE))))
+    {
+        slot++;
+    }
+
+    if (slot == MAX_FILE_MAPPINGS)
+    {
+        while (!releaseLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+        return false;
+    }
+
+    uint32_t pageIndex = (FileMapping[slot].fileOffset / PAGE_SIZE) + ((uint32_t)(page - FileMapping[slot].virtualAddress) / PAGE_SIZE);
+
+    if (FileMapping[slot].perms == PG_USER_PRESENT_RO)
+    {
+        for (uint32_t entry = 0; entry < MAX_PAGE_CACHE_ENTRIES; entry++)
+        {
+            if (PageCacheEntry[entry].inode == FileMapping[slot].inode && PageCacheEntry[entry].pageIndex == pageIndex)
+            {
+                // Another process already read this page
+                PageCacheEntry[entry].referenceCount++;
+                *pageTableEntry = (PageCacheEntry[entry].frameNumber * PAGE_SIZE) | PG_USER_PRESENT_RO;
+                invalidatePage(page);
+
+                while (!releaseLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+                return true;
+            }
+
+            if (PageCacheEntry[entry].inode == 0 && freePageCacheEntry == 0)
+            {
+                freePageCacheEntry = &PageCacheEntry[entry];
+            }
+        }
+    }
+
+    // Shared frames belong to the kernel so freeAllFrames() on one reader can't pull them from the others.
+    // With the page cache full the page is simply private to this process.
+    uint32_t frameNumber = allocateCachedFrame((freePageCacheEntry != 0) ? KERNEL_OWNED : pid);
+
+    if (frameNumber == 0)
+    {
+        while (!releaseLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+        return false;
+    }
+
+    // Writable while the kernel fills it through the user address
+    *pageTableEntry = (frameNumber * PAGE_SIZE) | PG_USER_PRESENT_RW;
+    invalidatePage(page);
+
+    fileMappingReadPage(FileMapping[slot].inode, pageIndex, page, cacheActive);
+
+    if (FileMapping[slot].perms == PG_USER_PRESENT_RO)
+    {
+        if (freePageCacheEntry != 0)
+        {
+            freePageCacheEntry->inode = FileMapping[slot].inode;
+            freePageCacheEntry->pageIndex = pageIndex;
+            freePageCacheEntry->frameNumber = frameNumber;
+            freePageCacheEntry->referenceCount = 1;
+        }
+
+        *pageTableEntry = (frameNumber * PAGE_SIZE) | PG_USER_PRESENT_RO;
+        invalidatePage(page);
+    }
+
+    while (!releaseLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+
+    return true;
+}
+
+void fileMappingReleasePage(struct fileMapping *FileMapping, uint8_t *virtualAddress)
+{
+    struct pageCacheEntry *PageCacheEntry = (struct pageCacheEntry *)PAGE_CACHE_TABLE;
+    uint32_t *pageTableEntry = fileMappingPageTableEntry(FileMapping->pid, virtualAddress);
+
+    if ((*pageTableEntry & PG_PRESENT) == 0)
+    {
+        return;
+    }
+
+    uint32_t frameNumber = *pageTableEntry / PAGE_SIZE;
+    bool sharedFrame = false;
+
+    for (uint32_t entry = 0; entry < MAX_PAGE_CACHE_ENTRIES && FileMapping->perms == PG_USER_PRESENT_RO; entry++)
+    {
+        if (PageCacheEntry[entry].inode != 0 && PageCacheEntry[entry].frameNumber == frameNumber)
+        {
+            sharedFrame = true;
+            PageCacheEntry[entry].referenceCount--;
+
+            if (PageCacheEntry[entry].referenceCount == 0)
+            {
+                freeFrame(frameNumber);
+                PageCacheEntry[entry].inode = 0;
+            }
+            break;
+        }
+    }
+
+    if (!sharedFrame)
+    {
+        freeFrame(frameNumber);
+    }
+}
+
+void fileMappingReleasePages(struct fileMapping *FileMapping)
+{
+    for (uint32_t page = 0; page < FileMapping->numberOfPages; page++)
+    {
+        uint8_t *virtualAddress = FileMapping->virtualAddress + (page * PAGE_SIZE);
+
+        fileMappingReleasePage(FileMapping, virtualAddress);
+
+        *fileMappingPageTableEntry(FileMapping->pid, virtualAddress) = 0x0;
+        invalidatePage(virtualAddress);
+    }
+
+    FileMapping->pid = 0;
+}
+
+void pageCacheInvalidate(uint32_t inode)
+{
+    struct fileMapping *FileMapping = (struct fileMapping *)FILE_MAPPING_TABLE;
+
+    while (!acquireLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+
+    // Every page cache entry is held by at least one read-only mapping of its file, so releasing those
+    // pages drops the entries too. Read-only mappings see the file, so their pages go back to PG_FILE_MAPPED and are read again on the
+    // next touch. Writable mappings are private copies taken at fault time and keep what they have.
+    for (uint32_t slot = 0; slot < MAX_FILE_MAPPINGS; slot++)
+    {
+        if (FileMapping[slot].pid == 0 || FileMapping[slot].inode != inode || FileMapping[slot].perms != PG_USER_PRESENT_RO)
+        {
+            continue;
+        }
+
+        for (uint32_t page = 0; page < FileMapping[slot].numberOfPages; page++)
+        {
+            uint8_t *virtualAddress = FileMapping[slot].virtualAddress + (page * PAGE_SIZE);
+
+            fileMappingReleasePage(&FileMapping[slot], virtualAddress);
+
+            *fileMappingPageTableEntry(FileMapping[slot].pid, virtualAddress) = PG_FILE_MAPPED;
+            invalidatePage(virtualAddress);
+        }
+    }
+
+    while (!releaseLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+}
+
+uint32_t fileMappingRemove(uint32_t pid, uint8_t *virtualAddress)
+{
+    struct fileMapping *FileMapping = (struct fileMapping *)FILE_MAPPING_TABLE;
+
+    while (!acquireLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+
+    for (uint32_t slot = 0; slot < MAX_FILE_MAPPINGS; slot++)
+    {
+        if (FileMapping[slot].pid == pid && FileMapping[slot].virtualAddress == virtualAddress)
+        {
+            fileMappingReleasePages(&FileMapping[slot]);
+
+            while (!releaseLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+            return SYSCALL_SUCCESS;
+        }
+    }
+
+    while (!releaseLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+
+    return SYSCALL_FAIL;
+}
+
+void fileMappingRemoveAll(uint32_t pid)
+{
+    struct fileMapping *FileMapping = (struct fileMapping *)FILE_MAPPING_TABLE;
+
+    while (!acquireLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+
+    for (uint32_t slot = 0; slot < MAX_FILE_MAPPINGS; slot++)
+    {
+        if (FileMapping[slot].pid == pid)
+        {
+            fileMappingReleasePages(&FileMapping[slot]);
+        }
+    }
+
+    while (!releaseLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+}
+
+void fileMappingUnshare(uint32_t parentPid, uint32_t childPid)
+{
+    struct fileMapping *FileMapping = (struct fileMapping *)FILE_MAPPING_TABLE;
+
+    while (!acquireLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+
+    for (uint32_t slot = 0; slot < MAX_FILE_MAPPINGS; slot++)
+    {
+        if (FileMapping[slot].pid != parentPid)
+        {
+            continue;
+        }
+
+        for (uint32_t page = 0; page < FileMapping[slot].numberOfPages; page++)
+        {
+            uint8_t *virtualAddress = FileMapping[slot].virtualAddress + (page * PAGE_SIZE);
+            uint32_t *childEntry = fileMappingPageTableEntry(childPid, virtualAddress);
+            uint32_t *parentEntry = fileMappingPageTableEntry(parentPid, virtualAddress);
+
+            if ((*childEntry & PG_PRESENT) != 0 && pageFrameOwner(*childEntry / PAGE_SIZE) == PAGEFRAME_SHARED)
+            {
+                uint32_t frameNumber = *childEntry / PAGE_SIZE;
+
+                freeFrame(frameNumber);
+
+                // The parent is the only one left, so its mapping goes back to what it was
+                if (pageFrameClaimShared(frameNumber, parentPid))
+                {
+                    *parentEntry = (frameNumber * PAGE_SIZE) | FileMapping[slot].perms;
+                    invalidatePage(virtualAddress);
+                }
+            }
+
+            *childEntry = 0x0;
+        }
+    }
+
+    while (!releaseLock(KERNEL_OWNED, FILE_MAPPING_TABLE)) {}
+}
@@ -0,0 +1,131 @@
+// Copyright (c) 2023-2026 Dan O’Malley
+// This file is licensed under the MIT License. See LICENSE for details.
+
+
+#include "constants.h"
+
+/**
+ * The mmap parameter structure. This is used to pass a file mapping request in a sysCall().
+ */
+struct mmapParameter
+{
+    /** The open file to map. */
+    uint32_t fileDescriptor;
+    /** Where in the file the mapping starts. Must be a multiple of PAGE_SIZE. */
+    uint32_t fileOffset;
+    /** The number of bytes to map. Rounded up to whole pages. */
+    uint32_t length;
+    /** PG_USER_PRESENT_RO for a mapping shared with every other reader of the file, PG_USER_PRESENT_RW for a private copy. */
+    uint32_t requestedPermissions;
+    /** The page aligned user address to map at, or 0 to let the kernel pick. */
+    uint8_t *requestedAddress;
+};
+
+/**
+ * One file mapping in a process. The pages are reserved with PG_FILE_MAPPED and filled in by the page fault handler.
+ */
+struct fileMapping
+{
+    /** The owning pid. 0 means the slot is free. */
+    uint32_t pid;
+    uint32_t inode;
+    uint8_t *virtualAddress;
+    uint32_t numberOfPages;
+    /** The file offset of the first page. */
+    uint32_t fileOffset;
+    uint32_t perms;
+};
+
+/**
+ * One file page held in a frame shared by all read-only mappings of it.
+ */
+struct pageCacheEntry
+{
+    /** The file's inode. 0 means the slot is free. */
+    uint32_t inode;
+    /** The file offset divided by PAGE_SIZE. */
+    uint32_t pageIndex;
+    uint32_t frameNumber;
+    /** How many page table entries point at the frame. The frame is freed when this drops to zero. */
+    uint32_t referenceCount;
+};
+
+/**
+ * Returns a pointer to the page table entry for a user address in a process's page tables.
+ * \param pid The pid whose page tables you want.
+ * \param virtualAddress The user address.
+ */
+uint32_t *fileMappingPageTableEntry(uint32_t pid, uint8_t *virtualAddress);
+
+/**
+ * Reserves a range of a process's address space for a file. Nothing is read until the pages are touched.
+ * Returns the user address of the mapping or 0 on failure.
+ * \param pid The pid to map the file into.
+ * \param inode The inode of the file.
+ * \param fileOffset The page aligned file offset of the first page.
+ * \param length The number of bytes to map.
+ * \param virtualAddress The page aligned address to map at, or 0 to use findBuffer().
+ * \param perms PG_USER_PRESENT_RO (shared) or PG_USER_PRESENT_RW (private).
+ */
+uint8_t *fileMappingCreate(uint32_t pid, uint32_t inode, uint32_t fileOffset, uint32_t length, uint8_t *virtualAddress, uint32_t perms);
+
+/**
+ * Called from the page fault handler. If the address is in one of the pid's file mappings, fills in the page from the file
+ * (or from the page cache for a read-only mapping) and returns true so the faulting instruction can be restarted.
+ * \param pid The pid that faulted.
+ * \param faultAddress The address from CR2.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+bool fileMappingFault(uint32_t pid, uint8_t *faultAddress, bool cacheActive);
+
+/**
+ * Unmaps the file mapping that starts at virtualAddress and releases its frames. Returns SYSCALL_SUCCESS or SYSCALL_FAIL.
+ * \param pid The pid that owns the mapping.
+ * \param virtualAddress The address returned by fileMappingCreate().
+ */
+uint32_t fileMappingRemove(uint32_t pid, uint8_t *virtualAddress);
+
+/**
+ * Frees the frames behind a mapping, dropping page cache references, and clears its page table entries and slot.
+ * The caller must hold the FILE_MAPPING_TABLE lock.
+ * \param FileMapping The mapping to release.
+ */
+void fileMappingReleasePages(struct fileMapping *FileMapping);
+
+/**
+ * Releases the frame behind one page of a mapping, dropping its page cache reference. The page table entry is left for the caller.
+ * The caller must hold the FILE_MAPPING_TABLE lock.
+ * \param FileMapping The mapping the page belongs to.
+ * \param virtualAddress The page's user address.
+ */
+void fileMappingReleasePage(struct fileMapping *FileMapping, uint8_t *virtualAddress);
+
+/**
+ * Drops every page cache entry of a file and sends the pages of its read-only mappings back to PG_FILE_MAPPED, so the
+ * next touch reads what is on disk now. Called from kInodeChanged() for writes, deletes and inode reuse.
+ * \param inode The inode that changed.
+ */
+void pageCacheInvalidate(uint32_t inode);
+
+/**
+ * Unmaps every file mapping of a process. Called when the process exits.
+ * \param pid The exiting pid.
+ */
+void fileMappingRemoveAll(uint32_t pid);
+
+/**
+ * Keeps a parent's file mappings out of a forked child. The child's entries for them are cleared and the
+ * copy-on-write shares forkAddressSpace() took on their frames are dropped again.
+ * \param parentPid The pid that forked.
+ * \param childPid The new pid.
+ */
+void fileMappingUnshare(uint32_t parentPid, uint32_t childPid);
+
+/**
+ * Reads one page of a file into memory, zero filling past the end of the file and over holes.
+ * \param inode The inode of the file.
+ * \param pageIndex The file offset divided by PAGE_SIZE.
+ * \param destinationMemory Where to put the page.
+ * \param cacheActive Tell me if the disk read cache is active. This is only active on kernel.
+ */
+void fileMappingReadPage(uint32_t inode, uint32_t pageIndex, uint8_t *destinationMemory, bool cacheActive);
@@ -38,6 +38,7 @@
 
 #define MIN_PACKET_LEN 60 
 #define MAX_PACKET_LEN 1514
+#define UDP_FRAME_HEADER_LEN 42 // Ethernet + IP + UDP
 
 /**
  * Computes the checksum for a given data buffer, which is used for IP and UDP headers.
@@ -433,6 +434,23 @@ void netUDPRcv()
 void netUDPSend(struct networkParameter *NetworkParameter) 
 {
     uint32_t payloadLength = strlen(NetworkParameter->packetPayload) + 1;  // Include null terminator
+
+    netUDPSendPayload(NetworkParameter, NetworkParameter->packetPayload, payloadLength);
+}
+
+uint32_t checkSumAdd(uint32_t sum, uint8_t *data, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i += 2)
+    {
+        sum += (data[i] << 8) | (i + 1 < len ? data[i+1] : 0);
+    }
+    return sum;
+}
+
+bool netUDPSendPayload(struct networkParameter *NetworkParameter, uint8_t *payload, uint32_t payloadLength)
+{
+    // The headers are built on their own and the payload goes to the NIC straight from the caller's
+    // buffer, so a file block can be sent without first being copied into a packet.
     uint16_t udpLength = 8 + payloadLength;
     uint16_t ipLength = 20 + udpLength;
     uint16_t frameLength = 14 + ipLength;
@@ -440,25 +458,25 @@ void netUDPSend(struct networkParameter *NetworkParameter)
 
     if (frameLength > MAX_PACKET_LEN)
     {
-        return;
+        return false;
     }
 
     uint32_t sendLength = frameLength < MIN_PACKET_LEN ? MIN_PACKET_LEN : frameLength;
 
-    uint8_t packet[MAX_PACKET_LEN];
-    fillMemory(packet, 0, sendLength);
+    uint8_t header[UDP_FRAME_HEADER_LEN];
+    fillMemory(header, 0, UDP_FRAME_HEADER_LEN);
 
     // Layer 2
     // Ethernet header
     uint8_t destinationMacAddress[6] = {0x02, 0x00, 0xA0, 0x04, 0x00, 0x00};
-    bytecpy(packet, destinationMacAddress, 6);
+    bytecpy(header, destinationMacAddress, 6);
     uint8_t sourceMacAddress[6] = {0x52, 0x54, 0x00, 0x12, 0x34, 0x56};
-    bytecpy(packet + 6, sourceMacAddress, 6);
-    *((uint16_t *)(packet + 12)) = hostToNetworkShort(0x0800); // IPv4
+    bytecpy(header + 6, sourceMacAddress, 6);
+    *((uint16_t *)(header + 12)) = hostToNetworkShort(0x0800); // IPv4
 
     // Layer 3
     // IP header
-    uint8_t *ipHeader = packet + 14;
+    uint8_t *ipHeader = header + 14;
     ipHeader[0] = 0x45; // Version
     ipHeader[1] = 0x00;
     *((uint16_t *)(ipHeader + 2)) = hostToNetworkShort(ipLength);
@@ -478,21 +496,27 @@ void netUDPSend(struct networkParameter *NetworkParameter)
     *((uint16_t *)(udpHeader + 2)) = hostToNetworkShort(NetworkParameter->destinationPort);
     *((uint16_t *)(udpHeader + 4)) = hostToNetworkShort(udpLength);
     *((uint16_t *)(udpHeader + 6)) = 0;
-    bytecpy(udpHeader + 8, NetworkParameter->packetPayload, payloadLength);
 
     // Compute IP checksum
     uint16_t ipChecksum = checkSum(ipHeader, 20);
     *((uint16_t *)(ipHeader + 10)) = hostToNetworkShort(ipChecksum);
 
-    // Compute UDP checksum
-    uint8_t pseudoHeader[12 + udpLength];
-    fillMemory(pseudoHeader, 0, 12 + udpLength);
+    // Compute UDP checksum over the pseudo header, UDP header and payload in place
+    uint8_t pseudoHeader[12];
+    fillMemory(pseudoHeader, 0, 12);
     *((uint32_t *)(pseudoHeader + 0)) = hostToNetworkLong(NetworkParameter->sourceIPAddress);
     *((uint32_t *)(pseudoHeader + 4)) = hostToNetworkLong(NetworkParameter->destinationIPAddress);
     pseudoHeader[9] = 0x11;
     *((uint16_t *)(pseudoHeader + 10)) = hostToNetworkShort(udpLength);
-    bytecpy(pseudoHeader + 12, udpHeader, udpLength);
-    uint16_t udpChecksum = checkSum(pseudoHeader, 12 + udpLength);
+
+    uint32_t sum = checkSumAdd(0, pseudoHeader, 12);
+    sum = checkSumAdd(sum, udpHeader, 8);
+    sum = checkSumAdd(sum, payload, payloadLength);
+    while (sum >> 16)
+    {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    uint16_t udpChecksum = ~sum;
     if (udpChecksum == 0)
     {
         udpChecksum = 0xFFFF;
@@ -509,7 +533,27 @@ void netUDPSend(struct networkParameter *NetworkParameter)
     outputIOPort(NE2000_BASE_PORT + NE_RSAR1, 0x40);
     outputIOPort(NE2000_BASE_PORT + NE_RBCR0, sendLength & 0xFF);
     outputIOPort(NE2000_BASE_PORT + NE_RBCR1, sendLength >> 8);
-    memToIoPortWord(NE2000_BASE_PORT + 0x10, packet, (sendLength + 1) / 2);
+
+    // One remote DMA, fed in three pieces: header, payload, then zero padding up to the minimum frame
+    uint32_t wordsWritten = UDP_FRAME_HEADER_LEN / 2;
+    memToIoPortWord(NE2000_BASE_PORT + 0x10, header, UDP_FRAME_HEADER_LEN / 2);
+    memToIoPortWord(NE2000_BASE_PORT + 0x10, payload, payloadLength / 2);
+    wordsWritten = wordsWritten + (payloadLength / 2);
+
+    uint16_t lastWord = 0;
+    if (payloadLength % 2 != 0)
+    {
+        lastWord = payload[payloadLength - 1];
+        memToIoPortWord(NE2000_BASE_PORT + 0x10, (uint8_t *)&lastWord, 1);
+        wordsWritten++;
+    }
+
+    lastWord = 0;
+    while (wordsWritten < ((sendLength + 1) / 2))
+    {
+        memToIoPortWord(NE2000_BASE_PORT + 0x10, (uint8_t *)&lastWord, 1);
+        wordsWritten++;
+    }
 
     // Wait for RDC and ack
     for (uint32_t i = 0; i < 100000; i++)
@@ -537,4 +581,6 @@ void netUDPSend(struct networkParameter *NetworkParameter)
 
     networkPacketsTransmittedCount++;
     *(uint32_t*)(NETWORK_PACKETS_TRANSMITTED) = networkPacketsTransmittedCount;
+
+    return true;
 }
\ No newline at end of file
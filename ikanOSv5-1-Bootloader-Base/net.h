@@ -64,4 +64,28 @@ void netUDPRcv();
  *
  * @param NetworkParameter Pointer to a structure containing source/destination IP, ports, and payload.
  */
-void netUDPSend(struct networkParameter *NetworkParameter);
\ No newline at end of file
+void netUDPSend(struct networkParameter *NetworkParameter);
+
+/**
+ * Sends one UDP packet whose payload is read straight from the given buffer. Only the 42 bytes of headers are built
+ * in a local buffer. The UDP checksum is summed over the payload in place and the payload is fed to the NIC's
+ * remote DMA directly, so callers such as sendfile can transmit file blocks without copying them into a packet.
+ * Returns false if the payload does not fit in one frame.
+ *
+ * @param NetworkParameter Source/destination IP and ports. packetPayload is ignored.
+ * @param payload The payload bytes.
+ * @param payloadLength The number of payload bytes, at most MAX_UDP_PAYLOAD_LEN.
+ * @return True if the packet was handed to the NIC.
+ */
+bool netUDPSendPayload(struct networkParameter *NetworkParameter, uint8_t *payload, uint32_t payloadLength);
+
+/**
+ * Adds 16-bit big endian words from a buffer to a running internet checksum sum without folding or complementing it,
+ * so a checksum can be computed across several buffers. Every buffer but the last must have an even length.
+ *
+ * @param sum The running sum.
+ * @param data Pointer to the data buffer.
+ * @param len Length of the data buffer in bytes.
+ * @return The new running sum.
+ */
+uint32_t checkSumAdd(uint32_t sum, uint8_t *data, uint32_t len);
@@ -88,6 +88,10 @@ protected_mode_code:
     mov eax, 0x993000
     lidt [eax]
     
+    mov eax, cr4
+    or eax, 0x90           ; Page size extensions and global pages, the kernel is mapped with 4 MB global pages
+    mov cr4, eax
+
     mov eax, 0xA00000
     mov cr3, eax
 
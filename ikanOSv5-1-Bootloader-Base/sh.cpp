@@ -38,6 +38,7 @@ uint8_t *kernelLogCommand = (uint8_t *)"kl";
 uint8_t *changeDirectoryCommand = (uint8_t *)"cd";
 uint8_t *moveCommand = (uint8_t *)"mv";
 uint8_t *changeFileModeCommand = (uint8_t *)"chmod";
+uint8_t *syncCommand = (uint8_t *)"sync";
 
 
 uint32_t findShellScriptFile(uint8_t *inputString) 
@@ -190,6 +191,7 @@ void main()
             printString(COLOR_WHITE, 33, 47, (uint8_t *)"go = Global objects");
             printString(COLOR_WHITE, 34, 47, (uint8_t *)"kl = View kernel log");
             printString(COLOR_WHITE, 35, 47, (uint8_t *)"chmod = chmod <file> <-rwxrwxrwx>");
+            printString(COLOR_WHITE, 36, 47, (uint8_t *)"sync = Write cached data to disk");
 
             
         }
@@ -407,6 +409,15 @@ void main()
 
             myPid = readValueFromMemLoc(RUNNING_PID_LOC);
 
+        }
+        else if (strcmp(command, syncCommand) == 0)
+        {
+            clearScreen();
+            printPrompt(myPid);
+            systemSync();
+
+            myPid = readValueFromMemLoc(RUNNING_PID_LOC);
+
         }
         else if (strcmp(command, schedCommand) == 0)
         {
@@ -468,7 +479,7 @@ void main()
                 myPid = readValueFromMemLoc(RUNNING_PID_LOC);
                 currentInputFileDescriptor = readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR);
 
-                systemOpenEmptyFile(strConcat(removeExtension((uint8_t*)commandArgument1String), (uint8_t*)".tmp\n"), 1);
+                systemOpenEmptyFile(strConcat((uint8_t*)TMPFS_MOUNT_POINT, strConcat(removeExtension((uint8_t*)commandArgument1String), (uint8_t*)".tmp\n")), 1);
                 myPid = readValueFromMemLoc(RUNNING_PID_LOC);
                 currentTempFileDescriptor = readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR);
 
@@ -476,7 +487,7 @@ void main()
                 myPid = readValueFromMemLoc(RUNNING_PID_LOC);
                 currentTempFileDescriptor = readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR);
 
-                systemOpenFile(strConcat(removeExtension((uint8_t*)commandArgument1String), (uint8_t*)".tmp\n"), RDWRITE);
+                systemOpenFile(strConcat((uint8_t*)TMPFS_MOUNT_POINT, strConcat(removeExtension((uint8_t*)commandArgument1String), (uint8_t*)".tmp\n")), RDWRITE);
                 myPid = readValueFromMemLoc(RUNNING_PID_LOC);
                 currentTempFileDescriptor = readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR);
 
@@ -561,7 +572,7 @@ void main()
                 systemCloseFile(pipeOutFd);
                 myPid = readValueFromMemLoc(RUNNING_PID_LOC);
 
-                systemDeleteFile(strConcat(removeExtension((uint8_t*)commandArgument1String), (uint8_t*)".tmp"));
+                systemDeleteFile(strConcat((uint8_t*)TMPFS_MOUNT_POINT, strConcat(removeExtension((uint8_t*)commandArgument1String), (uint8_t*)".tmp")));
                 myPid = readValueFromMemLoc(RUNNING_PID_LOC);
 
                 free(pipeInFdString);
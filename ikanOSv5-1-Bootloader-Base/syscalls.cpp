@@ -21,6 +21,10 @@
 #include "schedule.h"
 #include "sound.h"
 #include "net.h"
+#include "journal.h"
+#include "mmap.h"
+#include "tmpfs.h"
+#include "initramfs.h"
 
 
 uint32_t returnedArgument = 0;
@@ -38,6 +42,7 @@ uint32_t newSysHandlertaskStructLocation;
 uint32_t returnedPid;
 uint32_t returnedValueFromSyscallFunction;
 bool cachingEnabled = true;
+uint32_t forkedChildPid[MAX_PROCESSES + 1]; // Indexed by parent pid, nonzero while the parent waits in sysFork()
 
 
 void sysSound(struct soundParameter *SoundParameter)
@@ -63,9 +68,29 @@ uint32_t sysOpen(struct fileParameter *FileParameter, uint32_t currentPid, uint3
     uint8_t *newBinaryFilenameLoc = kMalloc(currentPid, FileParameter->fileNameLength);
     strcpyRemoveNewline(newBinaryFilenameLoc, FileParameter->fileName);
 
+    if (tmpfsIsTmpPath(newBinaryFilenameLoc))
+    {
+        if (tmpfsOpen(newBinaryFilenameLoc, currentPid, 0) == SYSCALL_FAIL)
+        {
+            // On success the name belongs to the new global object, here nothing holds it
+            kFree(newBinaryFilenameLoc);
+            printString(COLOR_RED, 2, 5, (uint8_t *)"File not found!");
+            sysWait();
+            sysWait();
+            sysWait();
+            return SYSCALL_FAIL;
+        }
+
+        return SYSCALL_SUCCESS;
+    }
+
     if (FileParameter->requestedPermissions == RDWRITE)
     {
-        if (!fileAvailableToBeLocked((uint8_t *)GLOBAL_OBJECT_TABLE, returnInodeofFileName(newBinaryFilenameLoc, cachingEnabled, directoryInode)))
+        fsMetadataLock();
+        uint32_t inodeToLock = returnInodeofFileName(newBinaryFilenameLoc, cachingEnabled, directoryInode);
+        fsMetadataUnlock();
+
+        if (!fileAvailableToBeLocked((uint8_t *)GLOBAL_OBJECT_TABLE, inodeToLock))
         {
             printString(COLOR_RED, 3, 2, (uint8_t *)"File locked by another process!");
             sysWait();
@@ -81,6 +106,7 @@ uint32_t sysOpen(struct fileParameter *FileParameter, uint32_t currentPid, uint3
     if (Task->nextAvailableFileDescriptor >= MAX_FILE_DESCRIPTORS) 
     {
         // Failure
+        kFree(newBinaryFilenameLoc);
         return SYSCALL_FAIL; // reached the max open files
     }
     
@@ -89,9 +115,13 @@ uint32_t sysOpen(struct fileParameter *FileParameter, uint32_t currentPid, uint3
     if (inodePage == 0)
     {
         //panic((uint8_t *)"Syscalls.cpp:sysOpen() -> open request available page is null");
+        kFree(newBinaryFilenameLoc);
         return SYSCALL_FAIL;
     }
 
+    // Held from the lookup through the load so the file can't be deleted or rewritten in between
+    fsMetadataLock();
+
     if (!fsFindFile(newBinaryFilenameLoc, (uint8_t *)inodePage, cachingEnabled, directoryInode))
     {
         directoryInode = ROOTDIR_INODE;
@@ -101,6 +131,9 @@ uint32_t sysOpen(struct fileParameter *FileParameter, uint32_t currentPid, uint3
             
             if (!fsFindFile(newBinaryFilenameLoc, (uint8_t *)inodePage, cachingEnabled, directoryInode))
             {
+                fsMetadataUnlock();
+                freePage(currentPid, inodePage);
+                kFree(newBinaryFilenameLoc);
                 printString(COLOR_RED, 2, 5, (uint8_t *)"File not found!");
                 sysWait();
                 sysWait();
@@ -116,28 +149,20 @@ uint32_t sysOpen(struct fileParameter *FileParameter, uint32_t currentPid, uint3
 
     uint8_t *requestedBuffer = findBuffer(currentPid, pagesNeedForTmpBinary, PG_USER_PRESENT_RW);
 
-    //request block of pages for temporary file storage to load file based on first available page above
-    for (uint32_t pageCount = 0; pageCount < pagesNeedForTmpBinary; pageCount++)
-    {                
-        if (!requestSpecificPage(currentPid, (uint8_t *)((uint32_t)requestedBuffer + (pageCount * PAGE_SIZE)), PG_USER_PRESENT_RW))
-        {
-            clearScreen();
-            printString(COLOR_RED, 2, 2, (uint8_t *)"Requested page is not available");
-            panic((uint8_t *)"syscalls.cpp -> USER_TEMP_FILE_LOC page request");
-        }
-
-        // Zero each page in case it has been used previously
-        fillMemory((uint8_t *)((uint32_t)requestedBuffer + (pageCount * PAGE_SIZE)), 0x0, PAGE_SIZE);
-    }
+    // The file buffer's pages come from the zero pool as they are first written, rather than being zeroed here
+    reserveDemandPages(currentPid, requestedBuffer, pagesNeedForTmpBinary);
 
     loadFileFromInodeStruct((uint8_t *)inodePage, requestedBuffer, cachingEnabled);
+    uint32_t fileInode = returnInodeofFileName(newBinaryFilenameLoc, cachingEnabled, directoryInode);
 
-    Task->fileDescriptor[Task->nextAvailableFileDescriptor] = (globalObjectTableEntry *)insertGlobalObjectTableEntry((uint8_t *)GLOBAL_OBJECT_TABLE, currentPid, (int)(returnInodeofFileName(newBinaryFilenameLoc, cachingEnabled, directoryInode)), GOTE_TYPE_FILE, 0, 0, 0, 0, Inode->i_size, requestedBuffer, pagesNeedForTmpBinary, 0, newBinaryFilenameLoc, 0, 0, 0);
+    fsMetadataUnlock();
+
+    Task->fileDescriptor[Task->nextAvailableFileDescriptor] = (globalObjectTableEntry *)insertGlobalObjectTableEntry((uint8_t *)GLOBAL_OBJECT_TABLE, currentPid, (int)fileInode, GOTE_TYPE_FILE, 0, 0, 0, 0, Inode->i_size, requestedBuffer, pagesNeedForTmpBinary, 0, newBinaryFilenameLoc, 0, 0, 0);
     struct globalObjectTableEntry *GOTE = (globalObjectTableEntry *)Task->fileDescriptor[Task->nextAvailableFileDescriptor];
 
     if (FileParameter->requestedPermissions == RDWRITE)
     {
-        if (!lockFile((uint8_t *)GLOBAL_OBJECT_TABLE, currentPid, returnInodeofFileName(newBinaryFilenameLoc, cachingEnabled, directoryInode)))
+        if (!lockFile((uint8_t *)GLOBAL_OBJECT_TABLE, currentPid, fileInode))
         {
             printString(COLOR_RED, 4, 2, (uint8_t *)"Unable to acquire file lock!");
             wait(1);
@@ -148,10 +173,10 @@ uint32_t sysOpen(struct fileParameter *FileParameter, uint32_t currentPid, uint3
     struct openBufferTable *openBufferTable = (struct openBufferTable*)OPEN_BUFFER_TABLE;
 
     freePage(currentPid, inodePage);
-    storeValueAtMemLoc(CURRENT_FILE_DESCRIPTOR, ((int)Task->nextAvailableFileDescriptor));
-    storeValueAtMemLoc(CURRENT_FILE_DESCRIPTOR_PTR, (int)requestedBuffer);
-    storeValueAtMemLoc((uint8_t *)&openBufferTable->buffers[Task->nextAvailableFileDescriptor], (int)requestedBuffer);
-    storeValueAtMemLoc((uint8_t *)&openBufferTable->bufferSize[Task->nextAvailableFileDescriptor], (int)GOTE->size);
+    storeValueAtProtectedMemLoc(CURRENT_FILE_DESCRIPTOR, ((int)Task->nextAvailableFileDescriptor));
+    storeValueAtProtectedMemLoc(CURRENT_FILE_DESCRIPTOR_PTR, (int)requestedBuffer);
+    storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->buffers[Task->nextAvailableFileDescriptor], (int)requestedBuffer);
+    storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->bufferSize[Task->nextAvailableFileDescriptor], (int)GOTE->size);
 
     Task->nextAvailableFileDescriptor++;
 
@@ -350,6 +375,24 @@ void sysPs(uint32_t currentPid)
 
     cursor++;
 
+    uint32_t frameCacheHits = 0;
+    uint32_t frameCacheMisses = 0;
+    frameCacheStats(&frameCacheHits, &frameCacheMisses);
+
+    printString(COLOR_GREEN, cursor, 2, (uint8_t *)"Frame Cache Hits/Misses: ");
+    if (buf)
+    {
+        itoa(frameCacheHits, buf);
+        printString(COLOR_LIGHT_BLUE, cursor, 28, buf);
+    }
+    if (buf)
+    {
+        itoa(frameCacheMisses, buf);
+        printString(COLOR_LIGHT_BLUE, cursor, 35, buf);
+    }
+
+    cursor++;
+
     printString(COLOR_GREEN, cursor, 2, (uint8_t *)"PID Heap Objects: ");
     if (buf)
     {
@@ -613,44 +656,53 @@ void sysExec(struct fileParameter *FileParameter, uint32_t currentPid, uint32_t
     uint8_t *newBinaryFilenameLoc = kMalloc(currentPid, strlen(FileParameter->fileName)); 
     strcpyRemoveNewline(newBinaryFilenameLoc, FileParameter->fileName);
 
+    // EXT2 is searched first so a program in the working directory, or one rebuilt after the image was made,
+    // wins over the archive. The initramfs is only the fallback for a name EXT2 doesn't have.
+    bool inInitramfs = false;
+
+    fsMetadataLock();
+
     if (!fsFindFile(newBinaryFilenameLoc, USER_TEMP_INODE_LOC, cachingEnabled, directoryInode))
     {
         directoryInode = returnInodeofFileName((uint8_t*)"bin", cachingEnabled, ROOTDIR_INODE);
-        
+    
         if (!fsFindFile(newBinaryFilenameLoc, USER_TEMP_INODE_LOC, cachingEnabled, directoryInode))
         {
             directoryInode = returnInodeofFileName((uint8_t*)"code", cachingEnabled, ROOTDIR_INODE);
-        
+    
             if (!fsFindFile(newBinaryFilenameLoc, USER_TEMP_INODE_LOC, cachingEnabled, directoryInode))
             {
                 directoryInode = ROOTDIR_INODE;
-        
+    
                 if (!fsFindFile(newBinaryFilenameLoc, USER_TEMP_INODE_LOC, cachingEnabled, directoryInode))
                 {
-                    printString(COLOR_RED, 2, 5, (uint8_t *)"File not found!");
-                    sysWait();
-                    sysWait();
-                    return;
+                    inInitramfs = initramfsFindFile(newBinaryFilenameLoc, USER_TEMP_INODE_LOC);
+
+                    if (!inInitramfs)
+                    {
+                        fsMetadataUnlock();
+                        printString(COLOR_RED, 2, 5, (uint8_t *)"File not found!");
+                        sysWait();
+                        sysWait();
+                        return;
+                    }
                 }
             }
 
         }
     }
+
+    fsMetadataUnlock();
       
     uint32_t newPid = 0;
 
     newPid = initializeTask(currentPid, PROC_SLEEPING, STACK_START_LOC, newBinaryFilenameLoc, FileParameter->requestedRunPriority, directoryInode, requestedNewPidStdIn, requestedNewPidStdOut, requestedNewPidStdErr);
     initializePageTables(newPid);
+    mapKernelLargePages(newPid);
+    mapZeroPoolWindow(newPid);
 
     contextSwitch(newPid);
 
-    if (!requestSpecificPage(newPid, (uint8_t *)(STACK_PAGE - PAGE_SIZE), PG_USER_PRESENT_RW))
-    {
-        clearScreen();
-        printString(COLOR_RED, 2, 2, (uint8_t *)"Requested page is not available");
-        panic((uint8_t *)"syscalls.cpp -> STACK_PAGE - PAGE_SIZE page request");
-    }
-
     if (!requestSpecificPage(newPid, (uint8_t *)(STACK_PAGE), PG_USER_PRESENT_RW))
     {
         clearScreen();
@@ -658,15 +710,9 @@ void sysExec(struct fileParameter *FileParameter, uint32_t currentPid, uint32_t
         panic((uint8_t *)"syscalls.cpp -> STACK_PAGE page request");
     }
 
-    for (uint32_t userHeapLoc = 0; userHeapLoc < (USER_HEAP_PAGES * PAGE_SIZE); userHeapLoc = userHeapLoc + PAGE_SIZE)
-    {
-        if (!requestSpecificPage(newPid, (uint8_t*)(USER_HEAP + userHeapLoc), PG_USER_PRESENT_RW))
-        {
-            clearScreen();
-            printString(COLOR_RED, 2, 2, (uint8_t *)"Requested page is not available");
-            panic((uint8_t *)"syscalls.cpp -> USER_HEAP page request");
-        }
-    }
+    // The stack's second page and the heap get frames only when the program touches them
+    reserveDemandPages(newPid, (uint8_t *)(STACK_PAGE - PAGE_SIZE), 1);
+    reserveDemandPages(newPid, (uint8_t *)USER_HEAP, USER_HEAP_PAGES);
 
     if (!requestSpecificPage(newPid, USER_TEMP_INODE_LOC, PG_USER_PRESENT_RW))
     {
@@ -678,7 +724,20 @@ void sysExec(struct fileParameter *FileParameter, uint32_t currentPid, uint32_t
     // We do this function twice. First one (above) to make sure the file exists.
     // This second one (below) is because there was a context switch and a different
     // userspace.
-    fsFindFile(newBinaryFilenameLoc, USER_TEMP_INODE_LOC, cachingEnabled, directoryInode);
+    // The exec image cache knows a program by its inode, or by its initramfs entry for the boot time binaries
+    uint32_t execImageKey = 0;
+
+    if (inInitramfs)
+    {
+        initramfsFindFile(newBinaryFilenameLoc, USER_TEMP_INODE_LOC);
+        execImageKey = (uint32_t)initramfsFind(newBinaryFilenameLoc);
+    }
+    else
+    {
+        fsMetadataLock();
+        fsFindFile(newBinaryFilenameLoc, USER_TEMP_INODE_LOC, cachingEnabled, directoryInode);
+        execImageKey = returnInodeofFileName(newBinaryFilenameLoc, cachingEnabled, directoryInode);
+    }
 
     struct inode *Inode = (struct inode*)USER_TEMP_INODE_LOC;
 
@@ -695,7 +754,19 @@ void sysExec(struct fileParameter *FileParameter, uint32_t currentPid, uint32_t
         }
     }
 
-    loadFileFromInodeStruct(USER_TEMP_INODE_LOC, USER_TEMP_FILE_LOC, cachingEnabled); 
+    if (inInitramfs)
+    {
+        // A damaged archive entry fails the ELF check below
+        if (!initramfsLoadFile(newBinaryFilenameLoc, USER_TEMP_FILE_LOC))
+        {
+            storeValueAtMemLoc(USER_TEMP_FILE_LOC, 0);
+        }
+    }
+    else
+    {
+        loadFileFromInodeStruct(USER_TEMP_INODE_LOC, USER_TEMP_FILE_LOC, cachingEnabled); 
+        fsMetadataUnlock();
+    }
 
     if (*(uint32_t *)USER_TEMP_FILE_LOC != MAGIC_ELF)
     {
@@ -720,68 +791,73 @@ void sysExec(struct fileParameter *FileParameter, uint32_t currentPid, uint32_t
 
     struct elfHeader *ELFHeader = (struct elfHeader*)USER_TEMP_FILE_LOC;
 
-    if (ELFHeader->e_flags == ELF_LOAD_DYNAMIC_LIBRARIES)
+    // libc.o is read in once, by the first exec that needs it, and every exec after that maps the same frames
+    if (ELFHeader->e_flags == ELF_LOAD_DYNAMIC_LIBRARIES && !sharedLibraryMap(newPid))
     {
-        for (uint32_t dynamicLibrariesLoc = 0; dynamicLibrariesLoc < ((ceiling(DYNAMIC_LIBRARIES_SIZE, PAGE_SIZE)) * PAGE_SIZE); dynamicLibrariesLoc = dynamicLibrariesLoc + PAGE_SIZE)
-        {
-            if (!requestSpecificPage(newPid, (uint8_t *)(SHARED_LIBRARIES_START_LOC + dynamicLibrariesLoc), PG_USER_PRESENT_RW))
-            {
-                clearScreen();
-                printString(COLOR_RED, 2, 2, (uint8_t *)"Requested page is not available");
-                panic((uint8_t *)"syscalls.cpp -> Allocating dynamic library space requests");
-            }
+        // Only the pages libc.o is copied into get frames, they come zero filled
+        reserveDemandPages(newPid, (uint8_t *)SHARED_LIBRARIES_START_LOC, ceiling(DYNAMIC_LIBRARIES_SIZE, PAGE_SIZE));
 
-            fillMemory((uint8_t *)(SHARED_LIBRARIES_START_LOC + dynamicLibrariesLoc), 0x0, PAGE_SIZE);
-
-        }
+        struct initramfsEntry *LibcEntry = initramfsFind((uint8_t*)"libc.o");
 
-        struct fileParameter *FileParameter = (fileParameter *)kMalloc(currentPid, 200);
+        // Straight from the initramfs into place, otherwise opened from EXT2 and copied
+        if (LibcEntry == 0 || LibcEntry->size > DYNAMIC_LIBRARIES_SIZE || !initramfsLoadFile((uint8_t*)"libc.o", (uint8_t*)SHARED_LIBRARIES_START_LOC))
+        {
+            struct fileParameter *FileParameter = (fileParameter *)kMalloc(currentPid, 200);
 
-        FileParameter->fileName = (uint8_t*)"libc.o\n";
-        FileParameter->fileNameLength = strlen((uint8_t*)"libc.o\n");
+            FileParameter->fileName = (uint8_t*)"libc.o\n";
+            FileParameter->fileNameLength = strlen((uint8_t*)"libc.o\n");
 
-        sysOpen(FileParameter, newPid, directoryInode);
+            sysOpen(FileParameter, newPid, directoryInode);
 
-        uint32_t taskStructLocation = PROCESS_TABLE_LOC + (TASK_STRUCT_SIZE * (newPid - 1));
-        struct task *Task = (struct task*)taskStructLocation;
-        uint8_t* currentFileDescriptorPointer = (uint8_t*)readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR_PTR);
-        uint32_t currentFileDescriptor = readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR);
-        struct globalObjectTableEntry *GlobalObjectTableEntry = (struct globalObjectTableEntry*)(Task->fileDescriptor[currentFileDescriptor]);
+            uint32_t taskStructLocation = PROCESS_TABLE_LOC + (TASK_STRUCT_SIZE * (newPid - 1));
+            struct task *Task = (struct task*)taskStructLocation;
+            uint8_t* currentFileDescriptorPointer = (uint8_t*)readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR_PTR);
+            uint32_t currentFileDescriptor = readValueFromMemLoc(CURRENT_FILE_DESCRIPTOR);
+            struct globalObjectTableEntry *GlobalObjectTableEntry = (struct globalObjectTableEntry*)(Task->fileDescriptor[currentFileDescriptor]);
 
-        bytecpy((uint8_t*)SHARED_LIBRARIES_START_LOC, currentFileDescriptorPointer, GlobalObjectTableEntry->size);
+            bytecpy((uint8_t*)SHARED_LIBRARIES_START_LOC, currentFileDescriptorPointer, GlobalObjectTableEntry->size);
+        }
 
+        sharedLibraryCapture(newPid);
     }
 
 
+    // Another instance's read-only segments are mapped as they are, and only the rest is loaded
+    bool execImageShared = execImageMap(newPid, execImageKey, Inode->i_mtime, Inode->i_size, USER_TEMP_FILE_LOC);
+
     for (int x = 0; x < ELFHeader->e_phnum; x++) 
     {
         struct pHeader *ProgramHeader = (struct pHeader*)((uint32_t)ELFHeader + ELFHeader->e_phoff + (ELFHeader->e_phentsize * x));
 
         if (ProgramHeader->p_type == PT_LOAD) 
         {
-            for (uint32_t tempFileLoc = 0; tempFileLoc < ((ceiling(ProgramHeader->p_memsz, PAGE_SIZE)) * PAGE_SIZE); tempFileLoc = tempFileLoc + PAGE_SIZE)
-            {
-                if (!requestSpecificPage(newPid, (uint8_t *)(ProgramHeader->p_vaddr + tempFileLoc), PG_USER_PRESENT_RW))
-                {
-                    clearScreen();
-                    printString(COLOR_RED, 2, 2, (uint8_t *)"Requested page is not available");
-                    panic((uint8_t *)"syscalls.cpp -> USERPROG TEXT and DATA VADDR page requests");
-                }
-
-            }
+            // loadElfFile() faults in the pages it copies to, and the untouched .bss stays unbacked
+            uint32_t segmentOffset = ProgramHeader->p_vaddr % PAGE_SIZE;
+            reserveDemandPages(newPid, (uint8_t *)ProgramHeader->p_vaddr, ceiling(ProgramHeader->p_memsz + segmentOffset, PAGE_SIZE));
            
         }
     }
     
     loadElfFile(USER_TEMP_FILE_LOC);
 
+    if (!execImageShared)
+    {
+        execImageCapture(newPid, execImageKey, Inode->i_mtime, Inode->i_size, USER_TEMP_FILE_LOC);
+    }
+
+    // init only ever execs the shell, so the boot is over once init's first exec is loaded
+    if (currentPid == 1)
+    {
+        bootTraceSave(cachingEnabled);
+    }
+
     struct elfHeader *ELFHeaderLaunch = (struct elfHeader*)USER_TEMP_FILE_LOC;
 
     updateTaskState(currentPid, PROC_SLEEPING);
     updateTaskState(newPid, PROC_RUNNING);
 
     // Letting the new process know its pid
-    storeValueAtMemLoc(RUNNING_PID_LOC, newPid);
+    storeValueAtProtectedMemLoc(RUNNING_PID_LOC, newPid);
 
     struct globalObjectTableEntry *GlobalObjectTableEntryRequestedStdIn = (struct globalObjectTableEntry*)(requestedNewPidStdIn);
     struct globalObjectTableEntry *GlobalObjectTableEntryRequestedStdOut = (struct globalObjectTableEntry*)(requestedNewPidStdOut);
@@ -794,35 +870,35 @@ void sysExec(struct fileParameter *FileParameter, uint32_t currentPid, uint32_t
 
     if (requestedNewPidStdIn == 0)
     {
-        storeValueAtMemLoc((uint8_t *)&openBufferTable->buffers[0], (uint32_t)GlobalObjectTableEntryTypicalStdIn);
-        storeValueAtMemLoc((uint8_t *)&openBufferTable->bufferSize[0], GlobalObjectTableEntryTypicalStdIn->size);
+        storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->buffers[0], (uint32_t)GlobalObjectTableEntryTypicalStdIn);
+        storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->bufferSize[0], GlobalObjectTableEntryTypicalStdIn->size);
     }
     else
     {
-        storeValueAtMemLoc((uint8_t *)&openBufferTable->buffers[0], (uint32_t)GlobalObjectTableEntryRequestedStdIn->userspaceBuffer);
-        storeValueAtMemLoc((uint8_t *)&openBufferTable->bufferSize[0], (uint32_t)GlobalObjectTableEntryRequestedStdIn->size);
+        storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->buffers[0], (uint32_t)GlobalObjectTableEntryRequestedStdIn->userspaceBuffer);
+        storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->bufferSize[0], (uint32_t)GlobalObjectTableEntryRequestedStdIn->size);
     }
 
     if (requestedNewPidStdOut == 0)
     {
-        storeValueAtMemLoc((uint8_t *)&openBufferTable->buffers[1], (int)GlobalObjectTableEntryTypicalStdOut);
-        storeValueAtMemLoc((uint8_t *)&openBufferTable->bufferSize[1], (int)GlobalObjectTableEntryTypicalStdOut->size);
+        storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->buffers[1], (int)GlobalObjectTableEntryTypicalStdOut);
+        storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->bufferSize[1], (int)GlobalObjectTableEntryTypicalStdOut->size);
     }
     else
     {
-        storeValueAtMemLoc((uint8_t *)&openBufferTable->buffers[1], (uint32_t)GlobalObjectTableEntryRequestedStdOut->userspaceBuffer);
-        storeValueAtMemLoc((uint8_t *)&openBufferTable->bufferSize[1], (uint32_t)GlobalObjectTableEntryRequestedStdOut->size);
+        storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->buffers[1], (uint32_t)GlobalObjectTableEntryRequestedStdOut->userspaceBuffer);
+        storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->bufferSize[1], (uint32_t)GlobalObjectTableEntryRequestedStdOut->size);
     }
 
     if (requestedNewPidStdErr == 0)
     {
-        storeValueAtMemLoc((uint8_t *)&openBufferTable->buffers[2], (uint32_t)GlobalObjectTableEntryTypicalStdErr);
-        storeValueAtMemLoc((uint8_t *)&openBufferTable->bufferSize[2], GlobalObjectTableEntryTypicalStdErr->size);
+        storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->buffers[2], (uint32_t)GlobalObjectTableEntryTypicalStdErr);
+        storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->bufferSize[2], GlobalObjectTableEntryTypicalStdErr->size);
     }
     else
     {
-        storeValueAtMemLoc((uint8_t *)&openBufferTable->buffers[2], (uint32_t)GlobalObjectTableEntryRequestedStdErr->userspaceBuffer);
-        storeValueAtMemLoc((uint8_t *)&openBufferTable->bufferSize[2], (uint32_t)GlobalObjectTableEntryRequestedStdErr->size);
+        storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->buffers[2], (uint32_t)GlobalObjectTableEntryRequestedStdErr->userspaceBuffer);
+        storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->bufferSize[2], (uint32_t)GlobalObjectTableEntryRequestedStdErr->size);
     }
 
     enableInterrupts();
@@ -849,11 +925,15 @@ void sysExit(uint32_t currentPid, uint32_t exitCode)
     struct task *currentTask = (struct task*)currentTaskStructLocation;
     currentTask->exitCode = exitCode;
 
+    // Drops this process's references on shared file pages
+    fileMappingRemoveAll(currentPid);
+    releaseSharedPages(currentPid);
+
     updateTaskState(currentPid, PROC_ZOMBIE);
     updateTaskState(currentTask->ppid, PROC_RUNNING);
 
     // Letting the new process know its pid
-    storeValueAtMemLoc(RUNNING_PID_LOC, (currentTask->ppid));
+    storeValueAtProtectedMemLoc(RUNNING_PID_LOC, (currentTask->ppid));
 
     // Checking the parent's status to make sure it isn't dead before switching back to it
     uint32_t parentTaskStructLocation = PROCESS_TABLE_LOC + (TASK_STRUCT_SIZE * (currentTask->ppid - 1));
@@ -869,6 +949,13 @@ void sysExit(uint32_t currentPid, uint32_t exitCode)
         contextSwitch(0x1);
     }
 
+    // A parent waiting in sysFork() gets the child's pid
+    if (forkedChildPid[currentTask->ppid] == currentPid)
+    {
+        forkedChildPid[currentTask->ppid] = 0;
+        returnedValueFromSyscallFunction = currentPid;
+    }
+
 }
 
 void sysFree(uint32_t currentPid)
@@ -889,10 +976,10 @@ void sysMmap(uint8_t* requestedPage, uint32_t currentPid)
     
         if (returnedSuccessful == 0)
         {
-            storeValueAtMemLoc(RETURNED_MMAP_PAGE_LOC, (uint32_t)0);
+            storeValueAtProtectedMemLoc(RETURNED_MMAP_PAGE_LOC, (uint32_t)0);
         }
 
-        storeValueAtMemLoc(RETURNED_MMAP_PAGE_LOC, (uint32_t)requestedPage);
+        storeValueAtProtectedMemLoc(RETURNED_MMAP_PAGE_LOC, (uint32_t)requestedPage);
     }
     
     if (requestedPage != 0)
@@ -902,12 +989,48 @@ void sysMmap(uint8_t* requestedPage, uint32_t currentPid)
         
         if (returnedSuccessful == 0)
         {
-            storeValueAtMemLoc(RETURNED_MMAP_PAGE_LOC, (uint32_t)0);
+            storeValueAtProtectedMemLoc(RETURNED_MMAP_PAGE_LOC, (uint32_t)0);
         }
 
-        storeValueAtMemLoc(RETURNED_MMAP_PAGE_LOC, (uint32_t)requestedPage);
+        storeValueAtProtectedMemLoc(RETURNED_MMAP_PAGE_LOC, (uint32_t)requestedPage);
+
+    }
+}
+
+uint32_t sysMmapFile(struct mmapParameter *MmapParameter, uint32_t currentPid)
+{
+    insertKernelLog(totalInterruptCount, currentPid, (uint8_t*)"SYSMMAPF", MmapParameter->fileDescriptor, (uint8_t*)"NULL");
+
+    uint32_t taskStructLocation = PROCESS_TABLE_LOC + (TASK_STRUCT_SIZE * (currentPid - 1));
+    struct task *Task = (struct task*)taskStructLocation;
+
+    if (MmapParameter->fileDescriptor >= MAX_FILE_DESCRIPTORS || Task->fileDescriptor[MmapParameter->fileDescriptor] == 0)
+    {
+        return SYSCALL_FAIL;
+    }
+
+    struct globalObjectTableEntry *GOTE = (globalObjectTableEntry *)Task->fileDescriptor[MmapParameter->fileDescriptor];
+
+    if (GOTE->type != GOTE_TYPE_FILE || GOTE->inode == 0)
+    {
+        return SYSCALL_FAIL;
+    }
+
+    uint8_t *mappedAddress = fileMappingCreate(currentPid, GOTE->inode, MmapParameter->fileOffset, MmapParameter->length, MmapParameter->requestedAddress, MmapParameter->requestedPermissions);
 
+    if (mappedAddress == 0)
+    {
+        return SYSCALL_FAIL;
     }
+
+    return (uint32_t)mappedAddress;
+}
+
+uint32_t sysMunmap(uint8_t *mappedAddress, uint32_t currentPid)
+{
+    insertKernelLog(totalInterruptCount, currentPid, (uint8_t*)"SYSMUNMAP", (uint32_t)mappedAddress, (uint8_t*)"NULL");
+
+    return fileMappingRemove(currentPid, mappedAddress);
 }
 
 void sysKill(uint32_t pidToKill)
@@ -987,15 +1110,24 @@ void sysGetInodeForUser(struct fileParameter *FileParameter, uint32_t currentPid
     // Dan O'Malley
     
     fillMemory((uint8_t*)SECTOR_AND_BLOCK_VIEWER_BUF_LOC, 0x0, PAGE_SIZE);
+    fsMetadataLock();
     loadInode(returnInodeofFileName(FileParameter->fileName, cachingEnabled, directoryInode), (uint8_t*)SECTOR_AND_BLOCK_VIEWER_BUF_LOC, cachingEnabled);
-    bytecpy((uint8_t*)REQUESTED_INODE_LOC, (uint8_t*)SECTOR_AND_BLOCK_VIEWER_BUF_LOC, sizeof(inode));
+    fsMetadataUnlock();
+    bytecpyToProtectedMem((uint8_t*)REQUESTED_INODE_LOC, (uint8_t*)SECTOR_AND_BLOCK_VIEWER_BUF_LOC, sizeof(inode));
 }
 
 void sysChangeFileMode(struct fileParameter *FileParameter, uint32_t currentPid, uint32_t directoryInode)
 {
     // Dan O'Malley
     
+    // The directory's entries don't change, only the inode
+    fsLockRead(directoryLock(directoryInode));
+    fsMetadataLock();
+    journalStart(cachingEnabled);
     changeFileMode(FileParameter->fileName, FileParameter->requestedFileMode, currentPid, cachingEnabled, directoryInode);
+    journalStop(cachingEnabled);
+    fsMetadataUnlock();
+    fsUnlockRead(directoryLock(directoryInode));
 }
 
 
@@ -2146,9 +2278,16 @@ void sysSwitchToParent(uint32_t currentPid)
     updateTaskState(currentTask->ppid, PROC_RUNNING);
 
     // Letting the new process know its pid
-    storeValueAtMemLoc(RUNNING_PID_LOC, currentTask->ppid);
+    storeValueAtProtectedMemLoc(RUNNING_PID_LOC, currentTask->ppid);
 
     contextSwitch(currentTask->ppid);
+
+    // A parent waiting in sysFork() gets the child's pid
+    if (forkedChildPid[currentTask->ppid] == currentPid)
+    {
+        forkedChildPid[currentTask->ppid] = 0;
+        returnedValueFromSyscallFunction = currentPid;
+    }
 }
 
 void sysWait()
@@ -2196,15 +2335,12 @@ void sysDirectory(uint32_t currentPid, uint32_t directoryInode)
     struct task *currentTask = (struct task*)currentTaskStructLocation;
 
     uint32_t cursor = 0;
-    uint32_t pos = 0;
-    
-    fillMemory((uint8_t *)KERNEL_WORKING_DIR, 0x0, KERNEL_WORKING_DIR_SIZE);
-    fillMemory((uint8_t *)KERNEL_WORKING_DIR_TEMP_INODE_LOC, 0x0, KERNEL_WORKING_DIR_TEMP_INODE_LOC_SIZE);
-    loadInode(directoryInode, KERNEL_WORKING_DIR_TEMP_INODE_LOC, cachingEnabled);
-    loadFileFromInodeStruct(KERNEL_WORKING_DIR_TEMP_INODE_LOC, KERNEL_WORKING_DIR, cachingEnabled);
+    uint32_t position = 0;
     
-    struct directoryEntry *DirectoryEntry = (directoryEntry*)(KERNEL_WORKING_DIR);
-    struct ext2SuperBlock *Ext2SuperBlock = (ext2SuperBlock*)(SUPERBLOCK_LOC + 0x400); //Seems like superblock data is 0x400 into the block
+    fsLockRead(directoryLock(directoryInode));
+    fsMetadataLock();
+
+    struct ext2SuperBlock *Ext2SuperBlock = (ext2SuperBlock*)(SUPERBLOCK_LOC + EXT2_SUPERBLOCK_OFFSET); // Block SUPERBLOCK is loaded at SUPERBLOCK_LOC
 
     uint8_t* directoryInodeString = kMalloc(currentPid, 20);
 
@@ -2284,51 +2420,45 @@ void sysDirectory(uint32_t currentPid, uint32_t directoryInode)
     uint8_t *fileModifyTimeUnixHour = kMalloc(currentPid, 16);
     uint8_t *fileModifyTimeUnixMin = kMalloc(currentPid, 16);
     uint8_t *fileModifyTimeUnixSec = kMalloc(currentPid, 16);
-    uint8_t *directoryFilename = kMalloc(currentPid, 20);
+    struct directoryListingEntry *Listing = (struct directoryListingEntry *)kMalloc(currentPid, DIRECTORY_LISTING_BATCH * sizeof(directoryListingEntry));
+    uint32_t entriesRead = 0;
 
-    while (pos < (BLOCK_SIZE * 4) && (int)DirectoryEntry->directoryInode != 0)
+    // Each entry comes with its inode, so there is no fsFindFile() and no inode table reload per name
+    while (Listing != 0 && (entriesRead = readDirectoryEntries(directoryInode, &position, Listing, DIRECTORY_LISTING_BATCH, cachingEnabled)) != 0)
     {
-        uint32_t name_len = DirectoryEntry->nameLength;
-        //uint8_t *directoryFilename = kMalloc(currentPid, name_len + 1);
-        if (directoryFilename != 0) {
-            memoryCopy((uint8_t *)DirectoryEntry + 8, directoryFilename, name_len);
-            directoryFilename[name_len] = 0;
-        }
+        for (uint32_t entry = 0; entry < entriesRead; entry++)
+        {
+            struct directoryListingEntry *Entry = &Listing[entry];
 
-        printString(COLOR_WHITE, (cursor++), 2, psVerticalLine);
+            printString(COLOR_WHITE, (cursor++), 2, psVerticalLine);
 
-        fsFindFile(directoryFilename, EXT2_TEMP_INODE_STRUCTS, cachingEnabled, directoryInode);
-        struct inode *Inode = (struct inode*)EXT2_TEMP_INODE_STRUCTS;
+            printHexNumber(COLOR_LIGHT_BLUE, (cursor-1), 4, (uint8_t)Entry->inode);
 
-        printHexNumber(COLOR_LIGHT_BLUE, (cursor-1), 4, (uint8_t)DirectoryEntry->directoryInode);
+            printString(COLOR_LIGHT_BLUE, cursor-1, 8, directoryEntryTypeTranslation((Entry->mode >> 12) & 0x000F));
 
-        printString(COLOR_LIGHT_BLUE, cursor-1, 8, directoryEntryTypeTranslation((Inode->i_mode >> 12) & 0x000F));
+            //Other Permissions
+            printString(COLOR_RED, cursor-1, 14, octalTranslation(((Entry->mode >> 6) & 0b0000000000000111)));
 
-        //Other Permissions
-        printString(COLOR_RED, cursor-1, 14, octalTranslation(((Inode->i_mode >> 6) & 0b0000000000000111)));
+            //Group Permissions
+            printString(COLOR_RED, cursor-1, 20, octalTranslation(((Entry->mode >> 3) & 0b0000000000000111)));
 
-        //Group Permissions
-        printString(COLOR_RED, cursor-1, 20, octalTranslation(((Inode->i_mode >> 3) & 0b0000000000000111)));
+            //User Permissions
+            printString(COLOR_RED, cursor-1, 26, octalTranslation((Entry->mode & 0b0000000000000111)));
 
-        //User Permissions
-        printString(COLOR_RED, cursor-1, 26, octalTranslation((Inode->i_mode & 0b0000000000000111)));
+            if (directoryFileSize != 0) 
+            {
+                itoa(Entry->size, directoryFileSize);
+                printString(COLOR_LIGHT_BLUE, cursor-1, 32, directoryFileSize);
+            }
 
-        if (directoryFileSize != 0) 
-        {
-            itoa(Inode->i_size, directoryFileSize);
-            printString(COLOR_LIGHT_BLUE, cursor-1, 32, directoryFileSize);
-        }
+            printString(COLOR_WHITE, (cursor-1), 40, Entry->name);
 
-        if (directoryFilename != 0) {
-            printString(COLOR_WHITE, (cursor-1), 40, directoryFilename);
+            printString(COLOR_WHITE, (cursor-1), 77, psVerticalLine);
         }
-
-        printString(COLOR_WHITE, (cursor-1), 77, psVerticalLine);
-
-        pos += DirectoryEntry->recLength;
-        DirectoryEntry = (directoryEntry *)((uint32_t)DirectoryEntry + DirectoryEntry->recLength);
     }
 
+    if (Listing != 0) kFree((uint8_t *)Listing);
+
     printString(COLOR_WHITE, cursor, 2, psLowerLeftCorner);
     printString(COLOR_WHITE, cursor, 77, psLowerRightCorner);
 
@@ -2393,7 +2523,6 @@ void sysDirectory(uint32_t currentPid, uint32_t directoryInode)
     if (psUpperRightCorner != 0) kFree(psUpperRightCorner);
     if (psLowerLeftCorner != 0) kFree(psLowerLeftCorner);
     if (psLowerRightCorner != 0) kFree(psLowerRightCorner);
-    if (directoryFilename != 0) kFree(directoryFilename);
     if (directoryFileSize != 0) kFree(directoryFileSize);
     if (fileModifyTimeUnix != 0) kFree(fileModifyTimeUnix);
     if (fileModifyTimeUnixYear != 0) kFree(fileModifyTimeUnixYear);
@@ -2401,6 +2530,9 @@ void sysDirectory(uint32_t currentPid, uint32_t directoryInode)
     if (fileModifyTimeUnixHour != 0) kFree(fileModifyTimeUnixHour);
     if (fileModifyTimeUnixMin != 0) kFree(fileModifyTimeUnixMin);
     if (fileModifyTimeUnixSec != 0) kFree(fileModifyTimeUnixSec);
+
+    fsMetadataUnlock();
+    fsUnlockRead(directoryLock(directoryInode));
 }
 
 
@@ -2557,7 +2689,24 @@ void sysCreate(struct fileParameter *FileParameter, uint32_t currentPid, uint32_
     
     insertKernelLog(totalInterruptCount, currentPid, (uint8_t*)"SYSCREATE", directoryInode ,FileParameter->fileName);
 
-    createFile(FileParameter->fileName, currentPid, FileParameter->fileDescriptor, cachingEnabled, directoryInode);
+    if (tmpfsIsTmpPath(FileParameter->fileName))
+    {
+        tmpfsCreateFromDescriptor(FileParameter->fileName, currentPid, FileParameter->fileDescriptor);
+        return;
+    }
+
+    fsLockWrite(directoryLock(directoryInode));
+    fsMetadataLock();
+    journalStart(cachingEnabled);
+    bool created = createFile(FileParameter->fileName, currentPid, FileParameter->fileDescriptor, cachingEnabled, directoryInode);
+    journalStop(cachingEnabled);
+    fsMetadataUnlock();
+    fsUnlockWrite(directoryLock(directoryInode));
+
+    if (!created)
+    {
+        insertKernelLog(totalInterruptCount, currentPid, (uint8_t*)"SYSCREATE", directoryInode, (uint8_t*)"CREATE FAILED");
+    }
 }
 
 void sysMove(struct fileParameter *FileParameter, uint32_t currentPid, uint32_t directoryInode)
@@ -2566,7 +2715,26 @@ void sysMove(struct fileParameter *FileParameter, uint32_t currentPid, uint32_t
     
     insertKernelLog(totalInterruptCount, currentPid, (uint8_t*)"SYSMOVE", directoryInode ,FileParameter->fileName);
 
+    fsMetadataLock();
+    uint32_t *sourceDirectoryLock = directoryLock(getInodeFromPath(FileParameter->sourceDirectory, cachingEnabled));
+    uint32_t *destinationDirectoryLock = directoryLock(getInodeFromPath(FileParameter->destinationDirectory, cachingEnabled));
+    fsMetadataUnlock();
+
+    // Two directory locks are always taken lowest address first. They may share a bucket.
+    uint32_t *firstDirectoryLock = (sourceDirectoryLock < destinationDirectoryLock) ? sourceDirectoryLock : destinationDirectoryLock;
+    uint32_t *secondDirectoryLock = (sourceDirectoryLock < destinationDirectoryLock) ? destinationDirectoryLock : sourceDirectoryLock;
+
+    fsLockWrite(firstDirectoryLock);
+    if (secondDirectoryLock != firstDirectoryLock) { fsLockWrite(secondDirectoryLock); }
+    fsMetadataLock();
+
+    journalStart(cachingEnabled);
     moveFile(FileParameter->fileName, FileParameter->sourceDirectory, FileParameter->destinationDirectory, cachingEnabled);
+    journalStop(cachingEnabled);
+
+    fsMetadataUnlock();
+    if (secondDirectoryLock != firstDirectoryLock) { fsUnlockWrite(secondDirectoryLock); }
+    fsUnlockWrite(firstDirectoryLock);
 }
 
 void sysDelete(struct fileParameter *FileParameter, uint32_t currentPid, uint32_t directoryInode)
@@ -2575,7 +2743,29 @@ void sysDelete(struct fileParameter *FileParameter, uint32_t currentPid, uint32_
     
     insertKernelLog(totalInterruptCount, currentPid, (uint8_t*)"SYSDELETE",directoryInode , FileParameter->fileName);
 
+    if (tmpfsIsTmpPath(FileParameter->fileName))
+    {
+        tmpfsDelete(FileParameter->fileName);
+        return;
+    }
+
+    fsLockWrite(directoryLock(directoryInode));
+
+    fsMetadataLock();
+    uint32_t fileInode = returnInodeofFileName(FileParameter->fileName, cachingEnabled, directoryInode);
+    fsMetadataUnlock();
+
+    // Reads already in the file finish before its inode is zeroed
+    if (fileInode != 0) { fsLockWrite(inodeLock(fileInode)); }
+
+    fsMetadataLock();
+    journalStart(cachingEnabled);
     deleteFile(FileParameter->fileName, currentPid, cachingEnabled, directoryInode);
+    journalStop(cachingEnabled);
+    fsMetadataUnlock();
+
+    if (fileInode != 0) { fsUnlockWrite(inodeLock(fileInode)); }
+    fsUnlockWrite(directoryLock(directoryInode));
 }
 
 void sysOpenEmpty(struct fileParameter *FileParameter, uint32_t currentPid, uint32_t directoryInode)
@@ -2589,6 +2779,15 @@ void sysOpenEmpty(struct fileParameter *FileParameter, uint32_t currentPid, uint
     uint8_t *newBinaryFilenameLoc = kMalloc(currentPid, FileParameter->fileNameLength);
     strcpyRemoveNewline(newBinaryFilenameLoc, FileParameter->fileName);
 
+    if (tmpfsIsTmpPath(newBinaryFilenameLoc))
+    {
+        if (tmpfsOpen(newBinaryFilenameLoc, currentPid, FileParameter->requestedSizeInPages) == SYSCALL_FAIL)
+        {
+            kFree(newBinaryFilenameLoc);
+        }
+        return;
+    }
+
     uint32_t taskStructLocation = PROCESS_TABLE_LOC + (TASK_STRUCT_SIZE * (currentPid - 1));
     struct task *Task = (struct task*)taskStructLocation;
 
@@ -2601,34 +2800,555 @@ void sysOpenEmpty(struct fileParameter *FileParameter, uint32_t currentPid, uint
 
     uint8_t *requestedBuffer = findBuffer(currentPid, pagesNeedForTmpBinary, PG_USER_PRESENT_RW);
 
-    //request block of pages for temporary file storage to load file based on first available page above
-    for (uint32_t pageCount = 0; pageCount < pagesNeedForTmpBinary; pageCount++)
-    {                
-        if (!requestSpecificPage(currentPid, (uint8_t *)((uint32_t)requestedBuffer + (pageCount * PAGE_SIZE)), PG_USER_PRESENT_RW))
+    // The file buffer's pages come from the zero pool as they are first written, rather than being zeroed here
+    reserveDemandPages(currentPid, requestedBuffer, pagesNeedForTmpBinary);
+
+    Task->fileDescriptor[Task->nextAvailableFileDescriptor] = (globalObjectTableEntry *)insertGlobalObjectTableEntry((uint8_t *)GLOBAL_OBJECT_TABLE, currentPid, 0, GOTE_TYPE_FILE, 0, 0, 0, 0, GOTESize, requestedBuffer, pagesNeedForTmpBinary, 0, newBinaryFilenameLoc, 0, 0, 0);
+    struct globalObjectTableEntry *GOTE = (globalObjectTableEntry *)Task->fileDescriptor[Task->nextAvailableFileDescriptor];
+
+    struct openBufferTable *openBufferTable = (struct openBufferTable*)OPEN_BUFFER_TABLE;
+
+    storeValueAtProtectedMemLoc(CURRENT_FILE_DESCRIPTOR, ((uint32_t)Task->nextAvailableFileDescriptor));
+    storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->buffers[Task->nextAvailableFileDescriptor], (int)requestedBuffer);
+    storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->bufferSize[Task->nextAvailableFileDescriptor], (int)GOTE->size);
+    storeValueAtProtectedMemLoc(CURRENT_FILE_DESCRIPTOR_PTR, (uint32_t)requestedBuffer);
+
+    fsLockWrite(directoryLock(directoryInode));
+    fsMetadataLock();
+    journalStart(cachingEnabled);
+    bool created = createFile(newBinaryFilenameLoc, currentPid, Task->nextAvailableFileDescriptor, cachingEnabled, directoryInode);
+    journalStop(cachingEnabled);
+    fsMetadataUnlock();
+    fsUnlockWrite(directoryLock(directoryInode));
+
+    if (!created)
+    {
+        insertKernelLog(totalInterruptCount, currentPid, (uint8_t*)"SYSOPNEMPTY", directoryInode, (uint8_t*)"CREATE FAILED");
+    }
+
+    //sysClose(Task->nextAvailableFileDescriptor, currentPid);
+
+}
+
+void sysSync(uint32_t currentPid)
+{
+    insertKernelLog(totalInterruptCount, currentPid, (uint8_t*)"SYSSYNC", 0, (uint8_t*)"NULL");
+
+    journalCommit(cachingEnabled);
+    diskFlushCache(0, cachingEnabled);
+}
+
+uint32_t sysFsync(uint32_t fileDescriptor, uint32_t currentPid)
+{
+    insertKernelLog(totalInterruptCount, currentPid, (uint8_t*)"SYSFSYNC", fileDescriptor, (uint8_t*)"NULL");
+
+    uint32_t taskStructLocation = PROCESS_TABLE_LOC + (TASK_STRUCT_SIZE * (currentPid - 1));
+    struct task *Task = (struct task*)taskStructLocation;
+
+    if (fileDescriptor >= MAX_FILE_DESCRIPTORS || Task->fileDescriptor[fileDescriptor] == 0)
+    {
+        return SYSCALL_FAIL;
+    }
+
+    struct globalObjectTableEntry *GOTE = (globalObjectTableEntry *)Task->fileDescriptor[fileDescriptor];
+
+    if (GOTE->type != GOTE_TYPE_FILE || GOTE->inode == 0)
+    {
+        return SYSCALL_FAIL;
+    }
+
+    // The file's inode and directory entry may still be in the running transaction
+    journalCommit(cachingEnabled);
+
+    uint8_t *inodeBuf = kMalloc(currentPid, INODE_SIZE);
+
+    fsLockRead(inodeLock(GOTE->inode));
+    fsMetadataLock();
+
+    loadInode(GOTE->inode, inodeBuf, cachingEnabled);
+    struct inode *Inode = (struct inode *)inodeBuf;
+
+    for (uint32_t x = 0; x < EXT2_NUMBER_OF_DIRECT_BLOCKS; x++)
+    {
+        if (Inode->i_block[x] != 0)
         {
-            clearScreen();
-            printString(COLOR_RED, 2, 2, (uint8_t *)"Requested page is not available");
-            panic((uint8_t *)"syscalls.cpp -> USER_TEMP_FILE_LOC page request");
+            diskFlushBlock(Inode->i_block[x], cachingEnabled);
         }
+    }
 
-        // Zero each page in case it has been used previously
-        fillMemory((uint8_t *)((uint32_t)requestedBuffer + (pageCount * PAGE_SIZE)), 0x0, PAGE_SIZE);
+    if (Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK] != 0)
+    {
+        readBlock(Inode->i_block[EXT2_FIRST_INDIRECT_BLOCK], EXT2_INDIRECT_BLOCK, cachingEnabled);
+        uint32_t *indirectBlock = (uint32_t *)EXT2_INDIRECT_BLOCK;
+
+        for (uint32_t y = 0; y < EXT2_BLOCKS_PER_INDIRECT_BLOCK; y++)
+        {
+            if (indirectBlock[y] != 0)
+            {
+                diskFlushBlock(indirectBlock[y], cachingEnabled);
+            }
+        }
     }
 
-    Task->fileDescriptor[Task->nextAvailableFileDescriptor] = (globalObjectTableEntry *)insertGlobalObjectTableEntry((uint8_t *)GLOBAL_OBJECT_TABLE, currentPid, 0, GOTE_TYPE_FILE, 0, 0, 0, 0, GOTESize, requestedBuffer, pagesNeedForTmpBinary, 0, newBinaryFilenameLoc, 0, 0, 0);
-    struct globalObjectTableEntry *GOTE = (globalObjectTableEntry *)Task->fileDescriptor[Task->nextAvailableFileDescriptor];
+    fsMetadataUnlock();
+    fsUnlockRead(inodeLock(GOTE->inode));
+
+    kFree(inodeBuf);
+
+    return SYSCALL_SUCCESS;
+}
+
+uint32_t sysOpenStream(struct fileParameter *FileParameter, uint32_t currentPid, uint32_t directoryInode)
+{
+    insertKernelLog(totalInterruptCount, currentPid, (uint8_t*)"SYSOSTRM", FileParameter->fileDescriptor, FileParameter->fileName);
+
+    uint32_t taskStructLocation = PROCESS_TABLE_LOC + (TASK_STRUCT_SIZE * (currentPid - 1));
+    struct task *Task = (struct task*)taskStructLocation;
+
+    if (Task->nextAvailableFileDescriptor >= MAX_FILE_DESCRIPTORS)
+    {
+        return SYSCALL_FAIL; // reached the max open files
+    }
+
+    uint8_t *fileName = kMalloc(currentPid, FileParameter->fileNameLength);
+    strcpyRemoveNewline(fileName, FileParameter->fileName);
+
+    fsMetadataLock();
+
+    // Same search order as sysOpen()
+    uint32_t codeDirectoryInode = returnInodeofFileName((uint8_t*)"code", cachingEnabled, ROOTDIR_INODE);
+    uint32_t inodeNumber = returnInodeofFileName(fileName, cachingEnabled, directoryInode);
+
+    if (inodeNumber == 0)
+    {
+        inodeNumber = returnInodeofFileName(fileName, cachingEnabled, ROOTDIR_INODE);
+    }
+
+    if (inodeNumber == 0 && codeDirectoryInode != 0)
+    {
+        inodeNumber = returnInodeofFileName(fileName, cachingEnabled, codeDirectoryInode);
+    }
+
+    if (inodeNumber == 0)
+    {
+        fsMetadataUnlock();
+        kFree(fileName);
+        return SYSCALL_FAIL;
+    }
+
+    if (FileParameter->requestedPermissions == RDWRITE && !fileAvailableToBeLocked((uint8_t *)GLOBAL_OBJECT_TABLE, inodeNumber))
+    {
+        fsMetadataUnlock();
+        kFree(fileName);
+        return SYSCALL_FAIL;
+    }
+
+    uint8_t *inodeBuf = kMalloc(currentPid, INODE_SIZE);
+    loadInode(inodeNumber, inodeBuf, cachingEnabled);
+    uint32_t fileSize = ((struct inode *)inodeBuf)->i_size;
+    kFree(inodeBuf);
+
+    fsMetadataUnlock();
+
+    Task->fileDescriptor[Task->nextAvailableFileDescriptor] = (globalObjectTableEntry *)insertGlobalObjectTableEntry((uint8_t *)GLOBAL_OBJECT_TABLE, currentPid, inodeNumber, GOTE_TYPE_FILE, 0, 0, 0, 0, fileSize, 0, 0, 0, fileName, 0, 0, 0);
+
+    if (FileParameter->requestedPermissions == RDWRITE)
+    {
+        lockFile((uint8_t *)GLOBAL_OBJECT_TABLE, currentPid, inodeNumber);
+    }
 
     struct openBufferTable *openBufferTable = (struct openBufferTable*)OPEN_BUFFER_TABLE;
 
-    storeValueAtMemLoc(CURRENT_FILE_DESCRIPTOR, ((uint32_t)Task->nextAvailableFileDescriptor));
-    storeValueAtMemLoc((uint8_t *)&openBufferTable->buffers[Task->nextAvailableFileDescriptor], (int)requestedBuffer);
-    storeValueAtMemLoc((uint8_t *)&openBufferTable->bufferSize[Task->nextAvailableFileDescriptor], (int)GOTE->size);
-    storeValueAtMemLoc(CURRENT_FILE_DESCRIPTOR_PTR, (uint32_t)requestedBuffer);
+    storeValueAtProtectedMemLoc(CURRENT_FILE_DESCRIPTOR, ((uint32_t)Task->nextAvailableFileDescriptor));
+    storeValueAtProtectedMemLoc(CURRENT_FILE_DESCRIPTOR_PTR, 0);
+    storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->buffers[Task->nextAvailableFileDescriptor], 0);
+    storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->bufferSize[Task->nextAvailableFileDescriptor], fileSize);
 
-    createFile(newBinaryFilenameLoc, currentPid, Task->nextAvailableFileDescriptor, cachingEnabled, directoryInode);
+    Task->nextAvailableFileDescriptor++;
 
-    //sysClose(Task->nextAvailableFileDescriptor, currentPid);
+    return SYSCALL_SUCCESS;
+}
+
+bool userSpaceRangeValid(uint8_t *userAddress, uint32_t length)
+{
+    // Written so that a huge length can't wrap the end of the range back around below the limit
+    return (uint32_t)userAddress <= USER_SPACE_LIMIT && length <= ((USER_SPACE_LIMIT + 1) - (uint32_t)userAddress);
+}
+
+uint32_t sysReadFile(struct ioParameter *IoParameter, uint32_t currentPid)
+{
+    insertKernelLog(totalInterruptCount, currentPid, (uint8_t*)"SYSREADF", IoParameter->fileDescriptor, (uint8_t*)"NULL");
+
+    uint32_t taskStructLocation = PROCESS_TABLE_LOC + (TASK_STRUCT_SIZE * (currentPid - 1));
+    struct task *Task = (struct task*)taskStructLocation;
+
+    if (IoParameter->fileDescriptor >= MAX_FILE_DESCRIPTORS || Task->fileDescriptor[IoParameter->fileDescriptor] == 0)
+    {
+        return SYSCALL_FAIL;
+    }
+
+    struct globalObjectTableEntry *GOTE = (globalObjectTableEntry *)Task->fileDescriptor[IoParameter->fileDescriptor];
+
+    // readFileAtOffset() copies in kernel mode, so a buffer in kernel memory would be overwritten
+    if (GOTE->type != GOTE_TYPE_FILE || GOTE->inode == 0 || !userSpaceRangeValid(IoParameter->buffer, IoParameter->length))
+    {
+        return SYSCALL_FAIL;
+    }
+
+    // Readers of different files, or of the same file, never wait on each other
+    fsLockRead(inodeLock(GOTE->inode));
+    uint32_t bytesRead = readFileAtOffset(GOTE->inode, GOTE->readOffset, IoParameter->buffer, IoParameter->length, cachingEnabled);
+    fsUnlockRead(inodeLock(GOTE->inode));
+    GOTE->readOffset = GOTE->readOffset + bytesRead;
+
+    return bytesRead;
+}
+
+uint32_t sysWriteFile(struct ioParameter *IoParameter, uint32_t currentPid)
+{
+    insertKernelLog(totalInterruptCount, currentPid, (uint8_t*)"SYSWRITF", IoParameter->fileDescriptor, (uint8_t*)"NULL");
+
+    uint32_t taskStructLocation = PROCESS_TABLE_LOC + (TASK_STRUCT_SIZE * (currentPid - 1));
+    struct task *Task = (struct task*)taskStructLocation;
+
+    if (IoParameter->fileDescriptor >= MAX_FILE_DESCRIPTORS || Task->fileDescriptor[IoParameter->fileDescriptor] == 0)
+    {
+        return SYSCALL_FAIL;
+    }
+
+    struct globalObjectTableEntry *GOTE = (globalObjectTableEntry *)Task->fileDescriptor[IoParameter->fileDescriptor];
+
+    // Otherwise kernel memory could be written into the file and read back out
+    if (GOTE->type != GOTE_TYPE_FILE || GOTE->inode == 0 || GOTE->lockedForWriting != currentPid || !userSpaceRangeValid(IoParameter->buffer, IoParameter->length))
+    {
+        return SYSCALL_FAIL;
+    }
 
+    // Block allocation and the inode update go through the shared bitmap and inode table buffers
+    fsLockWrite(inodeLock(GOTE->inode));
+    fsMetadataLock();
+    journalStart(cachingEnabled);
+    uint32_t bytesWritten = writeFileAtOffset(GOTE->inode, GOTE->writeOffset, IoParameter->buffer, IoParameter->length, cachingEnabled);
+    journalStop(cachingEnabled);
+    fsMetadataUnlock();
+    fsUnlockWrite(inodeLock(GOTE->inode));
+
+    GOTE->writeOffset = GOTE->writeOffset + bytesWritten;
+
+    if (GOTE->writeOffset > GOTE->size)
+    {
+        GOTE->size = GOTE->writeOffset;
+    }
+
+    return bytesWritten;
+}
+
+uint32_t sysLseek(struct ioParameter *IoParameter, uint32_t currentPid)
+{
+    uint32_t taskStructLocation = PROCESS_TABLE_LOC + (TASK_STRUCT_SIZE * (currentPid - 1));
+    struct task *Task = (struct task*)taskStructLocation;
+
+    if (IoParameter->fileDescriptor >= MAX_FILE_DESCRIPTORS || Task->fileDescriptor[IoParameter->fileDescriptor] == 0)
+    {
+        return SYSCALL_FAIL;
+    }
+
+    struct globalObjectTableEntry *GOTE = (globalObjectTableEntry *)Task->fileDescriptor[IoParameter->fileDescriptor];
+
+    if (GOTE->type != GOTE_TYPE_FILE || GOTE->inode == 0)
+    {
+        return SYSCALL_FAIL;
+    }
+
+    int newOffset = IoParameter->offset;
+
+    if (IoParameter->whence == SEEK_CUR)
+    {
+        // A descriptor that can write moves with its writes, any other only with its reads
+        uint32_t currentOffset = (GOTE->lockedForWriting == currentPid) ? GOTE->writeOffset : GOTE->readOffset;
+        newOffset = (int)currentOffset + IoParameter->offset;
+    }
+    else if (IoParameter->whence == SEEK_END)
+    {
+        uint8_t inodeBuf[INODE_SIZE];
+
+        // loadInode() goes through KERNEL_TEMP_INODE_LOC, which a writer holding fsMetadataLock() may be using
+        fsLockRead(inodeLock(GOTE->inode));
+        uint8_t *blockBuffer = fileIOScratchAcquire();
+        loadInodeUsingBuffer(GOTE->inode, inodeBuf, blockBuffer, cachingEnabled);
+        fileIOScratchRelease(blockBuffer);
+        fsUnlockRead(inodeLock(GOTE->inode));
+
+        newOffset = (int)((struct inode *)inodeBuf)->i_size + IoParameter->offset;
+    }
+    else if (IoParameter->whence != SEEK_SET)
+    {
+        return SYSCALL_FAIL;
+    }
+
+    if (newOffset < 0)
+    {
+        return SYSCALL_FAIL;
+    }
+
+    // Seeking past the end is allowed, a later write leaves a hole that reads back as zeros
+    GOTE->readOffset = (uint32_t)newOffset;
+    GOTE->writeOffset = (uint32_t)newOffset;
+
+    return (uint32_t)newOffset;
+}
+
+uint32_t sysSendfile(struct sendfileParameter *SendfileParameter, uint32_t currentPid)
+{
+    insertKernelLog(totalInterruptCount, currentPid, (uint8_t*)"SYSSENDF", SendfileParameter->fileDescriptor, (uint8_t*)"NULL");
+
+    uint32_t taskStructLocation = PROCESS_TABLE_LOC + (TASK_STRUCT_SIZE * (currentPid - 1));
+    struct task *Task = (struct task*)taskStructLocation;
+
+    if (SendfileParameter->fileDescriptor >= MAX_FILE_DESCRIPTORS || Task->fileDescriptor[SendfileParameter->fileDescriptor] == 0 ||
+        SendfileParameter->socketDescriptor >= MAX_FILE_DESCRIPTORS || Task->fileDescriptor[SendfileParameter->socketDescriptor] == 0)
+    {
+        return SYSCALL_FAIL;
+    }
+
+    struct globalObjectTableEntry *FileGOTE = (globalObjectTableEntry *)Task->fileDescriptor[SendfileParameter->fileDescriptor];
+    struct globalObjectTableEntry *SocketGOTE = (globalObjectTableEntry *)Task->fileDescriptor[SendfileParameter->socketDescriptor];
+
+    if (FileGOTE->type != GOTE_TYPE_FILE || FileGOTE->inode == 0 || SocketGOTE->type != GOTE_TYPE_SOCKET)
+    {
+        return SYSCALL_FAIL;
+    }
+
+    uint8_t inodeBuf[INODE_SIZE];
+    struct inode *Inode = (struct inode *)inodeBuf;
+
+    // A reader like sysReadFile(), with its own scratch
+    fsLockRead(inodeLock(FileGOTE->inode));
+    uint8_t *blockBuffer = fileIOScratchAcquire();
+    uint8_t *indirectBlockBuffer = blockBuffer + BLOCK_SIZE;
+
+    loadInodeUsingBuffer(FileGOTE->inode, inodeBuf, blockBuffer + (BLOCK_SIZE * 2), cachingEnabled);
+
+    uint32_t offset = SendfileParameter->offset;
+    uint32_t length = SendfileParameter->length;
+
+    if (offset >= Inode->i_size)
+    {
+        fileIOScratchRelease(blockBuffer);
+        fsUnlockRead(inodeLock(FileGOTE->inode));
+        return 0; // EOF
+    }
+
+    if (length > (Inode->i_size - offset))
+    {
+        length = Inode->i_size - offset;
+    }
+
+    struct networkParameter NetworkParameter;
+    NetworkParameter.destinationIPAddress = SocketGOTE->destinationIPAddress;
+    NetworkParameter.destinationPort = SocketGOTE->destinationPort;
+    NetworkParameter.packetPayload = 0;
+    NetworkParameter.socketName = SocketGOTE->name;
+    NetworkParameter.sourceIPAddress = SocketGOTE->sourceIPAddress;
+    NetworkParameter.sourcePort = SocketGOTE->sourcePort;
+
+    // Each block comes out of the sector cache into the scratch block buffer and the packets are
+    // cut directly out of that buffer, so the data is never staged in a user buffer or a packet buffer.
+    uint32_t bytesSent = 0;
+    uint32_t lastFileBlock = 0xFFFFFFFF;
+
+    while (bytesSent < length)
+    {
+        uint32_t position = offset + bytesSent;
+        uint32_t fileBlock = position / BLOCK_SIZE;
+        uint32_t blockOffset = position % BLOCK_SIZE;
+        uint32_t bytesThisPacket = BLOCK_SIZE - blockOffset;
+
+        if (bytesThisPacket > (length - bytesSent))
+        {
+            bytesThisPacket = length - bytesSent;
+        }
+
+        if (bytesThisPacket > MAX_UDP_PAYLOAD_LEN)
+        {
+            bytesThisPacket = MAX_UDP_PAYLOAD_LEN;
+        }
+
+        if (fileBlock != lastFileBlock)
+        {
+            uint32_t diskBlock = fileBlockToDiskBlock(Inode, fileBlock, indirectBlockBuffer, cachingEnabled);
+
+            // A hole reads back as zeros
+            if (diskBlock == 0)
+            {
+                fillMemory(blockBuffer, 0x0, BLOCK_SIZE);
+            }
+            else
+            {
+                readBlock(diskBlock, blockBuffer, cachingEnabled);
+            }
+
+            lastFileBlock = fileBlock;
+        }
+
+        while (!acquireLock(KERNEL_OWNED, (uint8_t *)GLOBAL_OBJECT_TABLE)) {}
+
+        bool sent = netUDPSendPayload(&NetworkParameter, blockBuffer + blockOffset, bytesThisPacket);
+
+        if (sent)
+        {
+            SocketGOTE->packetsTransmitted++;
+        }
+
+        releaseLock(KERNEL_OWNED, (uint8_t *)GLOBAL_OBJECT_TABLE);
+
+        if (!sent)
+        {
+            break;
+        }
+
+        bytesSent = bytesSent + bytesThisPacket;
+    }
+
+    fileIOScratchRelease(blockBuffer);
+    fsUnlockRead(inodeLock(FileGOTE->inode));
+
+    return bytesSent;
+}
+
+uint32_t sysFsCheck(struct fsCheckParameter *FsCheckParameter, uint32_t currentPid)
+{
+    // fsCheck() fills the report in kernel mode, so a pointer into kernel memory would be overwritten
+    if (!userSpaceRangeValid((uint8_t *)FsCheckParameter, sizeof(fsCheckParameter)) || FsCheckParameter->report == 0
+        || !userSpaceRangeValid((uint8_t *)FsCheckParameter->report, sizeof(fsCheckReport)))
+    {
+        return SYSCALL_FAIL;
+    }
+
+    insertKernelLog(totalInterruptCount, currentPid, (uint8_t*)"SYSFSCK", FsCheckParameter->repair, (uint8_t*)"NULL");
+
+    return fsCheck(FsCheckParameter->report, FsCheckParameter->repair != 0, cachingEnabled);
+}
+
+uint32_t sysGetDirectoryEntries(struct directoryListingParameter *DirectoryListingParameter, uint32_t currentPid, uint32_t directoryInode)
+{
+    insertKernelLog(totalInterruptCount, currentPid, (uint8_t*)"SYSDENTS", DirectoryListingParameter->position, (uint8_t*)"NULL");
+
+    // readDirectoryEntries() copies through these in kernel mode, so a pointer into kernel memory would be
+    // overwritten. maxEntries is bounded first so the size of the array can't wrap.
+    if (!userSpaceRangeValid((uint8_t *)DirectoryListingParameter, sizeof(directoryListingParameter)) || DirectoryListingParameter->entries == 0
+        || DirectoryListingParameter->maxEntries > ((USER_SPACE_LIMIT + 1) / sizeof(directoryListingEntry))
+        || !userSpaceRangeValid((uint8_t *)DirectoryListingParameter->entries, DirectoryListingParameter->maxEntries * sizeof(directoryListingEntry)))
+    {
+        return SYSCALL_FAIL;
+    }
+
+    if (DirectoryListingParameter->directoryName != 0 && (!userSpaceRangeValid(DirectoryListingParameter->directoryName, 1)
+        || !userSpaceRangeValid(DirectoryListingParameter->directoryName, strlen(DirectoryListingParameter->directoryName) + 1)))
+    {
+        return SYSCALL_FAIL;
+    }
+
+    uint32_t listedDirectoryInode = directoryInode;
+
+    if (DirectoryListingParameter->directoryName != 0)
+    {
+        fsLockRead(directoryLock(directoryInode));
+        fsMetadataLock();
+        listedDirectoryInode = returnInodeofFileName(DirectoryListingParameter->directoryName, cachingEnabled, directoryInode);
+        fsMetadataUnlock();
+        fsUnlockRead(directoryLock(directoryInode));
+
+        if (listedDirectoryInode == 0)
+        {
+            return SYSCALL_FAIL;
+        }
+    }
+
+    fsLockRead(directoryLock(listedDirectoryInode));
+    uint32_t entriesRead = readDirectoryEntries(listedDirectoryInode, &DirectoryListingParameter->position, DirectoryListingParameter->entries,
+        DirectoryListingParameter->maxEntries, cachingEnabled);
+    fsUnlockRead(directoryLock(listedDirectoryInode));
+
+    return entriesRead;
+}
+
+uint32_t sysFork(uint32_t currentPid, uint32_t directoryInode)
+{
+    insertKernelLog(totalInterruptCount, currentPid, (uint8_t*)"SYSFORK", 0, (uint8_t*)"NULL");
+
+    uint32_t parentTaskStructLocation = PROCESS_TABLE_LOC + (TASK_STRUCT_SIZE * (currentPid - 1));
+    struct task *Parent = (struct task*)parentTaskStructLocation;
+
+    // Only stdin, stdout and stderr carry over. The rest of the descriptors belong to the parent.
+    uint32_t newPid = initializeTask(currentPid, PROC_SLEEPING, Parent->stack, Parent->binaryName, Parent->priority, directoryInode, (uint32_t)Parent->fileDescriptor[0], (uint32_t)Parent->fileDescriptor[1], (uint32_t)Parent->fileDescriptor[2]);
+    initializePageTables(newPid);
+    mapKernelLargePages(newPid);
+    mapZeroPoolWindow(newPid);
+
+    forkAddressSpace(currentPid, newPid);
+    fileMappingUnshare(currentPid, newPid);
+
+    uint32_t childTaskStructLocation = PROCESS_TABLE_LOC + (TASK_STRUCT_SIZE * (newPid - 1));
+    struct task *Child = (struct task*)childTaskStructLocation;
+
+    // The child picks up where the parent made the syscall
+    bytecpy((uint8_t *)&Child->eip, (uint8_t *)&Parent->eip, (uint32_t)((uint8_t *)&Parent->ldt - (uint8_t *)&Parent->eip));
+
+    // The child runs first. The parent gets the child's pid back when the child exits or switches to it.
+    updateTaskState(currentPid, PROC_SLEEPING);
+    updateTaskState(newPid, PROC_RUNNING);
+
+    // Letting the new process know its pid
+    storeValueAtProtectedMemLoc(RUNNING_PID_LOC, newPid);
+
+    forkedChildPid[currentPid] = newPid;
+
+    contextSwitch(newPid);
+
+    return 0;
+}
+
+uint32_t sysFsDefrag(struct fsDefragParameter *FsDefragParameter, uint32_t currentPid, uint32_t directoryInode)
+{
+    // fsDefragFile() fills the report and the lookup reads the name in kernel mode, so both must be the caller's own memory
+    if (!userSpaceRangeValid((uint8_t *)FsDefragParameter, sizeof(fsDefragParameter)) || FsDefragParameter->report == 0
+        || !userSpaceRangeValid((uint8_t *)FsDefragParameter->report, sizeof(fsDefragReport)))
+    {
+        return SYSCALL_FAIL;
+    }
+
+    if (FsDefragParameter->fileName != 0 && (!userSpaceRangeValid(FsDefragParameter->fileName, 1)
+        || !userSpaceRangeValid(FsDefragParameter->fileName, strlen(FsDefragParameter->fileName) + 1)))
+    {
+        return SYSCALL_FAIL;
+    }
+
+    insertKernelLog(totalInterruptCount, currentPid, (uint8_t*)"SYSDEFRG", FsDefragParameter->inodeNumber, (uint8_t*)"NULL");
+
+    if (FsDefragParameter->fileName != 0)
+    {
+        fsLockRead(directoryLock(directoryInode));
+        fsMetadataLock();
+        FsDefragParameter->inodeNumber = returnInodeofFileName(FsDefragParameter->fileName, cachingEnabled, directoryInode);
+        fsMetadataUnlock();
+        fsUnlockRead(directoryLock(directoryInode));
+
+        return fsDefragFile(FsDefragParameter->inodeNumber, FsDefragParameter->report, cachingEnabled) ? SYSCALL_SUCCESS : SYSCALL_FAIL;
+    }
+
+    for (uint32_t inodeNumber = FsDefragParameter->inodeNumber; inodeNumber <= EXT2_INODE_COUNT; inodeNumber++)
+    {
+        // The bitmap is only a hint here, fsDefragFile() checks again under the lock
+        if (inodeNumber >= EXT2_FIRST_INODE && bitmapTest((uint8_t *)EXT2_INODE_USAGE_MAP, inodeNumber - 1)
+            && fsDefragFile(inodeNumber, FsDefragParameter->report, cachingEnabled))
+        {
+            FsDefragParameter->inodeNumber = inodeNumber;
+            return SYSCALL_SUCCESS;
+        }
+    }
+
+    return SYSCALL_FAIL;
 }
 
 void sysCreatePipe(struct fileParameter *FileParameter, uint32_t currentPid) 
@@ -2660,10 +3380,10 @@ void sysCreatePipe(struct fileParameter *FileParameter, uint32_t currentPid)
     Task->fileDescriptor[Task->nextAvailableFileDescriptor] = (globalObjectTableEntry *)insertGlobalObjectTableEntry((uint8_t *)GLOBAL_OBJECT_TABLE, currentPid, 0, GOTE_TYPE_PIPE, 0, 0, 0, 0, PIPE_BUF_SIZE, requestedBuffer, 1, kBufferAssigned, pipeName, 0, 0, currentPid);
     struct globalObjectTableEntry *GOTE = (globalObjectTableEntry *)Task->fileDescriptor[Task->nextAvailableFileDescriptor];
     
-    storeValueAtMemLoc((uint8_t *)&openBufferTable->buffers[Task->nextAvailableFileDescriptor], (uint32_t)requestedBuffer);
-    storeValueAtMemLoc((uint8_t *)&openBufferTable->bufferSize[Task->nextAvailableFileDescriptor], (uint32_t)GOTE->size);
-    storeValueAtMemLoc(CURRENT_FILE_DESCRIPTOR, ((uint32_t)Task->nextAvailableFileDescriptor));
-    storeValueAtMemLoc(CURRENT_FILE_DESCRIPTOR_PTR, (uint32_t)requestedBuffer);
+    storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->buffers[Task->nextAvailableFileDescriptor], (uint32_t)requestedBuffer);
+    storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->bufferSize[Task->nextAvailableFileDescriptor], (uint32_t)GOTE->size);
+    storeValueAtProtectedMemLoc(CURRENT_FILE_DESCRIPTOR, ((uint32_t)Task->nextAvailableFileDescriptor));
+    storeValueAtProtectedMemLoc(CURRENT_FILE_DESCRIPTOR_PTR, (uint32_t)requestedBuffer);
     
     Task->nextAvailableFileDescriptor++;
 }
@@ -2698,10 +3418,10 @@ void sysCreateNetworkPipe(struct networkParameter *NetworkParameter, uint32_t cu
     Task->fileDescriptor[Task->nextAvailableFileDescriptor] = (globalObjectTableEntry *)insertGlobalObjectTableEntry((uint8_t *)GLOBAL_OBJECT_TABLE, currentPid, 0, GOTE_TYPE_SOCKET, NetworkParameter->sourceIPAddress, NetworkParameter->destinationIPAddress, NetworkParameter->sourcePort, NetworkParameter->destinationPort, PIPE_BUF_SIZE, requestedBuffer, 1, kBufferAssigned, socketName, 0, 0, currentPid);
     struct globalObjectTableEntry *GOTE = (globalObjectTableEntry *)Task->fileDescriptor[Task->nextAvailableFileDescriptor];
     
-    storeValueAtMemLoc((uint8_t *)&openBufferTable->buffers[Task->nextAvailableFileDescriptor], (uint32_t)requestedBuffer);
-    storeValueAtMemLoc((uint8_t *)&openBufferTable->bufferSize[Task->nextAvailableFileDescriptor], (uint32_t)GOTE->size);
-    storeValueAtMemLoc(CURRENT_FILE_DESCRIPTOR, ((uint32_t)Task->nextAvailableFileDescriptor));
-    storeValueAtMemLoc(CURRENT_FILE_DESCRIPTOR_PTR, (uint32_t)requestedBuffer);
+    storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->buffers[Task->nextAvailableFileDescriptor], (uint32_t)requestedBuffer);
+    storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->bufferSize[Task->nextAvailableFileDescriptor], (uint32_t)GOTE->size);
+    storeValueAtProtectedMemLoc(CURRENT_FILE_DESCRIPTOR, ((uint32_t)Task->nextAvailableFileDescriptor));
+    storeValueAtProtectedMemLoc(CURRENT_FILE_DESCRIPTOR_PTR, (uint32_t)requestedBuffer);
     
     Task->nextAvailableFileDescriptor++;
 }
@@ -2760,10 +3480,10 @@ uint32_t sysOpenPipe(struct fileParameter *FileParameter, uint32_t currentPid)
     Task->fileDescriptor[Task->nextAvailableFileDescriptor] = (globalObjectTableEntry *)GlobalObjectTableEntry;
     struct globalObjectTableEntry *GOTE = (globalObjectTableEntry *)Task->fileDescriptor[Task->nextAvailableFileDescriptor];
     
-    storeValueAtMemLoc((uint8_t *)&openBufferTable->buffers[Task->nextAvailableFileDescriptor], (uint32_t)requestedBuffer);
-    storeValueAtMemLoc((uint8_t *)&openBufferTable->bufferSize[Task->nextAvailableFileDescriptor], (uint32_t)GOTE->size);
-    storeValueAtMemLoc(CURRENT_FILE_DESCRIPTOR, ((uint32_t)Task->nextAvailableFileDescriptor));
-    storeValueAtMemLoc(CURRENT_FILE_DESCRIPTOR_PTR, (uint32_t)requestedBuffer);
+    storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->buffers[Task->nextAvailableFileDescriptor], (uint32_t)requestedBuffer);
+    storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->bufferSize[Task->nextAvailableFileDescriptor], (uint32_t)GOTE->size);
+    storeValueAtProtectedMemLoc(CURRENT_FILE_DESCRIPTOR, ((uint32_t)Task->nextAvailableFileDescriptor));
+    storeValueAtProtectedMemLoc(CURRENT_FILE_DESCRIPTOR_PTR, (uint32_t)requestedBuffer);
 
     Task->nextAvailableFileDescriptor++;
 
@@ -3400,6 +4120,19 @@ void syscallHandler()
     else if ((unsigned int)syscallNumber == SYS_MOVE_FILE)              { sysMove((struct fileParameter *)arg1, currentPid, directoryInode);}
     else if ((unsigned int)syscallNumber == SYS_GET_INODE_STRUCT)       { sysGetInodeForUser((struct fileParameter *)arg1, currentPid, directoryInode);}
     else if ((unsigned int)syscallNumber == SYS_CHANGE_FILE_MODE)       { sysChangeFileMode((struct fileParameter *)arg1, currentPid, directoryInode);}
+    else if ((unsigned int)syscallNumber == SYS_SYNC)                   { sysSync(currentPid); }
+    else if ((unsigned int)syscallNumber == SYS_FSYNC)                  { returnedValueFromSyscallFunction = sysFsync(arg1, currentPid); }
+    else if ((unsigned int)syscallNumber == SYS_OPEN_STREAM)            { returnedValueFromSyscallFunction = sysOpenStream((struct fileParameter *)arg1, currentPid, directoryInode); }
+    else if ((unsigned int)syscallNumber == SYS_READ_FILE)              { returnedValueFromSyscallFunction = sysReadFile((struct ioParameter *)arg1, currentPid); }
+    else if ((unsigned int)syscallNumber == SYS_WRITE_FILE)             { returnedValueFromSyscallFunction = sysWriteFile((struct ioParameter *)arg1, currentPid); }
+    else if ((unsigned int)syscallNumber == SYS_LSEEK)                  { returnedValueFromSyscallFunction = sysLseek((struct ioParameter *)arg1, currentPid); }
+    else if ((unsigned int)syscallNumber == SYS_MMAP_FILE)              { returnedValueFromSyscallFunction = sysMmapFile((struct mmapParameter *)arg1, currentPid); }
+    else if ((unsigned int)syscallNumber == SYS_MUNMAP)                 { returnedValueFromSyscallFunction = sysMunmap((uint8_t *)arg1, currentPid); }
+    else if ((unsigned int)syscallNumber == SYS_SENDFILE)               { returnedValueFromSyscallFunction = sysSendfile((struct sendfileParameter *)arg1, currentPid); }
+    else if ((unsigned int)syscallNumber == SYS_FS_CHECK)               { returnedValueFromSyscallFunction = sysFsCheck((struct fsCheckParameter *)arg1, currentPid); }
+    else if ((unsigned int)syscallNumber == SYS_FS_DEFRAG)              { returnedValueFromSyscallFunction = sysFsDefrag((struct fsDefragParameter *)arg1, currentPid, directoryInode); }
+    else if ((unsigned int)syscallNumber == SYS_GET_DIRECTORY_ENTRIES)  { returnedValueFromSyscallFunction = sysGetDirectoryEntries((struct directoryListingParameter *)arg1, currentPid, directoryInode); }
+    else if ((unsigned int)syscallNumber == SYS_FORK)                   { returnedValueFromSyscallFunction = sysFork(currentPid, directoryInode); }
 
     scheduler(currentPid);
 
@@ -3447,6 +4180,7 @@ void systemInterruptHandler()
     asm volatile ("pusha\n\t");
 
     uint8_t currentInterrupt = 0;
+    bool timerInterrupt = false;
     uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
 
     disableInterrupts();
@@ -3454,7 +4188,7 @@ void systemInterruptHandler()
     totalInterruptCount++;
 
     *(uint32_t*)TOTAL_INTERRUPTS_COUNT_LOC = totalInterruptCount;
-    *(uint32_t*)USER_TOTAL_INTERRUPTS_COUNT_LOC = totalInterruptCount;
+    storeValueAtProtectedMemLoc((uint8_t *)USER_TOTAL_INTERRUPTS_COUNT_LOC, totalInterruptCount);
 
     uint32_t currentTaskStructLocation = PROCESS_TABLE_LOC + (TASK_STRUCT_SIZE * (currentPid - 1));
     struct task *currentTask;
@@ -3484,6 +4218,7 @@ void systemInterruptHandler()
     if ((currentInterrupt & 0b0000001) == 0x1) // system timer IRQ 0
     {
         systemTimerInterruptCount++;
+        timerInterrupt = true;
         
         if (totalInterruptCount % SYSTEM_INTERRUPTS_PER_SECOND)
         {
@@ -3507,6 +4242,12 @@ void systemInterruptHandler()
 
     enableInterrupts();
 
+    // The keyboard, NIC and every other IRQ come through here too. Only the timer drives the flusher.
+    if (timerInterrupt)
+    {
+        diskFlushTimerTick(systemTimerInterruptCount, cachingEnabled);
+    }
+
     sysUptime();
 
     // currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
@@ -58,6 +58,20 @@ void sysExit(uint32_t currentPid, uint32_t exitCode);
  */
 void sysFree(uint32_t currentPid);
 
+/** The kernel routine that maps part of an open file into the process. Pages are read from the file when first touched.
+ * Read-only mappings share frames with every other process mapping the same file pages. Writes to a PG_USER_PRESENT_RW
+ * mapping stay private to the process. Returns the mapped address or SYSCALL_FAIL.
+ * \param MmapParameter The descriptor, offset, length, permissions and optional address.
+ * \param currentPid The pid of the process requesting this action.
+ */
+uint32_t sysMmapFile(struct mmapParameter *MmapParameter, uint32_t currentPid);
+
+/** The kernel routine that removes a file mapping made with sysMmapFile(). Returns SYSCALL_SUCCESS or SYSCALL_FAIL.
+ * \param mappedAddress The address sysMmapFile() returned.
+ * \param currentPid The pid of the process requesting this action.
+ */
+uint32_t sysMunmap(uint8_t *mappedAddress, uint32_t currentPid);
+
 /** The kernel routine that kills a process.
  * \param pidToKill The pid to kill.
  */
@@ -242,4 +256,90 @@ void sysGetInodeForUser(struct fileParameter *FileParameter, uint32_t currentPid
  * \param currentPid The pid of the process requesting this action.
  * \param directoryInode The current working directory inode.
  */
-void sysChangeFileMode(struct fileParameter *FileParameter, uint32_t currentPid, uint32_t directoryInode);
\ No newline at end of file
+void sysChangeFileMode(struct fileParameter *FileParameter, uint32_t currentPid, uint32_t directoryInode);
+/** The kernel routine that commits the running journal transaction and writes every dirty cached sector to disk.
+ * \param currentPid The pid of the process requesting this action.
+ */
+void sysSync(uint32_t currentPid);
+
+/** The kernel routine that makes one open file durable: commits the journal, then writes back the file's dirty data blocks.
+ * Returns SYSCALL_SUCCESS or SYSCALL_FAIL if the descriptor is not a file on disk.
+ * \param fileDescriptor The file descriptor to sync.
+ * \param currentPid The pid of the process requesting this action.
+ */
+uint32_t sysFsync(uint32_t fileDescriptor, uint32_t currentPid);
+
+/** The kernel routine to open a file for streaming with sysReadFile() and sysWriteFile(). Unlike sysOpen(), nothing
+ * is loaded and no buffer is allocated, so the size of the file does not matter. The new descriptor is left in CURRENT_FILE_DESCRIPTOR.
+ * Returns SYSCALL_SUCCESS or SYSCALL_FAIL.
+ * \param FileParameter The file parameter structure with the file specifics. RDWRITE is needed to write.
+ * \param currentPid The pid of the process requesting this action.
+ * \param directoryInode The current working directory inode.
+ */
+uint32_t sysOpenStream(struct fileParameter *FileParameter, uint32_t currentPid, uint32_t directoryInode);
+
+/** Checks that a buffer handed in by a user program lies entirely below USER_SPACE_LIMIT. Returns true if it does.
+ * \param userAddress The start of the buffer.
+ * \param length The length of the buffer in bytes.
+ */
+bool userSpaceRangeValid(uint8_t *userAddress, uint32_t length);
+
+/** The kernel routine to read from a file at its read offset into a user buffer. The read offset moves past the bytes read.
+ * Returns the number of bytes read (0 at end of file) or SYSCALL_FAIL.
+ * \param IoParameter The descriptor, buffer and length.
+ * \param currentPid The pid of the process requesting this action.
+ */
+uint32_t sysReadFile(struct ioParameter *IoParameter, uint32_t currentPid);
+
+/** The kernel routine to write a user buffer into a file at its write offset, growing the file as needed. The write offset moves past
+ * the bytes written. The file must have been opened RDWRITE. Returns the number of bytes written or SYSCALL_FAIL.
+ * \param IoParameter The descriptor, buffer and length.
+ * \param currentPid The pid of the process requesting this action.
+ */
+uint32_t sysWriteFile(struct ioParameter *IoParameter, uint32_t currentPid);
+
+/** The kernel routine to move both the read and write offsets of an open file. Returns the new offset or SYSCALL_FAIL.
+ * \param IoParameter The descriptor, offset and whence (SEEK_SET, SEEK_CUR or SEEK_END). SEEK_CUR is relative to the write offset
+ * of a descriptor opened RDWRITE and to the read offset of any other.
+ * \param currentPid The pid of the process requesting this action.
+ */
+uint32_t sysLseek(struct ioParameter *IoParameter, uint32_t currentPid);
+
+/** The kernel routine to send part of a file to a network pipe (socket). Each file block is read from the disk cache once and the
+ * UDP packets are handed to the NIC straight out of that block, one packet per MAX_UDP_PAYLOAD_LEN bytes or less. The file's read
+ * offset does not move. Returns the number of bytes sent (0 at end of file) or SYSCALL_FAIL.
+ * \param SendfileParameter The file descriptor, socket descriptor, offset and length.
+ * \param currentPid The pid of the process requesting this action.
+ */
+uint32_t sysSendfile(struct sendfileParameter *SendfileParameter, uint32_t currentPid);
+
+/** The kernel routine that runs fsCheck() for a user program such as fsck. Returns the number of problems found.
+ * \param FsCheckParameter Whether to repair, and the report to fill in.
+ * \param currentPid The pid of the process requesting this action.
+ */
+uint32_t sysFsCheck(struct fsCheckParameter *FsCheckParameter, uint32_t currentPid);
+
+/** The kernel routine that runs fsDefragFile() for a user program such as defrag. Without a file name it moves the next
+ * regular file from FsDefragParameter->inodeNumber on, so a pass over the disk is one call per file.
+ * Returns SYSCALL_FAIL when there is no such file.
+ * \param FsDefragParameter The file to move and the report to fill in.
+ * \param currentPid The pid of the process requesting this action.
+ * \param directoryInode The directory the file name is in.
+ */
+uint32_t sysFsDefrag(struct fsDefragParameter *FsDefragParameter, uint32_t currentPid, uint32_t directoryInode);
+
+/** The kernel routine that fills a user buffer with directory entries and their inode fields using readDirectoryEntries().
+ * Returns the number of entries read, 0 at the end of the directory, or SYSCALL_FAIL if there is no such directory.
+ * \param DirectoryListingParameter The directory, where to pick up, and the entries to fill in.
+ * \param currentPid The pid of the process requesting this action.
+ * \param directoryInode The working directory.
+ */
+uint32_t sysGetDirectoryEntries(struct directoryListingParameter *DirectoryListingParameter, uint32_t currentPid, uint32_t directoryInode);
+
+/**
+ * Creates a copy of the calling process. The child shares the parent's memory copy-on-write, gets its stdin, stdout and
+ * stderr, and runs first with 0 as the return value. The parent gets the child's pid once the child exits or switches back to it.
+ * \param currentPid The pid of the calling process.
+ * \param directoryInode The working directory.
+ */
+uint32_t sysFork(uint32_t currentPid, uint32_t directoryInode);
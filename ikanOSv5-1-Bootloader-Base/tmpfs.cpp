@@ -0,0 +1,315 @@
+// Copyright (c) 2023-2026 Dan O’Malley
+// This file is licensed under the MIT License. See LICENSE for details.
+
+
+#include "tmpfs.h"
+#include "file.h"
+#include "vm.h"
+#include "x86.h"
+#include "libc-main.h"
+#include "constants.h"
+
+// Files under TMPFS_MOUNT_POINT never touch the disk. They are kept in a small table with their contents in
+// pages of the TMPFS_DATA pool, so the throwaway files cc, al and sh make no longer go through inode and
+// block allocation, the journal or the write back cache. Everything in tmpfs is gone after a reboot.
+
+
+bool tmpfsIsTmpPath(uint8_t *fileName)
+{
+    uint8_t *mountPoint = (uint8_t *)TMPFS_MOUNT_POINT;
+
+    for (uint32_t i = 0; i < TMPFS_MOUNT_POINT_LENGTH; i++)
+    {
+        if (fileName[i] != mountPoint[i])
+        {
+            return false;
+        }
+    }
+
+    return fileName[TMPFS_MOUNT_POINT_LENGTH] != 0 && fileName[TMPFS_MOUNT_POINT_LENGTH] != '\n';
+}
+
+struct tmpfsFile *tmpfsFind(uint8_t *fileName)
+{
+    struct tmpfsFile *TmpfsFile = (struct tmpfsFile *)TMPFS_TABLE;
+    uint8_t *name = fileName + TMPFS_MOUNT_POINT_LENGTH;
+
+    for (uint32_t slot = 0; slot < MAX_TMPFS_FILES; slot++)
+    {
+        if (TmpfsFile[slot].name[0] == 0)
+        {
+            continue;
+        }
+
+        uint32_t i = 0;
+        while (i < TMPFS_MAX_NAME_LENGTH && TmpfsFile[slot].name[i] != 0 && TmpfsFile[slot].name[i] == name[i])
+        {
+            i++;
+        }
+
+        if (i < TMPFS_MAX_NAME_LENGTH && TmpfsFile[slot].name[i] == 0 && (name[i] == 0 || name[i] == '\n'))
+        {
+            return &TmpfsFile[slot];
+        }
+    }
+
+    return 0;
+}
+
+struct tmpfsFile *tmpfsCreate(uint8_t *fileName)
+{
+    struct tmpfsFile *TmpfsFile = tmpfsFind(fileName);
+    uint8_t *name = fileName + TMPFS_MOUNT_POINT_LENGTH;
+    uint32_t nameLength = 0;
+
+    if (TmpfsFile != 0)
+    {
+        return TmpfsFile;
+    }
+
+    while (name[nameLength] != 0 && name[nameLength] != '\n')
+    {
+        nameLength++;
+    }
+
+    // Leave room for the null terminator
+    if (nameLength == 0 || nameLength >= TMPFS_MAX_NAME_LENGTH)
+    {
+        return 0;
+    }
+
+    TmpfsFile = (struct tmpfsFile *)TMPFS_TABLE;
+
+    for (uint32_t slot = 0; slot < MAX_TMPFS_FILES; slot++)
+    {
+        if (TmpfsFile[slot].name[0] == 0)
+        {
+            fillMemory((uint8_t *)&TmpfsFile[slot], 0x0, sizeof(tmpfsFile));
+            bytecpy(TmpfsFile[slot].name, name, nameLength);
+            return &TmpfsFile[slot];
+        }
+    }
+
+    return 0; // Table is full
+}
+
+void tmpfsTruncate(struct tmpfsFile *TmpfsFile)
+{
+    for (uint32_t page = 0; page < TMPFS_MAX_FILE_PAGES; page++)
+    {
+        if (TmpfsFile->pages[page] != 0)
+        {
+            TMPFS_PAGE_MAP[TmpfsFile->pages[page] - 1] = 0;
+            TmpfsFile->pages[page] = 0;
+        }
+    }
+
+    TmpfsFile->size = 0;
+}
+
+bool tmpfsWrite(struct tmpfsFile *TmpfsFile, uint8_t *sourceMemory, uint32_t length)
+{
+    uint32_t numberOfPages = ceiling(length, PAGE_SIZE);
+    uint32_t poolPage = 0;
+
+    tmpfsTruncate(TmpfsFile);
+
+    if (numberOfPages > TMPFS_MAX_FILE_PAGES)
+    {
+        return false;
+    }
+
+    for (uint32_t page = 0; page < numberOfPages; page++)
+    {
+        uint8_t *source = sourceMemory + (page * PAGE_SIZE);
+        uint32_t bytesThisPage = PAGE_SIZE;
+        bool allZero = true;
+
+        if (bytesThisPage > (length - (page * PAGE_SIZE)))
+        {
+            bytesThisPage = length - (page * PAGE_SIZE);
+        }
+
+        for (uint32_t i = 0; i < bytesThisPage; i++)
+        {
+            if (source[i] != 0)
+            {
+                allZero = false;
+                break;
+            }
+        }
+
+        // An empty buffer from sysOpenEmpty() costs no pool pages at all
+        if (allZero)
+        {
+            continue;
+        }
+
+        while (poolPage < TMPFS_MAX_PAGES && TMPFS_PAGE_MAP[poolPage] != 0)
+        {
+            poolPage++;
+        }
+
+        if (poolPage == TMPFS_MAX_PAGES)
+        {
+            tmpfsTruncate(TmpfsFile);
+            return false;
+        }
+
+        TMPFS_PAGE_MAP[poolPage] = 1;
+        TmpfsFile->pages[page] = poolPage + 1;
+
+        uint8_t *destination = TMPFS_DATA + (poolPage * PAGE_SIZE);
+        bytecpy(destination, source, bytesThisPage);
+        fillMemory(destination + bytesThisPage, 0x0, PAGE_SIZE - bytesThisPage);
+    }
+
+    TmpfsFile->size = length;
+
+    return true;
+}
+
+void tmpfsRead(struct tmpfsFile *TmpfsFile, uint8_t *destinationMemory)
+{
+    uint32_t numberOfPages = ceiling(TmpfsFile->size, PAGE_SIZE);
+
+    for (uint32_t page = 0; page < numberOfPages; page++)
+    {
+        uint32_t bytesThisPage = PAGE_SIZE;
+
+        if (bytesThisPage > (TmpfsFile->size - (page * PAGE_SIZE)))
+        {
+            bytesThisPage = TmpfsFile->size - (page * PAGE_SIZE);
+        }
+
+        if (TmpfsFile->pages[page] == 0)
+        {
+            fillMemory(destinationMemory + (page * PAGE_SIZE), 0x0, bytesThisPage);
+        }
+        else
+        {
+            bytecpy(destinationMemory + (page * PAGE_SIZE), TMPFS_DATA + ((TmpfsFile->pages[page] - 1) * PAGE_SIZE), bytesThisPage);
+        }
+    }
+}
+
+uint32_t tmpfsOpen(uint8_t *fileName, uint32_t currentPid, uint32_t requestedSizeInPages)
+{
+    uint32_t taskStructLocation = PROCESS_TABLE_LOC + (TASK_STRUCT_SIZE * (currentPid - 1));
+    struct task *Task = (struct task*)taskStructLocation;
+
+    if (Task->nextAvailableFileDescriptor >= MAX_FILE_DESCRIPTORS || requestedSizeInPages > TMPFS_MAX_FILE_PAGES)
+    {
+        return SYSCALL_FAIL;
+    }
+
+    while (!acquireLock(KERNEL_OWNED, TMPFS_TABLE)) {}
+
+    struct tmpfsFile *TmpfsFile = 0;
+
+    if (requestedSizeInPages == 0)
+    {
+        TmpfsFile = tmpfsFind(fileName);
+    }
+    else
+    {
+        // Same as an EXT2 file made by sysOpenEmpty(), the file holds requestedSizeInPages of zeros
+        TmpfsFile = tmpfsCreate(fileName);
+
+        if (TmpfsFile != 0)
+        {
+            tmpfsTruncate(TmpfsFile);
+            TmpfsFile->size = requestedSizeInPages * PAGE_SIZE;
+        }
+    }
+
+    if (TmpfsFile == 0)
+    {
+        while (!releaseLock(KERNEL_OWNED, TMPFS_TABLE)) {}
+        return SYSCALL_FAIL;
+    }
+
+    uint32_t fileSize = TmpfsFile->size;
+    uint32_t pagesNeedForTmpBinary = ceiling(fileSize, PAGE_SIZE);
+
+    uint8_t *requestedBuffer = findBuffer(currentPid, pagesNeedForTmpBinary, PG_USER_PRESENT_RW);
+
+    for (uint32_t pageCount = 0; pageCount < pagesNeedForTmpBinary; pageCount++)
+    {
+        if (!requestSpecificPage(currentPid, (uint8_t *)((uint32_t)requestedBuffer + (pageCount * PAGE_SIZE)), PG_USER_PRESENT_RW))
+        {
+            // Give back the pages mapped so far, nothing will ever point at them
+            for (uint32_t mappedPage = 0; mappedPage < pageCount; mappedPage++)
+            {
+                freePage(currentPid, (uint8_t *)((uint32_t)requestedBuffer + (mappedPage * PAGE_SIZE)));
+            }
+
+            while (!releaseLock(KERNEL_OWNED, TMPFS_TABLE)) {}
+            return SYSCALL_FAIL;
+        }
+
+        // Zero each page in case it has been used previously
+        fillMemory((uint8_t *)((uint32_t)requestedBuffer + (pageCount * PAGE_SIZE)), 0x0, PAGE_SIZE);
+    }
+
+    tmpfsRead(TmpfsFile, requestedBuffer);
+
+    while (!releaseLock(KERNEL_OWNED, TMPFS_TABLE)) {}
+
+    // A tmpfs file has no inode, so it can't be locked, fsync'd or mapped
+    Task->fileDescriptor[Task->nextAvailableFileDescriptor] = (globalObjectTableEntry *)insertGlobalObjectTableEntry((uint8_t *)GLOBAL_OBJECT_TABLE, currentPid, 0, GOTE_TYPE_FILE, 0, 0, 0, 0, fileSize, requestedBuffer, pagesNeedForTmpBinary, 0, fileName, 0, 0, 0);
+
+    struct openBufferTable *openBufferTable = (struct openBufferTable*)OPEN_BUFFER_TABLE;
+
+    storeValueAtProtectedMemLoc(CURRENT_FILE_DESCRIPTOR, ((int)Task->nextAvailableFileDescriptor));
+    storeValueAtProtectedMemLoc(CURRENT_FILE_DESCRIPTOR_PTR, (int)requestedBuffer);
+    storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->buffers[Task->nextAvailableFileDescriptor], (int)requestedBuffer);
+    storeValueAtProtectedMemLoc((uint8_t *)&openBufferTable->bufferSize[Task->nextAvailableFileDescriptor], (int)fileSize);
+
+    // sysOpenEmpty() leaves the descriptor to be reused by the next open, so this does too
+    if (requestedSizeInPages == 0)
+    {
+        Task->nextAvailableFileDescriptor++;
+    }
+
+    return SYSCALL_SUCCESS;
+}
+
+void tmpfsCreateFromDescriptor(uint8_t *fileName, uint32_t currentPid, uint32_t fileDescriptor)
+{
+    uint32_t taskStructLocation = PROCESS_TABLE_LOC + (TASK_STRUCT_SIZE * (currentPid - 1));
+    struct task *Task = (struct task*)taskStructLocation;
+
+    if (fileDescriptor >= MAX_FILE_DESCRIPTORS || Task->fileDescriptor[fileDescriptor] == 0)
+    {
+        return;
+    }
+
+    struct globalObjectTableEntry *GOTE = (globalObjectTableEntry *)Task->fileDescriptor[fileDescriptor];
+
+    while (!acquireLock(KERNEL_OWNED, TMPFS_TABLE)) {}
+
+    struct tmpfsFile *TmpfsFile = tmpfsCreate(fileName);
+
+    if (TmpfsFile != 0)
+    {
+        tmpfsWrite(TmpfsFile, GOTE->userspaceBuffer, GOTE->size);
+    }
+
+    while (!releaseLock(KERNEL_OWNED, TMPFS_TABLE)) {}
+}
+
+void tmpfsDelete(uint8_t *fileName)
+{
+    while (!acquireLock(KERNEL_OWNED, TMPFS_TABLE)) {}
+
+    struct tmpfsFile *TmpfsFile = tmpfsFind(fileName);
+
+    if (TmpfsFile != 0)
+    {
+        tmpfsTruncate(TmpfsFile);
+        fillMemory(TmpfsFile->name, 0x0, TMPFS_MAX_NAME_LENGTH);
+    }
+
+    while (!releaseLock(KERNEL_OWNED, TMPFS_TABLE)) {}
+}
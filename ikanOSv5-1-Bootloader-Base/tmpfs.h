@@ -0,0 +1,82 @@
+// Copyright (c) 2023-2026 Dan O’Malley
+// This file is licensed under the MIT License. See LICENSE for details.
+
+
+#include "constants.h"
+
+/**
+ * One file in the RAM backed file system mounted at TMPFS_MOUNT_POINT. The contents live in pages of the TMPFS_DATA pool.
+ */
+struct tmpfsFile
+{
+    /** The file name without the mount point. An empty name means the slot is free. */
+    uint8_t name[TMPFS_MAX_NAME_LENGTH];
+    uint32_t size;
+    /** Pool page number plus one for each page of the file. 0 is a hole that reads back as zeros. */
+    uint16_t pages[TMPFS_MAX_FILE_PAGES];
+};
+
+/**
+ * Returns true if the path is under TMPFS_MOUNT_POINT and so belongs to tmpfs rather than the EXT2 disk.
+ * \param fileName The path. A trailing newline is ignored.
+ */
+bool tmpfsIsTmpPath(uint8_t *fileName);
+
+/**
+ * Returns the tmpfs file with this path or 0 if there is none. The caller must hold the TMPFS_TABLE lock.
+ * \param fileName The path, including the mount point.
+ */
+struct tmpfsFile *tmpfsFind(uint8_t *fileName);
+
+/**
+ * Returns the tmpfs file with this path, making an empty one if it does not exist. Returns 0 if the name is too long
+ * or the table is full. The caller must hold the TMPFS_TABLE lock.
+ * \param fileName The path, including the mount point.
+ */
+struct tmpfsFile *tmpfsCreate(uint8_t *fileName);
+
+/**
+ * Gives every page of a file back to the pool and sets its size to zero. The caller must hold the TMPFS_TABLE lock.
+ * \param TmpfsFile The file to empty.
+ */
+void tmpfsTruncate(struct tmpfsFile *TmpfsFile);
+
+/**
+ * Replaces the contents of a file. Pages that are all zeros are stored as holes. Returns false if the file is
+ * larger than TMPFS_MAX_FILE_PAGES or the pool runs out, in which case the file is left empty.
+ * The caller must hold the TMPFS_TABLE lock.
+ * \param TmpfsFile The file to write.
+ * \param sourceMemory The new contents.
+ * \param length The number of bytes.
+ */
+bool tmpfsWrite(struct tmpfsFile *TmpfsFile, uint8_t *sourceMemory, uint32_t length);
+
+/**
+ * Copies the whole file to memory. Holes come back as zeros. The caller must hold the TMPFS_TABLE lock.
+ * \param TmpfsFile The file to read.
+ * \param destinationMemory Where to copy it. Must hold TmpfsFile->size bytes.
+ */
+void tmpfsRead(struct tmpfsFile *TmpfsFile, uint8_t *destinationMemory);
+
+/**
+ * The tmpfs side of sysOpen() and sysOpenEmpty(). Copies the file into a new user buffer and gives it a file descriptor,
+ * the same way an EXT2 file is opened. Returns SYSCALL_SUCCESS or SYSCALL_FAIL.
+ * \param fileName The path, including the mount point, with the newline already removed.
+ * \param currentPid The pid of the process requesting this action.
+ * \param requestedSizeInPages 0 to open an existing file. Otherwise the file is created (or emptied) with this many zero pages, like sysOpenEmpty().
+ */
+uint32_t tmpfsOpen(uint8_t *fileName, uint32_t currentPid, uint32_t requestedSizeInPages);
+
+/**
+ * The tmpfs side of sysCreate(). Saves the buffer behind an open file descriptor as a tmpfs file, replacing any file of the same name.
+ * \param fileName The path, including the mount point.
+ * \param currentPid The pid of the process requesting this action.
+ * \param fileDescriptor The open file whose buffer is saved.
+ */
+void tmpfsCreateFromDescriptor(uint8_t *fileName, uint32_t currentPid, uint32_t fileDescriptor);
+
+/**
+ * The tmpfs side of sysDelete(). Removes the file and gives its pages back to the pool.
+ * \param fileName The path, including the mount point.
+ */
+void tmpfsDelete(uint8_t *fileName);
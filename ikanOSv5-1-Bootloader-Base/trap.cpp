@@ -17,12 +17,27 @@
 #include "file.h"
 #include "trap.h"
 #include "schedule.h"
+#include "mmap.h"
 
 void pageFault()
 {
-    //uint32_t currentPid = readValueFromMemLoc(RUNNING_PID_LOC);
+    // Same register save as syscallHandler() so a handled fault can iret back to the faulting instruction
+    asm volatile ("pusha\n\t");
+
     uint32_t cr2Value;
-    asm volatile ("movl %%eax, %0\n\t" : "=r" (cr2Value) : );
+    asm volatile ("movl %%cr2, %0\n\t" : "=r" (cr2Value) : );
+
+    // Ring 0 faults in here too when exec fills a new process's demand pages or the kernel writes
+    // into a copy-on-write page for a process, so every handler goes by CR3 rather than RUNNING_PID_LOC
+    uint32_t faultPid = addressSpacePid();
+
+    if (fileMappingFault(faultPid, (uint8_t *)cr2Value, true) || demandPageFault(faultPid, (uint8_t *)cr2Value) || copyOnWriteFault(faultPid, (uint8_t *)cr2Value))
+    {
+        asm volatile ("popa\n\t");
+        asm volatile ("leave\n\t");
+        asm volatile ("add $4, %esp\n\t"); // The CPU pushes an error code for a page fault
+        asm volatile ("iret\n\t");
+    }
 
     insertKernelLog(*(uint32_t*)TOTAL_INTERRUPTS_COUNT_LOC,*(uint32_t*)RUNNING_PID_LOC,(uint8_t*)"PAGEFAULT", (uint32_t)cr2Value, (uint8_t*)"PAGE FAULT");
 
@@ -10,6 +10,7 @@
 #include "exceptions.h"
 #include "file.h"
 #include "screen.h"
+#include "x86.h"
 
 
 void initializePageTables(uint32_t pid)
@@ -31,12 +32,34 @@ void fillMemory(uint8_t *memLocation, uint8_t byteToFill, uint32_t numberOfBytes
 void contextSwitch(uint32_t pid)
 {
     uint32_t pgdLocation = ((pid - 1) * MAX_PGTABLES_SIZE) + PAGE_DIR_BASE;
-    
-    asm volatile ("movl %0, %%eax\n\t" : : "r" (pgdLocation));
-    asm volatile ("movl %eax, %cr3\n\t");
-    asm volatile ("movl %cr0, %ebx\n\t");
-    asm volatile ("or $0x80000000, %ebx\n\t");
-    asm volatile ("movl %ebx, %cr0\n\t");
+    uint32_t currentPgd;
+    uint32_t cr4;
+    uint32_t cr0;
+
+    // Page size extensions for the 4 MB kernel pages, and global pages so the kernel's TLB entries
+    // survive the CR3 load. Only written when something is missing, since toggling PGE flushes everything.
+    asm volatile ("movl %%cr4, %0\n\t" : "=r" (cr4) : );
+
+    if ((cr4 & CR4_KERNEL_PAGE_FEATURES) != CR4_KERNEL_PAGE_FEATURES)
+    {
+        asm volatile ("movl %0, %%cr4\n\t" : : "r" (cr4 | CR4_KERNEL_PAGE_FEATURES) : "memory");
+    }
+
+    // Staying in the same address space keeps the user TLB entries too
+    asm volatile ("movl %%cr3, %0\n\t" : "=r" (currentPgd) : );
+
+    if (currentPgd != pgdLocation)
+    {
+        asm volatile ("movl %0, %%cr3\n\t" : : "r" (pgdLocation) : "memory");
+    }
+
+    // Paging, and write protection so the kernel can't write past copy-on-write
+    asm volatile ("movl %%cr0, %0\n\t" : "=r" (cr0) : );
+
+    if ((cr0 & CR0_PAGING_AND_WRITE_PROTECT) != CR0_PAGING_AND_WRITE_PROTECT)
+    {
+        asm volatile ("movl %0, %%cr0\n\t" : : "r" (cr0 | CR0_PAGING_AND_WRITE_PROTECT) : "memory");
+    }
 }
 
 uint32_t initializeTask(uint32_t ppid, uint16_t state, uint32_t stack, uint8_t *binaryName, uint32_t priority, uint32_t directoryInode, uint32_t requestedStdIn, uint32_t requestedStdOut, uint32_t requestedStdErr)
@@ -165,13 +188,570 @@ void freePage(uint32_t pid, uint8_t *pageToFree)
     uint32_t pageNumberToFree = (uint32_t)pageToFree / PAGE_SIZE;
     uint32_t physicalAddressToFree = *(uint32_t *)((int)ptLocation + (pageNumberToFree * 4));
 
-    freeFrame((physicalAddressToFree / PAGE_SIZE));
-    fillMemory(pageToFree, 0x0, PAGE_SIZE);
+    // A demand page that was never touched has no frame, and zeroing it would only fault one in.
+    // A copy-on-write frame is still in use by another process, so it is left as it is.
+    if ((physicalAddressToFree & PG_PRESENT) != 0)
+    {
+        bool sharedFrame = (pageFrameOwner(physicalAddressToFree / PAGE_SIZE) == PAGEFRAME_SHARED);
+
+        freeFrame((physicalAddressToFree / PAGE_SIZE));
+
+        if (!sharedFrame)
+        {
+            fillMemory(pageToFree, 0x0, PAGE_SIZE);
+        }
+    }
     *(uint32_t *)((uint32_t)ptLocation + (pageNumberToFree * 4)) = 0x0;
 
+    // contextSwitch() doesn't reload CR3 for the same pid any more, so the old entry has to go here
+    if (pid == addressSpacePid())
+    {
+        invalidatePage(pageToFree);
+    }
+
     while (!releaseLock(KERNEL_OWNED, (uint8_t *)PROCESS_TABLE_LOC)) {}
 }
 
+uint32_t *userPageTableEntry(uint32_t pid, uint8_t *virtualAddress)
+{
+    uint32_t ptLocation = ((pid - 1) * MAX_PGTABLES_SIZE) + PAGE_TABLE_BASE;
+
+    return (uint32_t *)(ptLocation + (((uint32_t)virtualAddress / PAGE_SIZE) * 4));
+}
+
+uint32_t addressSpacePid()
+{
+    uint32_t pgdLocation;
+    asm volatile ("movl %%cr3, %0\n\t" : "=r" (pgdLocation) : );
+
+    return ((pgdLocation - PAGE_DIR_BASE) / MAX_PGTABLES_SIZE) + 1;
+}
+
+void reserveDemandPages(uint32_t pid, uint8_t *virtualAddress, uint32_t numberOfPages)
+{
+    uint8_t *page = (uint8_t *)((uint32_t)virtualAddress & ~(PAGE_SIZE - 1));
+
+    for (uint32_t pageCount = 0; pageCount < numberOfPages; pageCount++)
+    {
+        uint32_t *pageTableEntry = userPageTableEntry(pid, page + (pageCount * PAGE_SIZE));
+
+        // Pages already mapped or reserved for something else keep what they have
+        if (*pageTableEntry == 0)
+        {
+            *pageTableEntry = PG_DEMAND_ZERO;
+        }
+    }
+}
+
+bool demandPageFault(uint32_t pid, uint8_t *faultAddress)
+{
+    uint8_t *page = (uint8_t *)((uint32_t)faultAddress & ~(PAGE_SIZE - 1));
+
+    if (pid == 0 || pid > MAX_PROCESSES || (uint32_t)faultAddress > USER_SPACE_LIMIT)
+    {
+        return false;
+    }
+
+    uint32_t *pageTableEntry = userPageTableEntry(pid, page);
+
+    if (*pageTableEntry != PG_DEMAND_ZERO)
+    {
+        return false;
+    }
+
+    // The zero pool has frames cleared ahead of time by the idle loops
+    uint32_t frameNumber = allocateZeroedFrame(pid);
+    bool zeroed = (frameNumber != 0);
+
+    if (!zeroed)
+    {
+        frameNumber = allocateCachedFrame(pid);
+    }
+
+    if (frameNumber == 0)
+    {
+        return false;
+    }
+
+    *pageTableEntry = (frameNumber * PAGE_SIZE) | PG_USER_PRESENT_RW;
+    invalidatePage(page);
+
+    // Otherwise the frame may hold whatever its last owner left in it
+    if (!zeroed)
+    {
+        zeroPage(page);
+    }
+
+    return true;
+}
+
+void mapZeroPoolWindow(uint32_t pid)
+{
+    uint32_t *pageDirectory = (uint32_t *)(((pid - 1) * MAX_PGTABLES_SIZE) + PAGE_DIR_BASE);
+
+    // Every process points at the same table, so a CPU can zero a frame whichever process it is in
+    pageDirectory[ZERO_POOL_WINDOW / LARGE_PAGE_SIZE] = (uint32_t)ZERO_POOL_PAGE_TABLE | PG_KERNEL_PRESENT_RW;
+}
+
+uint32_t mapKernelLargePages(uint32_t pid)
+{
+    uint32_t *pageDirectory = (uint32_t *)(((pid - 1) * MAX_PGTABLES_SIZE) + PAGE_DIR_BASE);
+    uint32_t largePages = 0;
+
+    for (uint32_t directoryEntry = ((USER_SPACE_LIMIT + 1) / LARGE_PAGE_SIZE); directoryEntry < (KERNEL_LIMIT / LARGE_PAGE_SIZE); directoryEntry++)
+    {
+        if ((pageDirectory[directoryEntry] & PG_PRESENT) == 0 || (pageDirectory[directoryEntry] & PG_LARGE_PAGE) != 0)
+        {
+            continue;
+        }
+
+        uint32_t *pageTable = (uint32_t *)(pageDirectory[directoryEntry] & ~(PAGE_SIZE - 1));
+        uint32_t flags = pageTable[0] & PG_FLAGS_MASK;
+        bool identityMapped = ((flags & PG_PRESENT) != 0);
+
+        // Only a table that maps its 4 MB straight through, all with the same permissions, can be swapped for one entry
+        for (uint32_t entry = 0; entry < (PAGE_SIZE / sizeof(uint32_t)) && identityMapped; entry++)
+        {
+            uint32_t expectedAddress = (directoryEntry * LARGE_PAGE_SIZE) + (entry * PAGE_SIZE);
+
+            identityMapped = ((pageTable[entry] & ~(PAGE_SIZE - 1)) == expectedAddress && (pageTable[entry] & PG_FLAGS_MASK) == flags);
+        }
+
+        // Every process maps the kernel the same way, so its pages can stay in the TLB across a CR3 load
+        if (!identityMapped)
+        {
+            for (uint32_t entry = 0; entry < (PAGE_SIZE / sizeof(uint32_t)); entry++)
+            {
+                if ((pageTable[entry] & PG_PRESENT) != 0 && (pageTable[entry] & ~(PAGE_SIZE - 1)) == (directoryEntry * LARGE_PAGE_SIZE) + (entry * PAGE_SIZE))
+                {
+                    pageTable[entry] = pageTable[entry] | PG_GLOBAL;
+                }
+            }
+
+            continue;
+        }
+
+        // The table itself is left as it was, only the directory stops pointing at it
+        pageDirectory[directoryEntry] = (directoryEntry * LARGE_PAGE_SIZE) | (flags & pageDirectory[directoryEntry]) | PG_LARGE_PAGE | PG_GLOBAL;
+        largePages++;
+    }
+
+    return largePages;
+}
+
+void forkAddressSpace(uint32_t parentPid, uint32_t childPid)
+{
+    for (uint32_t page = 0; page <= USER_SPACE_LIMIT; page = page + PAGE_SIZE)
+    {
+        uint32_t *parentEntry = userPageTableEntry(parentPid, (uint8_t *)page);
+        uint32_t *childEntry = userPageTableEntry(childPid, (uint8_t *)page);
+
+        if (*parentEntry == PG_DEMAND_ZERO && *childEntry == 0)
+        {
+            *childEntry = PG_DEMAND_ZERO;
+            continue;
+        }
+
+        if ((*parentEntry & PG_PRESENT) == 0)
+        {
+            continue;
+        }
+
+        // Only the parent's own memory. The kernel pages come from initializePageTables() already.
+        uint32_t frameNumber = *parentEntry / PAGE_SIZE;
+        uint32_t owner = pageFrameOwner(frameNumber);
+
+        if (owner != parentPid && owner != PAGEFRAME_SHARED)
+        {
+            continue;
+        }
+
+        pageFrameAddSharer(frameNumber);
+
+        if ((*parentEntry & PG_WRITABLE) != 0)
+        {
+            *parentEntry = (*parentEntry & ~PG_WRITABLE) | PG_COPY_ON_WRITE;
+        }
+
+        *childEntry = *parentEntry;
+    }
+}
+
+bool copyOnWriteFault(uint32_t pid, uint8_t *faultAddress)
+{
+    uint8_t *page = (uint8_t *)((uint32_t)faultAddress & ~(PAGE_SIZE - 1));
+
+    if (pid == 0 || pid > MAX_PROCESSES || (uint32_t)faultAddress > USER_SPACE_LIMIT)
+    {
+        return false;
+    }
+
+    uint32_t *pageTableEntry = userPageTableEntry(pid, page);
+
+    if ((*pageTableEntry & (PG_PRESENT | PG_COPY_ON_WRITE)) != (PG_PRESENT | PG_COPY_ON_WRITE))
+    {
+        return false;
+    }
+
+    uint32_t frameNumber = *pageTableEntry / PAGE_SIZE;
+
+    // Everyone else already has their own copy, so this one can write in place
+    if (pageFrameClaimShared(frameNumber, pid))
+    {
+        *pageTableEntry = (frameNumber * PAGE_SIZE) | PG_USER_PRESENT_RW;
+        invalidatePage(page);
+        return true;
+    }
+
+    uint32_t newFrameNumber = allocateCachedFrame(pid);
+
+    if (newFrameNumber == 0)
+    {
+        return false;
+    }
+
+    // Only one of the two frames can be mapped at the page at a time, so the copy goes through a kernel buffer
+    uint8_t *copyBuffer = COPY_ON_WRITE_BUFFER + ((currentCpu() % PAGEFRAME_CPUS) * PAGE_SIZE);
+
+    bytecpy(copyBuffer, page, PAGE_SIZE);
+
+    *pageTableEntry = (newFrameNumber * PAGE_SIZE) | PG_USER_PRESENT_RW;
+    invalidatePage(page);
+
+    bytecpy(page, copyBuffer, PAGE_SIZE);
+
+    freeFrame(frameNumber);
+
+    return true;
+}
+
+void releaseSharedPages(uint32_t pid)
+{
+    for (uint32_t page = 0; page <= USER_SPACE_LIMIT; page = page + PAGE_SIZE)
+    {
+        uint32_t *pageTableEntry = userPageTableEntry(pid, (uint8_t *)page);
+
+        if ((*pageTableEntry & PG_PRESENT) != 0 && pageFrameOwner(*pageTableEntry / PAGE_SIZE) == PAGEFRAME_SHARED)
+        {
+            uint32_t frameNumber = *pageTableEntry / PAGE_SIZE;
+
+            *pageTableEntry = 0;
+            freeFrame(frameNumber);
+        }
+    }
+}
+
+void sharedLibraryCapture(uint32_t pid)
+{
+    while (!acquireLock(KERNEL_OWNED, (uint8_t *)SHARED_LIBRARY_FRAMES)) {}
+
+    // Another exec got there first, this copy just stays with its process
+    if (SHARED_LIBRARY_FRAMES[0] != 0)
+    {
+        while (!releaseLock(KERNEL_OWNED, (uint8_t *)SHARED_LIBRARY_FRAMES)) {}
+        return;
+    }
+
+    for (uint32_t page = 0; page < SHARED_LIBRARY_PAGES; page++)
+    {
+        uint8_t *virtualAddress = (uint8_t *)(SHARED_LIBRARIES_START_LOC + (page * PAGE_SIZE));
+        uint32_t *pageTableEntry = userPageTableEntry(pid, virtualAddress);
+
+        if ((*pageTableEntry & PG_PRESENT) == 0)
+        {
+            continue;
+        }
+
+        // The table keeps one share for good, so the frame outlives every process that maps it
+        uint32_t frameNumber = *pageTableEntry / PAGE_SIZE;
+
+        pageFrameAddSharer(frameNumber);
+        SHARED_LIBRARY_FRAMES[page] = frameNumber;
+
+        *pageTableEntry = (frameNumber * PAGE_SIZE) | PG_USER_PRESENT_RO | PG_COPY_ON_WRITE;
+        invalidatePage(virtualAddress);
+    }
+
+    while (!releaseLock(KERNEL_OWNED, (uint8_t *)SHARED_LIBRARY_FRAMES)) {}
+}
+
+bool sharedLibraryMap(uint32_t pid)
+{
+    while (!acquireLock(KERNEL_OWNED, (uint8_t *)SHARED_LIBRARY_FRAMES)) {}
+
+    if (SHARED_LIBRARY_FRAMES[0] == 0)
+    {
+        while (!releaseLock(KERNEL_OWNED, (uint8_t *)SHARED_LIBRARY_FRAMES)) {}
+        return false;
+    }
+
+    for (uint32_t page = 0; page < SHARED_LIBRARY_PAGES; page++)
+    {
+        uint8_t *virtualAddress = (uint8_t *)(SHARED_LIBRARIES_START_LOC + (page * PAGE_SIZE));
+        uint32_t *pageTableEntry = userPageTableEntry(pid, virtualAddress);
+
+        if (SHARED_LIBRARY_FRAMES[page] == 0)
+        {
+            // Past the end of libc.o, zero filled and private like before
+            *pageTableEntry = PG_DEMAND_ZERO;
+            continue;
+        }
+
+        pageFrameAddSharer(SHARED_LIBRARY_FRAMES[page]);
+
+        *pageTableEntry = (SHARED_LIBRARY_FRAMES[page] * PAGE_SIZE) | PG_USER_PRESENT_RO | PG_COPY_ON_WRITE;
+        invalidatePage(virtualAddress);
+    }
+
+    while (!releaseLock(KERNEL_OWNED, (uint8_t *)SHARED_LIBRARY_FRAMES)) {}
+
+    return true;
+}
+
+bool execImageSegmentShareable(uint8_t *elfHeaderLocation, uint32_t programHeaderNumber)
+{
+    struct elfHeader *ELFHeader = (struct elfHeader *)elfHeaderLocation;
+    struct pHeader *ProgramHeader = (struct pHeader *)(elfHeaderLocation + ELFHeader->e_phoff + (ELFHeader->e_phentsize * programHeaderNumber));
+
+    if (ProgramHeader->p_type != PT_LOAD || (ProgramHeader->p_flags & PF_W) != 0 || ProgramHeader->p_memsz == 0 || ProgramHeader->p_filesz != ProgramHeader->p_memsz)
+    {
+        return false;
+    }
+
+    uint32_t firstPage = ProgramHeader->p_vaddr / PAGE_SIZE;
+    uint32_t lastPage = (ProgramHeader->p_vaddr + ProgramHeader->p_memsz - 1) / PAGE_SIZE;
+
+    if ((lastPage - firstPage + 1) > EXEC_IMAGE_MAX_PAGES)
+    {
+        return false;
+    }
+
+    // A page that also holds part of a writable segment has to stay private
+    for (uint32_t x = 0; x < ELFHeader->e_phnum; x++)
+    {
+        struct pHeader *OtherHeader = (struct pHeader *)(elfHeaderLocation + ELFHeader->e_phoff + (ELFHeader->e_phentsize * x));
+
+        if (OtherHeader->p_type == PT_LOAD && (OtherHeader->p_flags & PF_W) != 0 && OtherHeader->p_memsz != 0)
+        {
+            uint32_t otherFirstPage = OtherHeader->p_vaddr / PAGE_SIZE;
+            uint32_t otherLastPage = (OtherHeader->p_vaddr + OtherHeader->p_memsz - 1) / PAGE_SIZE;
+
+            if (otherFirstPage <= lastPage && otherLastPage >= firstPage)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+uint32_t execImageFindFrame(struct execImage *ExecImage, uint32_t virtualPage)
+{
+    for (uint32_t page = 0; page < ExecImage->numberOfPages; page++)
+    {
+        if (ExecImage->virtualPage[page] == virtualPage)
+        {
+            return ExecImage->frameNumber[page];
+        }
+    }
+
+    return 0;
+}
+
+bool execImageMap(uint32_t pid, uint32_t key, uint32_t modifiedTime, uint32_t size, uint8_t *elfHeaderLocation)
+{
+    struct execImage *ExecImage = (struct execImage *)EXEC_IMAGE_CACHE;
+    struct elfHeader *ELFHeader = (struct elfHeader *)elfHeaderLocation;
+    bool mapped = false;
+
+    if (key == 0)
+    {
+        return false;
+    }
+
+    while (!acquireLock(KERNEL_OWNED, EXEC_IMAGE_CACHE)) {}
+
+    uint32_t slot = 0;
+
+    while (slot < MAX_EXEC_IMAGES && !(ExecImage[slot].key == key && ExecImage[slot].modifiedTime == modifiedTime && ExecImage[slot].size == size))
+    {
+        slot++;
+    }
+
+    for (uint32_t x = 0; x < ELFHeader->e_phnum && slot < MAX_EXEC_IMAGES; x++)
+    {
+        if (!execImageSegmentShareable(elfHeaderLocation, x))
+        {
+            continue;
+        }
+
+        struct pHeader *ProgramHeader = (struct pHeader *)(elfHeaderLocation + ELFHeader->e_phoff + (ELFHeader->e_phentsize * x));
+        uint32_t firstPage = ProgramHeader->p_vaddr / PAGE_SIZE;
+        uint32_t lastPage = (ProgramHeader->p_vaddr + ProgramHeader->p_memsz - 1) / PAGE_SIZE;
+        bool allKept = true;
+
+        for (uint32_t virtualPage = firstPage; virtualPage <= lastPage && allKept; virtualPage++)
+        {
+            allKept = (execImageFindFrame(&ExecImage[slot], virtualPage) != 0);
+        }
+
+        if (!allKept)
+        {
+            continue;
+        }
+
+        for (uint32_t virtualPage = firstPage; virtualPage <= lastPage; virtualPage++)
+        {
+            uint32_t frameNumber = execImageFindFrame(&ExecImage[slot], virtualPage);
+            uint32_t *pageTableEntry = userPageTableEntry(pid, (uint8_t *)(virtualPage * PAGE_SIZE));
+
+            pageFrameAddSharer(frameNumber);
+
+            *pageTableEntry = (frameNumber * PAGE_SIZE) | PG_USER_PRESENT_RO | PG_COPY_ON_WRITE;
+            invalidatePage((uint8_t *)(virtualPage * PAGE_SIZE));
+        }
+
+        // Already in place, so loadElfFile() skips it
+        ProgramHeader->p_type = PT_NULL;
+        mapped = true;
+    }
+
+    while (!releaseLock(KERNEL_OWNED, EXEC_IMAGE_CACHE)) {}
+
+    return mapped;
+}
+
+void execImageCapture(uint32_t pid, uint32_t key, uint32_t modifiedTime, uint32_t size, uint8_t *elfHeaderLocation)
+{
+    struct execImage *ExecImage = (struct execImage *)EXEC_IMAGE_CACHE;
+    struct elfHeader *ELFHeader = (struct elfHeader *)elfHeaderLocation;
+
+    if (key == 0)
+    {
+        return;
+    }
+
+    while (!acquireLock(KERNEL_OWNED, EXEC_IMAGE_CACHE)) {}
+
+    uint32_t slot = 0;
+
+    // An older version of the same program gives up its slot, otherwise a free slot, otherwise the next one round robin
+    while (slot < MAX_EXEC_IMAGES && ExecImage[slot].key != key)
+    {
+        slot++;
+    }
+
+    if (slot < MAX_EXEC_IMAGES && ExecImage[slot].modifiedTime == modifiedTime && ExecImage[slot].size == size)
+    {
+        while (!releaseLock(KERNEL_OWNED, EXEC_IMAGE_CACHE)) {}
+        return;
+    }
+
+    if (slot == MAX_EXEC_IMAGES)
+    {
+        slot = 0;
+
+        while (slot < MAX_EXEC_IMAGES && ExecImage[slot].key != 0)
+        {
+            slot++;
+        }
+    }
+
+    if (slot == MAX_EXEC_IMAGES)
+    {
+        slot = readValueFromMemLoc((uint8_t *)EXEC_IMAGE_CACHE_CURSOR);
+        storeValueAtMemLoc((uint8_t *)EXEC_IMAGE_CACHE_CURSOR, (slot + 1) % MAX_EXEC_IMAGES);
+    }
+
+    if (ExecImage[slot].key != 0)
+    {
+        execImageRelease(&ExecImage[slot]);
+    }
+
+    ExecImage[slot].key = key;
+    ExecImage[slot].modifiedTime = modifiedTime;
+    ExecImage[slot].size = size;
+    ExecImage[slot].numberOfPages = 0;
+
+    for (uint32_t x = 0; x < ELFHeader->e_phnum; x++)
+    {
+        if (!execImageSegmentShareable(elfHeaderLocation, x))
+        {
+            continue;
+        }
+
+        struct pHeader *ProgramHeader = (struct pHeader *)(elfHeaderLocation + ELFHeader->e_phoff + (ELFHeader->e_phentsize * x));
+        uint32_t firstPage = ProgramHeader->p_vaddr / PAGE_SIZE;
+        uint32_t lastPage = (ProgramHeader->p_vaddr + ProgramHeader->p_memsz - 1) / PAGE_SIZE;
+        bool allPresent = (ExecImage[slot].numberOfPages + (lastPage - firstPage + 1)) <= EXEC_IMAGE_MAX_PAGES;
+
+        for (uint32_t virtualPage = firstPage; virtualPage <= lastPage && allPresent; virtualPage++)
+        {
+            uint32_t pageTableEntry = *userPageTableEntry(pid, (uint8_t *)(virtualPage * PAGE_SIZE));
+
+            allPresent = ((pageTableEntry & PG_PRESENT) != 0 && pageFrameOwner(pageTableEntry / PAGE_SIZE) == pid);
+        }
+
+        if (!allPresent)
+        {
+            continue;
+        }
+
+        // The cache keeps one share of each frame, the same as the libc.o frames
+        for (uint32_t virtualPage = firstPage; virtualPage <= lastPage; virtualPage++)
+        {
+            uint32_t *pageTableEntry = userPageTableEntry(pid, (uint8_t *)(virtualPage * PAGE_SIZE));
+            uint32_t frameNumber = *pageTableEntry / PAGE_SIZE;
+
+            pageFrameAddSharer(frameNumber);
+
+            ExecImage[slot].virtualPage[ExecImage[slot].numberOfPages] = virtualPage;
+            ExecImage[slot].frameNumber[ExecImage[slot].numberOfPages] = frameNumber;
+            ExecImage[slot].numberOfPages++;
+
+            *pageTableEntry = (frameNumber * PAGE_SIZE) | PG_USER_PRESENT_RO | PG_COPY_ON_WRITE;
+            invalidatePage((uint8_t *)(virtualPage * PAGE_SIZE));
+        }
+    }
+
+    if (ExecImage[slot].numberOfPages == 0)
+    {
+        ExecImage[slot].key = 0;
+    }
+
+    while (!releaseLock(KERNEL_OWNED, EXEC_IMAGE_CACHE)) {}
+}
+
+void execImageRelease(struct execImage *ExecImage)
+{
+    for (uint32_t page = 0; page < ExecImage->numberOfPages; page++)
+    {
+        freeFrame(ExecImage->frameNumber[page]);
+    }
+
+    ExecImage->numberOfPages = 0;
+    ExecImage->key = 0;
+}
+
+void execImageInvalidate(uint32_t inode)
+{
+    struct execImage *ExecImage = (struct execImage *)EXEC_IMAGE_CACHE;
+
+    while (!acquireLock(KERNEL_OWNED, EXEC_IMAGE_CACHE)) {}
+
+    // Nothing writes i_mtime, so a rewritten program of the same size would still match its old slot
+    for (uint32_t slot = 0; slot < MAX_EXEC_IMAGES; slot++)
+    {
+        if (ExecImage[slot].key == inode)
+        {
+            execImageRelease(&ExecImage[slot]);
+        }
+    }
+
+    while (!releaseLock(KERNEL_OWNED, EXEC_IMAGE_CACHE)) {}
+}
+
 bool acquireLock(uint32_t currentPid, uint8_t *memoryLocation)
 {
     uint32_t semaphoreNumber = 0;
@@ -9,6 +9,21 @@
 /**
  * The task structure. This holds all of the process-specific information to successfully context switch.
  */
+/**
+ * The read-only pages of a program, kept so the next exec of it can map them instead of copying them in again.
+ */
+struct execImage
+{
+    /** The program's inode, or the address of its initramfs entry. 0 means the slot is free. */
+    uint32_t key;
+    /** The i_mtime and i_size the pages were kept for. Writes to the inode drop the slot through execImageInvalidate(). */
+    uint32_t modifiedTime;
+    uint32_t size;
+    uint32_t numberOfPages;
+    uint32_t virtualPage[EXEC_IMAGE_MAX_PAGES];
+    uint32_t frameNumber[EXEC_IMAGE_MAX_PAGES];
+};
+
 struct task {
     uint32_t pid;
     uint32_t ppid;
@@ -122,6 +137,116 @@ uint8_t *findBuffer(uint32_t pid, uint32_t numberOfPages, uint8_t perms);
  */
 void freePage(uint32_t pid, uint8_t *pageToFree);
 
+/** Returns a pointer to the page table entry for a user address in a process's page tables.
+ * \param pid The pid whose page tables you want.
+ * \param virtualAddress The user address.
+ */
+uint32_t *userPageTableEntry(uint32_t pid, uint8_t *virtualAddress);
+
+/** Returns the pid whose page directory is loaded in CR3. During an exec this is the new process before RUNNING_PID_LOC catches up.
+ */
+uint32_t addressSpacePid();
+
+/** Reserves user pages that get a zero filled frame the first time they are touched. Entries already in use are left alone.
+ * \param pid The pid whose page tables you want.
+ * \param virtualAddress The first page. Rounded down to a page boundary.
+ * \param numberOfPages How many pages to reserve.
+ */
+void reserveDemandPages(uint32_t pid, uint8_t *virtualAddress, uint32_t numberOfPages);
+
+/** Called from the page fault handler. If the page was reserved with reserveDemandPages(), maps a zero filled frame and
+ * returns true so the faulting instruction can be restarted.
+ * \param pid The pid whose page tables hold the address.
+ * \param faultAddress The address from CR2.
+ */
+bool demandPageFault(uint32_t pid, uint8_t *faultAddress);
+
+/** Points a process's page directory at the zero pool's window, where zeroPoolRefill() maps the frames it clears.
+ * \param pid The pid whose page tables were just initialized.
+ */
+void mapZeroPoolWindow(uint32_t pid);
+
+/** Replaces the kernel's 4 KB page tables in a process's page directory with 4 MB pages wherever a table is a plain
+ * identity map with the same permissions throughout. All of the kernel's identity mapped pages are marked global.
+ * Returns how many 4 MB pages it made.
+ * \param pid The pid whose page tables were just initialized.
+ */
+uint32_t mapKernelLargePages(uint32_t pid);
+
+/** Shares a parent's memory with a forked child. Writable pages become read-only with PG_COPY_ON_WRITE in both, and
+ * each frame gets one more sharer. Untouched demand pages are reserved in the child too.
+ * \param parentPid The pid being forked.
+ * \param childPid The new pid. Its page tables must already be initialized.
+ */
+void forkAddressSpace(uint32_t parentPid, uint32_t childPid);
+
+/** Called from the page fault handler. If the page is copy-on-write, gives the pid its own writable copy (or the frame
+ * itself when nobody else shares it any more) and returns true so the faulting instruction can be restarted.
+ * \param pid The pid whose page tables hold the address.
+ * \param faultAddress The address from CR2.
+ */
+bool copyOnWriteFault(uint32_t pid, uint8_t *faultAddress);
+
+/** Drops a process's references on its copy-on-write frames and clears those page table entries. Called when the process exits.
+ * \param pid The exiting pid.
+ */
+void releaseSharedPages(uint32_t pid);
+
+/** Keeps the libc.o a process just loaded at SHARED_LIBRARIES_START_LOC as the one copy every later exec maps.
+ * Its pages become read-only and copy-on-write. Does nothing if a copy is already kept.
+ * \param pid The pid that loaded libc.o.
+ */
+void sharedLibraryCapture(uint32_t pid);
+
+/** Maps the kept libc.o frames read-only and copy-on-write into a new process. Returns false if no copy
+ * has been kept yet and the caller has to load libc.o itself.
+ * \param pid The new pid. Its page tables must be the active ones.
+ */
+bool sharedLibraryMap(uint32_t pid);
+
+/** Returns true if a PT_LOAD segment can be shared between instances of a program. It has to be read-only, all
+ * file contents, and on pages of its own.
+ * \param elfHeaderLocation The ELF file in memory.
+ * \param programHeaderNumber Which program header.
+ */
+bool execImageSegmentShareable(uint8_t *elfHeaderLocation, uint32_t programHeaderNumber);
+
+/** Returns the frame a kept program has for a virtual page, or 0 if it has none.
+ * \param ExecImage The cache slot.
+ * \param virtualPage The virtual address divided by PAGE_SIZE.
+ */
+uint32_t execImageFindFrame(struct execImage *ExecImage, uint32_t virtualPage);
+
+/** Maps the kept read-only pages of a program into a new process, read-only and copy-on-write. Each segment mapped
+ * this way is changed to PT_NULL in the ELF file so loadElfFile() leaves it alone. Returns true if anything was mapped.
+ * \param pid The new pid.
+ * \param key The program's inode, or the address of its initramfs entry.
+ * \param modifiedTime The program's i_mtime.
+ * \param size The program's i_size.
+ * \param elfHeaderLocation The ELF file in memory.
+ */
+bool execImageMap(uint32_t pid, uint32_t key, uint32_t modifiedTime, uint32_t size, uint8_t *elfHeaderLocation);
+
+/** Keeps the shareable segments a new process just loaded for the next exec of the same program, and maps them
+ * read-only and copy-on-write. The oldest kept program makes room when the cache is full.
+ * \param pid The new pid, after loadElfFile().
+ * \param key The program's inode, or the address of its initramfs entry.
+ * \param modifiedTime The program's i_mtime.
+ * \param size The program's i_size.
+ * \param elfHeaderLocation The ELF file in memory.
+ */
+void execImageCapture(uint32_t pid, uint32_t key, uint32_t modifiedTime, uint32_t size, uint8_t *elfHeaderLocation);
+
+/** Drops the cache's share of a kept program's frames and frees its slot. Processes still running it keep theirs.
+ * \param ExecImage The cache slot.
+ */
+void execImageRelease(struct execImage *ExecImage);
+
+/** Drops the kept pages of a program whose inode changed, so the next exec loads it from disk again.
+ * \param inode The inode that changed.
+ */
+void execImageInvalidate(uint32_t inode);
+
 /** Used to acquire mutual exclusivity to a data structure.
  * \param currentPid The pid requesting the action.
  * \param memoryLocation The memory location you want to secure, stored in KERNEL_SEMAPHORE_TABLE
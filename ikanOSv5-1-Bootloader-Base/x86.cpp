@@ -68,6 +68,71 @@ void loadTaskRegister(uint16_t taskRegisterValue)
     asm volatile ("ltr %ax\n\t");
 }
 
+void invalidatePage(uint8_t *virtualAddress)
+{
+    asm volatile ("invlpg (%0)\n\t" : : "r" (virtualAddress) : "memory");
+}
+
+bool compareAndSwap(uint32_t *destinationMemory, uint32_t expectedValue, uint32_t newValue)
+{
+    uint8_t swapped;
+
+    asm volatile ("lock cmpxchgl %3, %1\n\t"
+                  "sete %0\n\t"
+                  : "=q" (swapped), "+m" (*destinationMemory), "+a" (expectedValue)
+                  : "r" (newValue)
+                  : "memory", "cc");
+
+    return swapped;
+}
+
+void atomicAdd(uint32_t *destinationMemory, uint32_t value)
+{
+    asm volatile ("lock addl %1, %0\n\t"
+                  : "+m" (*destinationMemory)
+                  : "r" (value)
+                  : "memory", "cc");
+}
+
+void storeValueAtProtectedMemLoc(uint8_t *destinationMemory, uint32_t value)
+{
+    bytecpyToProtectedMem(destinationMemory, (uint8_t *)&value, sizeof(uint32_t));
+}
+
+void bytecpyToProtectedMem(uint8_t *destinationMemory, uint8_t *sourceMemory, uint32_t numberOfBytes)
+{
+    uint32_t eflags;
+    uint32_t cr0;
+
+    // Interrupts stay off while write protection is lifted, so nothing else can write past a copy-on-write page meanwhile
+    asm volatile ("pushfl\n\tpopl %0\n\tcli\n\t" : "=r" (eflags) : : "memory");
+    asm volatile ("movl %%cr0, %0\n\t" : "=r" (cr0) : );
+    asm volatile ("movl %0, %%cr0\n\t" : : "r" (cr0 & ~CR0_WRITE_PROTECT) : "memory");
+
+    for (uint32_t x = 0; x < numberOfBytes; x++)
+    {
+        destinationMemory[x] = sourceMemory[x];
+    }
+
+    asm volatile ("movl %0, %%cr0\n\t" : : "r" (cr0) : "memory");
+    asm volatile ("pushl %0\n\tpopfl\n\t" : : "r" (eflags) : "memory", "cc");
+}
+
+void zeroPage(uint8_t *page)
+{
+    uint32_t words = PAGE_SIZE / sizeof(uint32_t);
+
+    // A dword at a time rather than fillMemory()'s byte loop
+    asm volatile ("cld\n\trep stosl\n\t" : "+D" (page), "+c" (words) : "a" (0) : "memory");
+}
+
+uint32_t currentCpu()
+{
+    volatile uint32_t *lapic = (volatile uint32_t *)LAPIC_ADDR;
+
+    return (lapic[0x20 >> 2] >> 24) & 0xFF;
+}
+
 void storeValueAtMemLoc(uint8_t *destinationMemory, uint32_t value)
 {
     // Dan O'Malley
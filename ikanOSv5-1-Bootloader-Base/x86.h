@@ -59,4 +59,45 @@ uint32_t sysCall(uint32_t sysCallNumber, uint32_t arg1, uint32_t currentPid);
  * \param taskRegisterValue Used to load the tss_kernel_descriptor from bootloader-stage 1.
  */
 void loadTaskRegister(uint16_t taskRegisterValue);
+
+/** Drops one page from the TLB after its page table entry changes.
+ * \param virtualAddress Any address in the page.
+ */
+void invalidatePage(uint8_t *virtualAddress);
+
+/** Atomically replaces a 32-bit value if it still holds what the caller last read. Safe across CPUs. Returns true if the value was replaced.
+ * \param destinationMemory The 32-bit value to update.
+ * \param expectedValue The value the caller expects to find there.
+ * \param newValue The value to store if the expected value is found.
+ */
+bool compareAndSwap(uint32_t *destinationMemory, uint32_t expectedValue, uint32_t newValue);
+/** Atomically adds to a 32-bit value. Safe across CPUs. Pass a negative value cast to uint32_t to subtract.
+ * \param destinationMemory The 32-bit value to update.
+ * \param value The amount to add.
+ */
+void atomicAdd(uint32_t *destinationMemory, uint32_t value);
+
+/** Stores a 32-bit value into a page processes can only read, such as USER_PID_INFO. CR0.WP is lifted for this one
+ * store only, so the kernel's other writes still fault on copy-on-write pages.
+ * \param destinationMemory The target destination.
+ * \param value The 32-bit value you want to store.
+ */
+void storeValueAtProtectedMemLoc(uint8_t *destinationMemory, uint32_t value);
+
+/** The bytecpy() for pages processes can only read, such as USER_PID_INFO and STDERR_BUFFER. CR0.WP is lifted, with
+ * interrupts off, for the length of the copy only.
+ * \param destinationMemory Where the bytes go.
+ * \param sourceMemory Where the bytes come from.
+ * \param numberOfBytes The number of bytes to copy.
+ */
+void bytecpyToProtectedMem(uint8_t *destinationMemory, uint8_t *sourceMemory, uint32_t numberOfBytes);
+
+/** Zero fills one page with rep stosl.
+ * \param page The page aligned address to clear.
+ */
+void zeroPage(uint8_t *page);
+
+/** Returns the local APIC id of the CPU running this code.
+ */
+uint32_t currentCpu();
 void startApplicationProcessor();
\ No newline at end of file